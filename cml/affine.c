@@ -0,0 +1,246 @@
+#include "affine.h"
+
+#include <assert.h>
+
+#include "internal/cml_simd.h"
+#include "parallel.h"
+
+cml_affine cml_affine_identity(void) {
+    cml_affine ret;
+
+    for (cml_u32 r = 0; r < 3; r++) {
+        for (cml_u32 c = 0; c < 4; c++) {
+            ret.m[r][c] = r == c ? 1.0f : 0.0f;
+        }
+    }
+    return ret;
+}
+
+cml_affine cml_affine_from_matrix(matrix m) {
+    assert(m.rows == 4 && m.cols == 4);
+
+    // the transform matrices store columns in values[c]
+    cml_affine ret;
+    for (cml_u32 r = 0; r < 3; r++) {
+        for (cml_u32 c = 0; c < 4; c++) {
+            ret.m[r][c] = m.values[c][r];
+        }
+    }
+    return ret;
+}
+
+matrix cml_affine_to_matrix(cml_affine a) {
+    matrix ret = cml_matrix_identity(4);
+
+    for (cml_u32 r = 0; r < 3; r++) {
+        for (cml_u32 c = 0; c < 4; c++) {
+            ret.values[c][r] = a.m[r][c];
+        }
+    }
+    return ret;
+}
+
+static void cml_affine_compose_to(cml_affine* dst, const cml_affine* a,
+                                  const cml_affine* b) {
+#ifdef CML_SIMD_SSE
+    // row r of the result combines the rows of b, the implied
+    // last row of b only adds a[r][3] to the translation
+    __m128 b0 = _mm_loadu_ps(b->m[0]);
+    __m128 b1 = _mm_loadu_ps(b->m[1]);
+    __m128 b2 = _mm_loadu_ps(b->m[2]);
+    __m128 rows[3];
+
+    for (cml_u32 r = 0; r < 3; r++) {
+        __m128 row = _mm_mul_ps(_mm_set1_ps(a->m[r][0]), b0);
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a->m[r][1]), b1));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a->m[r][2]), b2));
+        rows[r] = _mm_add_ps(row, _mm_set_ps(a->m[r][3], 0.0f, 0.0f, 0.0f));
+    }
+
+    for (cml_u32 r = 0; r < 3; r++) {
+        _mm_storeu_ps(dst->m[r], rows[r]);
+    }
+#else
+    cml_affine ret;
+
+    for (cml_u32 r = 0; r < 3; r++) {
+        for (cml_u32 c = 0; c < 4; c++) {
+            ret.m[r][c] = a->m[r][0] * b->m[0][c] + a->m[r][1] * b->m[1][c] +
+                          a->m[r][2] * b->m[2][c];
+        }
+        ret.m[r][3] += a->m[r][3];
+    }
+    *dst = ret;
+#endif
+}
+
+cml_affine cml_affine_compose(cml_affine a, cml_affine b) {
+    cml_affine ret;
+    cml_affine_compose_to(&ret, &a, &b);
+
+    return ret;
+}
+
+cml_affine cml_affine_inverse(cml_affine a) {
+    float(*m)[4] = a.m;
+
+    // adjugate of the linear part
+    float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    float c01 = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+    float c02 = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+    float c10 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    float c11 = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+    float c12 = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+    float c20 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+    float c21 = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+    float c22 = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+    float det = m[0][0] * c00 + m[0][1] * c10 + m[0][2] * c20;
+    assert(det != 0.0f);
+
+    float inv = 1.0f / det;
+    cml_affine ret;
+    ret.m[0][0] = c00 * inv;
+    ret.m[0][1] = c01 * inv;
+    ret.m[0][2] = c02 * inv;
+    ret.m[1][0] = c10 * inv;
+    ret.m[1][1] = c11 * inv;
+    ret.m[1][2] = c12 * inv;
+    ret.m[2][0] = c20 * inv;
+    ret.m[2][1] = c21 * inv;
+    ret.m[2][2] = c22 * inv;
+
+    // t' = -inverse(linear) * t
+    for (cml_u32 r = 0; r < 3; r++) {
+        ret.m[r][3] = -(ret.m[r][0] * m[0][3] + ret.m[r][1] * m[1][3] +
+                        ret.m[r][2] * m[2][3]);
+    }
+    return ret;
+}
+
+cml_affine cml_affine_inverse_rigid(cml_affine a) {
+    cml_affine ret;
+
+    for (cml_u32 r = 0; r < 3; r++) {
+        for (cml_u32 c = 0; c < 3; c++) {
+            ret.m[r][c] = a.m[c][r];
+        }
+    }
+    for (cml_u32 r = 0; r < 3; r++) {
+        ret.m[r][3] = -(ret.m[r][0] * a.m[0][3] + ret.m[r][1] * a.m[1][3] +
+                        ret.m[r][2] * a.m[2][3]);
+    }
+    return ret;
+}
+
+void cml_affine_apply_point(const cml_affine* a, const float* p, float* out) {
+    float x = p[0], y = p[1], z = p[2];
+
+    for (cml_u32 r = 0; r < 3; r++) {
+        out[r] = a->m[r][0] * x + a->m[r][1] * y + a->m[r][2] * z + a->m[r][3];
+    }
+}
+
+void cml_affine_apply_vector(const cml_affine* a, const float* v, float* out) {
+    float x = v[0], y = v[1], z = v[2];
+
+    for (cml_u32 r = 0; r < 3; r++) {
+        out[r] = a->m[r][0] * x + a->m[r][1] * y + a->m[r][2] * z;
+    }
+}
+
+typedef struct {
+    const cml_affine* a;
+    float* dst;
+    const float* src;
+    BOOL points;
+} cml_affine_apply_job;
+
+static void cml_affine_apply_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_affine_apply_job* job = arg;
+    const cml_affine* a = job->a;
+    cml_u32 i = begin;
+
+#ifdef CML_SIMD_SSE
+    __m128 m[3][4];
+    for (cml_u32 r = 0; r < 3; r++) {
+        for (cml_u32 c = 0; c < 4; c++) {
+            m[r][c] = _mm_set1_ps(c < 3 || job->points ? a->m[r][c] : 0.0f);
+        }
+    }
+
+    for (; i + 4 <= end; i += 4) {
+        __m128 x, y, z;
+        cml_simd_load_xyz4(job->src + 3 * i, &x, &y, &z);
+
+        __m128 out[3];
+        for (cml_u32 r = 0; r < 3; r++) {
+            out[r] = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(m[r][0], x), _mm_mul_ps(m[r][1], y)),
+                _mm_add_ps(_mm_mul_ps(m[r][2], z), m[r][3]));
+        }
+        cml_simd_store_xyz4(job->dst + 3 * i, out[0], out[1], out[2]);
+    }
+#endif
+
+    for (; i < end; i++) {
+        if (job->points) {
+            cml_affine_apply_point(a, job->src + 3 * i, job->dst + 3 * i);
+        } else {
+            cml_affine_apply_vector(a, job->src + 3 * i, job->dst + 3 * i);
+        }
+    }
+}
+
+static void cml_affine_apply(const cml_affine* a, float* dst, const float* src,
+                             cml_u32 count, BOOL points) {
+    cml_affine_apply_job job;
+    job.a = a;
+    job.dst = dst;
+    job.src = src;
+    job.points = points;
+
+    if ((cml_u64)count * 3 < CML_PARALLEL_THRESHOLD) {
+        cml_affine_apply_range(0, count, &job);
+        return;
+    }
+    cml_parallel_for(0, count, 4096, cml_affine_apply_range, &job);
+}
+
+void cml_affine_apply_points(const cml_affine* a, float* dst, const float* src,
+                             cml_u32 count) {
+    cml_affine_apply(a, dst, src, count, TRUE);
+}
+
+void cml_affine_apply_vectors(const cml_affine* a, float* dst,
+                              const float* src, cml_u32 count) {
+    cml_affine_apply(a, dst, src, count, FALSE);
+}
+
+typedef struct {
+    cml_affine* dst;
+    const cml_affine* a;
+    const cml_affine* b;
+} cml_affine_compose_job;
+
+static void cml_affine_compose_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_affine_compose_job* job = arg;
+
+    for (cml_u32 i = begin; i < end; i++) {
+        cml_affine_compose_to(job->dst + i, job->a + i, job->b + i);
+    }
+}
+
+void cml_affine_compose_batch(cml_affine* dst, const cml_affine* a,
+                              const cml_affine* b, cml_u32 count) {
+    cml_affine_compose_job job;
+    job.dst = dst;
+    job.a = a;
+    job.b = b;
+
+    if ((cml_u64)count * 12 < CML_PARALLEL_THRESHOLD) {
+        cml_affine_compose_range(0, count, &job);
+        return;
+    }
+    cml_parallel_for(0, count, 1024, cml_affine_compose_range, &job);
+}
@@ -0,0 +1,87 @@
+#ifndef CML_AFFINE_INCLUDED
+#define CML_AFFINE_INCLUDED
+
+#include "internal/cml_core.h"
+#include "matrix.h"
+
+/*
+    Affine transform stored as the upper 3 rows of a 4x4
+    matrix. Row r maps a point p to
+
+        m[r][0] * p.x + m[r][1] * p.y + m[r][2] * p.z + m[r][3]
+
+    so columns 0 - 2 hold the linear part and column 3 the
+    translation. The constant last row (0 0 0 1) is implied,
+    which saves a quarter of the storage and skips the
+    multiplications with it. Unlike "matrix" the type lives
+    on the stack and can be stored in plain arrays.
+*/
+typedef struct {
+    float m[3][4];
+} cml_affine;
+
+cml_affine cml_affine_identity(void);
+
+/*
+    NOTE: The matrix has to be 4x4, its last row is ignored.
+
+    Converts a 4x4 transform matrix as built by cml_translate(),
+    cml_rotate(), cml_scale() or cml_look_at() to an affine
+    transform.
+*/
+cml_affine cml_affine_from_matrix(matrix m);
+
+/*
+    Returns the 4x4 matrix of the given affine transform in
+    the layout of matrix_transform.h.
+*/
+matrix cml_affine_to_matrix(cml_affine a);
+
+/*
+    Returns the transform that applies "b" first and then
+    "a" (the product a * b).
+*/
+cml_affine cml_affine_compose(cml_affine a, cml_affine b);
+
+/*
+    NOTE: The linear part has to be invertible.
+
+    Returns the inverse of the given affine transform.
+*/
+cml_affine cml_affine_inverse(cml_affine a);
+
+/*
+    Returns the inverse of a transform whose linear part is a
+    rotation (orthonormal columns), which only transposes it.
+*/
+cml_affine cml_affine_inverse_rigid(cml_affine a);
+
+/*
+    Transforms the point / direction "p" (3 floats) and writes
+    the result to "out". Directions ignore the translation.
+    "out" may be equal to "p".
+*/
+void cml_affine_apply_point(const cml_affine* a, const float* p, float* out);
+
+void cml_affine_apply_vector(const cml_affine* a, const float* v, float* out);
+
+/*
+    Transforms "count" points / directions stored interleaved
+    as x0 y0 z0 x1 y1 z1 ... from "src" to "dst", which may be
+    equal to "src". 4 points are processed at a time with SSE,
+    large batches run on the thread pool.
+*/
+void cml_affine_apply_points(const cml_affine* a, float* dst, const float* src,
+                             cml_u32 count);
+
+void cml_affine_apply_vectors(const cml_affine* a, float* dst,
+                              const float* src, cml_u32 count);
+
+/*
+    dst[i] = cml_affine_compose(a[i], b[i]) for i < count.
+    "dst" may be equal to "a" or "b".
+*/
+void cml_affine_compose_batch(cml_affine* dst, const cml_affine* a,
+                              const cml_affine* b, cml_u32 count);
+
+#endif  // CML_AFFINE_INCLUDED
@@ -0,0 +1,275 @@
+#include "banded.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+
+BOOL cml_tridiagonal_solve(const float* sub, const float* diagonal,
+                           const float* super, float* b, cml_u32 n,
+                           float* scratch) {
+    if (n == 0) {
+        return TRUE;
+    }
+
+    float* owned = NULL;
+    if (!scratch) {
+        owned = malloc(n * sizeof(float));
+        scratch = owned;
+    }
+
+    BOOL ret = TRUE;
+
+    // forward sweep, scratch holds the eliminated super diagonal
+    for (cml_u32 i = 0; i < n; i++) {
+        float pivot = diagonal[i];
+        float rhs = b[i];
+        if (i > 0) {
+            pivot -= sub[i - 1] * scratch[i - 1];
+            rhs -= sub[i - 1] * b[i - 1];
+        }
+        if (pivot == 0.0f) {
+            ret = FALSE;
+            break;
+        }
+
+        float inv = 1.0f / pivot;
+        scratch[i] = i + 1 < n ? super[i] * inv : 0.0f;
+        b[i] = rhs * inv;
+    }
+
+    if (ret) {
+        for (cml_u32 i = n - 1; i-- > 0;) {
+            b[i] -= scratch[i] * b[i + 1];
+        }
+    }
+
+    free(owned);
+    return ret;
+}
+
+typedef struct {
+    const float* sub;
+    const float* diagonal;
+    const float* super;
+    float* b;
+    float* scratch;
+    BOOL* failed;  // one slot per range, indexed by its begin
+    cml_u32 n, count;
+} cml_tridiagonal_job;
+
+static void cml_tridiagonal_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_tridiagonal_job* job = arg;
+    cml_u32 n = job->n;
+    size_t count = job->count;
+    BOOL ok = TRUE;
+
+    // every step runs over the contiguous lanes begin .. end
+    for (cml_u32 i = 0; i < n; i++) {
+        const float* d = job->diagonal + i * count;
+        float* b = job->b + i * count;
+        float* c = job->scratch + i * count;
+
+        for (cml_u32 s = begin; s < end; s++) {
+            float pivot = d[s];
+            float rhs = b[s];
+            if (i > 0) {
+                float a = job->sub[(i - 1) * count + s];
+                pivot -= a * c[s - count];
+                rhs -= a * b[s - count];
+            }
+            ok &= pivot != 0.0f;
+
+            float inv = 1.0f / pivot;
+            c[s] = i + 1 < n ? job->super[i * count + s] * inv : 0.0f;
+            b[s] = rhs * inv;
+        }
+    }
+
+    for (cml_u32 i = n - 1; i-- > 0;) {
+        float* b = job->b + i * count;
+        const float* c = job->scratch + i * count;
+
+        for (cml_u32 s = begin; s < end; s++) {
+            b[s] -= c[s] * b[s + count];
+        }
+    }
+
+    // a failed system only poisons its own lane, the ranges
+    // never share a begin so the workers never share a slot
+    if (!ok) {
+        job->failed[begin] = TRUE;
+    }
+}
+
+BOOL cml_tridiagonal_solve_batch(const float* sub, const float* diagonal,
+                                 const float* super, float* b, cml_u32 n,
+                                 cml_u32 count) {
+    if (n == 0 || count == 0) {
+        return TRUE;
+    }
+
+    cml_tridiagonal_job job;
+    job.sub = sub;
+    job.diagonal = diagonal;
+    job.super = super;
+    job.b = b;
+    job.scratch = malloc((size_t)n * count * sizeof(float));
+    job.n = n;
+    job.failed = calloc(count, sizeof(BOOL));
+    job.count = count;
+
+    if ((cml_u64)n * count < CML_PARALLEL_THRESHOLD) {
+        cml_tridiagonal_range(0, count, &job);
+    } else {
+        cml_parallel_for(0, count, 256, cml_tridiagonal_range, &job);
+    }
+
+    BOOL ret = TRUE;
+    for (cml_u32 s = 0; s < count; s++) {
+        ret &= !job.failed[s];
+    }
+
+    free(job.scratch);
+    free(job.failed);
+    return ret;
+}
+
+cml_banded cml_banded_allocate(cml_u32 n, cml_u32 lower, cml_u32 upper) {
+    cml_banded ret;
+    ret.n = n;
+    ret.lower = lower;
+    ret.upper = upper;
+    ret.stride = 2 * lower + upper + 1;
+    ret.values = calloc((size_t)n * ret.stride, sizeof(float));
+    ret.pivots = malloc(n * sizeof(cml_u32));
+    return ret;
+}
+
+void cml_banded_free(cml_banded* a) {
+    free(a->values);
+    free(a->pivots);
+    a->values = NULL;
+    a->pivots = NULL;
+    a->n = 0;
+}
+
+static float* cml_banded_at(const cml_banded* a, cml_u32 r, cml_u32 c) {
+    return a->values + (size_t)r * a->stride + (c + a->lower - r);
+}
+
+float cml_banded_get(const cml_banded* a, cml_u32 r, cml_u32 c) {
+    assert(r < a->n && c < a->n);
+
+    if (c + a->lower < r || c > r + a->upper) {
+        return 0.0f;
+    }
+    return *cml_banded_at(a, r, c);
+}
+
+void cml_banded_set(cml_banded* a, cml_u32 r, cml_u32 c, float value) {
+    assert(r < a->n && c < a->n);
+    assert(c + a->lower >= r && c <= r + a->upper);
+
+    *cml_banded_at(a, r, c) = value;
+}
+
+void cml_banded_mat_vec(const cml_banded* a, const float* x, float* y) {
+    for (cml_u32 r = 0; r < a->n; r++) {
+        cml_u32 c0 = r > a->lower ? r - a->lower : 0;
+        cml_u32 c1 = r + a->upper < a->n ? r + a->upper + 1 : a->n;
+        const float* row = cml_banded_at(a, r, c0);
+
+        float sum = 0.0f;
+        for (cml_u32 c = c0; c < c1; c++) {
+            sum += row[c - c0] * x[c];
+        }
+        y[r] = sum;
+    }
+}
+
+BOOL cml_banded_lu(cml_banded* a) {
+    cml_u32 n = a->n;
+
+    for (cml_u32 k = 0; k < n; k++) {
+        // rows below k reach column k only within the lower band
+        cml_u32 last_row = k + a->lower < n ? k + a->lower : n - 1;
+        cml_u32 last_col =
+            k + a->upper + a->lower < n ? k + a->upper + a->lower : n - 1;
+
+        cml_u32 p = k;
+        float max = fabsf(*cml_banded_at(a, k, k));
+        for (cml_u32 i = k + 1; i <= last_row; i++) {
+            float v = fabsf(*cml_banded_at(a, i, k));
+            if (v > max) {
+                max = v;
+                p = i;
+            }
+        }
+        if (max == 0.0f) {
+            return FALSE;
+        }
+
+        // the multipliers left of column k stay in place (LINPACK style)
+        a->pivots[k] = p;
+        if (p != k) {
+            for (cml_u32 c = k; c <= last_col; c++) {
+                float* x = cml_banded_at(a, k, c);
+                float* y = cml_banded_at(a, p, c);
+                float tmp = *x;
+                *x = *y;
+                *y = tmp;
+            }
+        }
+
+        float inv = 1.0f / *cml_banded_at(a, k, k);
+        const float* pivot_row = cml_banded_at(a, k, k);
+
+        for (cml_u32 i = k + 1; i <= last_row; i++) {
+            float* row = cml_banded_at(a, i, k);
+            float l = row[0] * inv;
+            row[0] = l;
+
+            if (l != 0.0f) {
+                for (cml_u32 c = 1; c <= last_col - k; c++) {
+                    row[c] -= l * pivot_row[c];
+                }
+            }
+        }
+    }
+    return TRUE;
+}
+
+void cml_banded_lu_solve(const cml_banded* lu, float* b) {
+    cml_u32 n = lu->n;
+
+    // replay the row swaps and eliminations on b
+    for (cml_u32 k = 0; k < n; k++) {
+        cml_u32 p = lu->pivots[k];
+        if (p != k) {
+            float tmp = b[k];
+            b[k] = b[p];
+            b[p] = tmp;
+        }
+
+        cml_u32 last_row = k + lu->lower < n ? k + lu->lower : n - 1;
+        for (cml_u32 i = k + 1; i <= last_row; i++) {
+            b[i] -= *cml_banded_at(lu, i, k) * b[k];
+        }
+    }
+
+    // u has upper + lower super diagonals after the pivoting
+    for (cml_u32 k = n; k-- > 0;) {
+        cml_u32 last_col =
+            k + lu->upper + lu->lower < n ? k + lu->upper + lu->lower : n - 1;
+        const float* row = cml_banded_at(lu, k, k);
+
+        float sum = b[k];
+        for (cml_u32 c = k + 1; c <= last_col; c++) {
+            sum -= row[c - k] * b[c];
+        }
+        b[k] = sum / row[0];
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef CML_BANDED_INCLUDED
+#define CML_BANDED_INCLUDED
+
+#include "internal/cml_core.h"
+
+/*
+    NOTE: "sub" and "super" have n - 1 elements, "diagonal"
+          and "b" n elements.
+
+    Solves the tridiagonal system with the sub diagonal
+    "sub" (rows 1 .. n - 1), the "diagonal" and the super
+    diagonal "super" (rows 0 .. n - 2) with the Thomas
+    algorithm in O(n) and overwrites "b" with the solution.
+    "scratch" has to hold n floats (NULL allocates them).
+
+    There is no pivoting, which is stable for diagonally
+    dominant or symmetric positive definite systems (splines,
+    implicit diffusion). Returns FALSE if a pivot is zero,
+    use cml_banded_lu() for other systems.
+*/
+BOOL cml_tridiagonal_solve(const float* sub, const float* diagonal,
+                           const float* super, float* b, cml_u32 n,
+                           float* scratch);
+
+/*
+    Solves "count" independent tridiagonal systems of size n
+    (see cml_tridiagonal_solve()). The systems are
+    interleaved: element i of system s is at [i * count + s]
+    in all arrays (sub and super have n - 1 rows of "count"
+    elements), so every step works on contiguous lanes of
+    systems. Large batches run on the thread pool. Returns
+    FALSE if any of the systems has a zero pivot.
+*/
+BOOL cml_tridiagonal_solve_batch(const float* sub, const float* diagonal,
+                                 const float* super, float* b, cml_u32 n,
+                                 cml_u32 count);
+
+/*
+    n x n band matrix with "lower" sub and "upper" super
+    diagonals. Row r stores the columns r - lower up to
+    r + upper + lower at values[r * stride + c - r + lower],
+    the last "lower" slots of every row take the fill-in of
+    the pivoting in cml_banded_lu(). Memory is
+    O(n * (2 * lower + upper + 1)).
+*/
+typedef struct {
+    cml_u32 n;
+    cml_u32 lower, upper;
+    cml_u32 stride;
+    float* values;
+    cml_u32* pivots;
+} cml_banded;
+
+/*
+    Returns a zero initialized band matrix.
+*/
+cml_banded cml_banded_allocate(cml_u32 n, cml_u32 lower, cml_u32 upper);
+
+void cml_banded_free(cml_banded* a);
+
+/*
+    Returns (r, c), 0 outside of the band.
+*/
+float cml_banded_get(const cml_banded* a, cml_u32 r, cml_u32 c);
+
+/*
+    NOTE: (r, c) has to lie in the band.
+*/
+void cml_banded_set(cml_banded* a, cml_u32 r, cml_u32 c, float value);
+
+/*
+    y = a * x. "a" must not be factored.
+*/
+void cml_banded_mat_vec(const cml_banded* a, const float* x, float* y);
+
+/*
+    Replaces "a" with its LU factorization with partial
+    pivoting in O(n * lower * (lower + upper)). Returns FALSE
+    if "a" is singular. "a" is then left partly factored, the
+    columns before the first zero pivot are eliminated and
+    the rest is modified, so it can neither be passed to
+    cml_banded_lu_solve() nor factored again.
+*/
+BOOL cml_banded_lu(cml_banded* a);
+
+/*
+    Solves a * x = b with the factorization from
+    cml_banded_lu() and overwrites "b" with x.
+*/
+void cml_banded_lu_solve(const cml_banded* lu, float* b);
+
+#endif  // CML_BANDED_INCLUDED
@@ -0,0 +1,554 @@
+#include "bvh.h"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal/cml_simd.h"
+#include "parallel.h"
+
+/*
+    Depth from which nodes are split at the median instead
+    of the SAH, and the resulting bound on the tree depth.
+*/
+#define CML_BVH_SAH_DEPTH 32
+#define CML_BVH_MAX_DEPTH 64
+
+/*
+    Cost of a traversal step relative to a triangle test.
+*/
+#define CML_BVH_TRAVERSAL_COST 1.0f
+
+typedef struct {
+    float min[3];
+    float max[3];
+} cml_bvh_box;
+
+static void cml_bvh_box_empty(cml_bvh_box* b) {
+    for (cml_u32 a = 0; a < 3; a++) {
+        b->min[a] = FLT_MAX;
+        b->max[a] = -FLT_MAX;
+    }
+}
+
+static void cml_bvh_box_grow(cml_bvh_box* b, const float* min,
+                             const float* max) {
+    for (cml_u32 a = 0; a < 3; a++) {
+        b->min[a] = min[a] < b->min[a] ? min[a] : b->min[a];
+        b->max[a] = max[a] > b->max[a] ? max[a] : b->max[a];
+    }
+}
+
+static float cml_bvh_box_area(const cml_bvh_box* b) {
+    float x = b->max[0] - b->min[0];
+    float y = b->max[1] - b->min[1];
+    float z = b->max[2] - b->min[2];
+    return x * y + y * z + z * x;
+}
+
+typedef struct {
+    cml_bvh* bvh;
+    cml_bvh_box* bounds;
+    float* centroids;
+    cml_u32* order;
+} cml_bvh_build_job;
+
+static cml_u32 cml_bvh_bin(float c, float min, float scale) {
+    cml_u32 bin = (cml_u32)((c - min) * scale);
+    return bin < CML_BVH_BINS ? bin : CML_BVH_BINS - 1;
+}
+
+static void cml_bvh_build_node(cml_bvh_build_job* job, cml_u32 begin,
+                               cml_u32 end, cml_u32 depth) {
+    cml_bvh* bvh = job->bvh;
+    cml_u32 node = bvh->node_count++;
+    cml_u32 n = end - begin;
+
+    cml_bvh_box box, centroid_box;
+    cml_bvh_box_empty(&box);
+    cml_bvh_box_empty(&centroid_box);
+    for (cml_u32 i = begin; i < end; i++) {
+        const cml_bvh_box* b = job->bounds + job->order[i];
+        const float* c = job->centroids + 3 * (size_t)job->order[i];
+        cml_bvh_box_grow(&box, b->min, b->max);
+        cml_bvh_box_grow(&centroid_box, c, c);
+    }
+
+    cml_bvh_node* out = bvh->nodes + node;
+    memcpy(out->min, box.min, sizeof(box.min));
+    memcpy(out->max, box.max, sizeof(box.max));
+
+    if (n <= 1) {
+        out->first = begin;
+        out->count = (cml_u16)n;
+        out->axis = 0;
+        return;
+    }
+
+    // best SAH split over the bins of all 3 axes
+    float best_cost = FLT_MAX;
+    cml_u32 best_axis = 0, best_bin = 0;
+
+    for (cml_u32 a = 0; a < 3 && depth < CML_BVH_SAH_DEPTH; a++) {
+        float extent = centroid_box.max[a] - centroid_box.min[a];
+        if (extent <= 0.0f) {
+            continue;
+        }
+        float scale = CML_BVH_BINS / extent;
+
+        cml_u32 counts[CML_BVH_BINS] = {0};
+        cml_bvh_box bins[CML_BVH_BINS];
+        for (cml_u32 b = 0; b < CML_BVH_BINS; b++) {
+            cml_bvh_box_empty(&bins[b]);
+        }
+        for (cml_u32 i = begin; i < end; i++) {
+            cml_u32 t = job->order[i];
+            cml_u32 b = cml_bvh_bin(job->centroids[3 * (size_t)t + a],
+                                    centroid_box.min[a], scale);
+            counts[b]++;
+            cml_bvh_box_grow(&bins[b], job->bounds[t].min, job->bounds[t].max);
+        }
+
+        // right_cost[b] covers the bins b .. CML_BVH_BINS - 1
+        float right_cost[CML_BVH_BINS];
+        cml_bvh_box acc;
+        cml_bvh_box_empty(&acc);
+        cml_u32 count = 0;
+        for (cml_u32 b = CML_BVH_BINS; b-- > 1;) {
+            count += counts[b];
+            cml_bvh_box_grow(&acc, bins[b].min, bins[b].max);
+            right_cost[b] = count > 0 ? count * cml_bvh_box_area(&acc) : 0.0f;
+        }
+
+        cml_bvh_box_empty(&acc);
+        count = 0;
+        for (cml_u32 b = 1; b < CML_BVH_BINS; b++) {
+            count += counts[b - 1];
+            cml_bvh_box_grow(&acc, bins[b - 1].min, bins[b - 1].max);
+            if (count == 0 || count == n) {
+                continue;
+            }
+
+            float cost = count * cml_bvh_box_area(&acc) + right_cost[b];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = a;
+                best_bin = b;
+            }
+        }
+    }
+
+    float area = cml_bvh_box_area(&box);
+    float leaf_cost = n * area;
+    best_cost += CML_BVH_TRAVERSAL_COST * area;
+
+    if (n <= CML_BVH_MAX_LEAF_SIZE && leaf_cost <= best_cost) {
+        out->first = begin;
+        out->count = (cml_u16)n;
+        out->axis = 0;
+        return;
+    }
+
+    cml_u32 mid;
+    if (best_cost < FLT_MAX) {
+        float scale = CML_BVH_BINS / (centroid_box.max[best_axis] -
+                                      centroid_box.min[best_axis]);
+
+        cml_u32 i = begin, j = end;
+        while (i < j) {
+            cml_u32 t = job->order[i];
+            cml_u32 b = cml_bvh_bin(job->centroids[3 * (size_t)t + best_axis],
+                                    centroid_box.min[best_axis], scale);
+            if (b < best_bin) {
+                i++;
+            } else {
+                job->order[i] = job->order[--j];
+                job->order[j] = t;
+            }
+        }
+        mid = i;
+    } else {
+        // no SAH split (too deep or equal centroids): halve along the
+        // widest centroid axis
+        best_axis = 0;
+        for (cml_u32 a = 1; a < 3; a++) {
+            if (centroid_box.max[a] - centroid_box.min[a] >
+                centroid_box.max[best_axis] - centroid_box.min[best_axis]) {
+                best_axis = a;
+            }
+        }
+        mid = begin + n / 2;
+
+        // a nth element selection on the centroids of the axis
+        cml_u32 lo = begin, hi = end - 1;
+        while (lo < hi) {
+            float pivot = job->centroids[3 * (size_t)job->order[(lo + hi) / 2] +
+                                         best_axis];
+            cml_u32 i = lo, j = hi;
+            while (i <= j) {
+                while (job->centroids[3 * (size_t)job->order[i] + best_axis] <
+                       pivot) {
+                    i++;
+                }
+                while (job->centroids[3 * (size_t)job->order[j] + best_axis] >
+                       pivot) {
+                    j--;
+                }
+                if (i <= j) {
+                    cml_u32 t = job->order[i];
+                    job->order[i] = job->order[j];
+                    job->order[j] = t;
+                    i++;
+                    if (j == 0) {
+                        break;
+                    }
+                    j--;
+                }
+            }
+            if (mid <= j) {
+                hi = j;
+            } else if (mid >= i) {
+                lo = i;
+            } else {
+                break;
+            }
+        }
+    }
+
+    cml_bvh_build_node(job, begin, mid, depth + 1);
+    out = bvh->nodes + node;
+    out->first = bvh->node_count;
+    out->count = 0;
+    out->axis = (cml_u16)best_axis;
+    cml_bvh_build_node(job, mid, end, depth + 1);
+}
+
+cml_bvh cml_bvh_build(const float* vertices, const cml_u32* indices,
+                      cml_u32 count) {
+    cml_bvh ret;
+    ret.count = count;
+    ret.node_count = 0;
+    ret.nodes = malloc((2 * (size_t)count + 1) * sizeof(cml_bvh_node));
+    ret.triangles = malloc(9 * (size_t)count * sizeof(float));
+    ret.indices = malloc(count * sizeof(cml_u32));
+
+    cml_bvh_build_job job;
+    job.bvh = &ret;
+    job.bounds = malloc(count * sizeof(cml_bvh_box));
+    job.centroids = malloc(3 * (size_t)count * sizeof(float));
+    job.order = ret.indices;
+
+    for (cml_u32 t = 0; t < count; t++) {
+        cml_bvh_box_empty(&job.bounds[t]);
+        for (cml_u32 k = 0; k < 3; k++) {
+            size_t v = indices ? indices[3 * (size_t)t + k] : 3 * (size_t)t + k;
+            const float* p = vertices + 3 * v;
+            cml_bvh_box_grow(&job.bounds[t], p, p);
+        }
+        for (cml_u32 a = 0; a < 3; a++) {
+            job.centroids[3 * (size_t)t + a] =
+                0.5f * (job.bounds[t].min[a] + job.bounds[t].max[a]);
+        }
+        job.order[t] = t;
+    }
+
+    if (count > 0) {
+        cml_bvh_build_node(&job, 0, count, 0);
+    }
+
+    // the triangles in leaf order, prepared for Moller-Trumbore
+    for (cml_u32 i = 0; i < count; i++) {
+        cml_u32 t = ret.indices[i];
+        const float* p[3];
+        for (cml_u32 k = 0; k < 3; k++) {
+            size_t v = indices ? indices[3 * (size_t)t + k] : 3 * (size_t)t + k;
+            p[k] = vertices + 3 * v;
+        }
+
+        float* out = ret.triangles + 9 * (size_t)i;
+        for (cml_u32 a = 0; a < 3; a++) {
+            out[a] = p[0][a];
+            out[3 + a] = p[1][a] - p[0][a];
+            out[6 + a] = p[2][a] - p[0][a];
+        }
+    }
+
+    free(job.bounds);
+    free(job.centroids);
+    return ret;
+}
+
+cml_bvh cml_bvh_build_vectors(const vector* vertices, cml_u32 vertex_count,
+                              const cml_u32* indices, cml_u32 count) {
+    float* packed = malloc(3 * (size_t)vertex_count * sizeof(float));
+
+    for (cml_u32 i = 0; i < vertex_count; i++) {
+        assert(vertices[i].dimension == 3);
+        memcpy(packed + 3 * (size_t)i, vertices[i].values, 3 * sizeof(float));
+    }
+
+    cml_bvh ret = cml_bvh_build(packed, indices, count);
+    free(packed);
+    return ret;
+}
+
+void cml_bvh_free(cml_bvh* bvh) {
+    free(bvh->nodes);
+    free(bvh->triangles);
+    free(bvh->indices);
+    bvh->nodes = NULL;
+    bvh->triangles = NULL;
+    bvh->indices = NULL;
+    bvh->node_count = 0;
+    bvh->count = 0;
+}
+
+// a * b - c * d, one component of a cross product
+static inline cml_lane cml_bvh_cross(cml_lane a, cml_lane b, cml_lane c,
+                                     cml_lane d) {
+    return cml_lane_sub(cml_lane_mul(a, b), cml_lane_mul(c, d));
+}
+
+static inline cml_lane cml_bvh_dot(cml_lane ax, cml_lane ay, cml_lane az,
+                                   cml_lane bx, cml_lane by, cml_lane bz) {
+    cml_lane xy = cml_lane_add(cml_lane_mul(ax, bx), cml_lane_mul(ay, by));
+    return cml_lane_add(xy, cml_lane_mul(az, bz));
+}
+
+/*
+    Traces up to CML_LANE_WIDTH rays as one packet. Returns the
+    lanes that hit something; closest hits are written to
+    "hits" unless "any_hit" is TRUE, in which case a lane
+    stops at its first hit.
+*/
+static cml_u32 cml_bvh_trace(const cml_bvh* bvh, const float* origins,
+                             const float* directions, const float* t_max,
+                             cml_u32 count, BOOL any_hit, cml_bvh_hit* hits) {
+    if (bvh->count == 0) {
+        for (cml_u32 l = 0; hits && l < count; l++) {
+            hits[l].triangle = CML_BVH_MISS;
+        }
+        return 0;
+    }
+
+    float lanes[7][CML_LANE_WIDTH];
+    for (cml_u32 l = 0; l < CML_LANE_WIDTH; l++) {
+        for (cml_u32 a = 0; a < 3; a++) {
+            lanes[a][l] = l < count ? origins[3 * l + a] : 0.0f;
+            lanes[3 + a][l] = l < count ? directions[3 * l + a] : 1.0f;
+        }
+        // unused lanes fail every test
+        lanes[6][l] = l >= count ? -1.0f : t_max ? t_max[l] : INFINITY;
+    }
+
+    cml_lane o[3], d[3], inv[3];
+    for (cml_u32 a = 0; a < 3; a++) {
+        o[a] = cml_lane_load(lanes[a]);
+        d[a] = cml_lane_load(lanes[3 + a]);
+        inv[a] = cml_lane_div(cml_lane_set(1.0f), d[a]);
+    }
+    cml_lane t_far = cml_lane_load(lanes[6]);
+    cml_lane hit_u = cml_lane_set(0.0f), hit_v = cml_lane_set(0.0f);
+    cml_lane zero = cml_lane_set(0.0f), one = cml_lane_set(1.0f);
+
+    cml_u32 triangle[CML_LANE_WIDTH];
+    for (cml_u32 l = 0; l < CML_LANE_WIDTH; l++) {
+        triangle[l] = CML_BVH_MISS;
+    }
+    cml_u32 all = (1u << count) - 1;
+    cml_u32 hit_lanes = 0;
+
+    // the near child is picked by the direction of the first ray
+    BOOL negative[3];
+    for (cml_u32 a = 0; a < 3; a++) {
+        negative[a] = directions[a] < 0.0f;
+    }
+
+    cml_u32 stack[CML_BVH_MAX_DEPTH + 1];
+    cml_u32 top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        cml_u32 index = stack[--top];
+        const cml_bvh_node* node = bvh->nodes + index;
+
+        // slab test of all lanes
+        cml_lane t_min = zero, t_max_lane = t_far;
+        for (cml_u32 a = 0; a < 3; a++) {
+            cml_lane lo = cml_lane_sub(cml_lane_set(node->min[a]), o[a]);
+            cml_lane hi = cml_lane_sub(cml_lane_set(node->max[a]), o[a]);
+            cml_lane t1 = cml_lane_mul(lo, inv[a]);
+            cml_lane t2 = cml_lane_mul(hi, inv[a]);
+            t_min = cml_lane_max(t_min, cml_lane_min(t1, t2));
+            t_max_lane = cml_lane_min(t_max_lane, cml_lane_max(t1, t2));
+        }
+        if (!cml_lane_bits(cml_lane_le(t_min, t_max_lane))) {
+            continue;
+        }
+
+        if (node->count == 0) {
+            cml_u32 left = index + 1, right = node->first;
+            BOOL flip = negative[node->axis];
+            stack[top++] = flip ? left : right;
+            stack[top++] = flip ? right : left;
+            continue;
+        }
+
+        for (cml_u32 i = node->first; i < node->first + node->count; i++) {
+            const float* tri = bvh->triangles + 9 * (size_t)i;
+            cml_lane e1x = cml_lane_set(tri[3]), e1y = cml_lane_set(tri[4]),
+                     e1z = cml_lane_set(tri[5]);
+            cml_lane e2x = cml_lane_set(tri[6]), e2y = cml_lane_set(tri[7]),
+                     e2z = cml_lane_set(tri[8]);
+
+            // Moller-Trumbore
+            cml_lane px = cml_bvh_cross(d[1], e2z, d[2], e2y);
+            cml_lane py = cml_bvh_cross(d[2], e2x, d[0], e2z);
+            cml_lane pz = cml_bvh_cross(d[0], e2y, d[1], e2x);
+            cml_lane det = cml_bvh_dot(e1x, e1y, e1z, px, py, pz);
+            cml_lane inv_det = cml_lane_div(one, det);
+
+            cml_lane tx = cml_lane_sub(o[0], cml_lane_set(tri[0]));
+            cml_lane ty = cml_lane_sub(o[1], cml_lane_set(tri[1]));
+            cml_lane tz = cml_lane_sub(o[2], cml_lane_set(tri[2]));
+            cml_lane u =
+                cml_lane_mul(cml_bvh_dot(tx, ty, tz, px, py, pz), inv_det);
+
+            cml_lane qx = cml_bvh_cross(ty, e1z, tz, e1y);
+            cml_lane qy = cml_bvh_cross(tz, e1x, tx, e1z);
+            cml_lane qz = cml_bvh_cross(tx, e1y, ty, e1x);
+            cml_lane v = cml_lane_mul(
+                cml_bvh_dot(d[0], d[1], d[2], qx, qy, qz), inv_det);
+            cml_lane t =
+                cml_lane_mul(cml_bvh_dot(e2x, e2y, e2z, qx, qy, qz), inv_det);
+
+            // NaNs of a degenerate determinant fail the comparisons
+            cml_lane mask = cml_lane_lt(zero, cml_lane_mul(det, det));
+            mask = cml_lane_and(mask, cml_lane_le(zero, u));
+            mask = cml_lane_and(mask, cml_lane_le(zero, v));
+            mask = cml_lane_and(mask, cml_lane_le(cml_lane_add(u, v), one));
+            mask = cml_lane_and(mask, cml_lane_lt(zero, t));
+            mask = cml_lane_and(mask, cml_lane_lt(t, t_far));
+
+            cml_u32 bits = cml_lane_bits(mask);
+            if (!bits) {
+                continue;
+            }
+            hit_lanes |= bits;
+
+            if (any_hit) {
+                // finished lanes fail every further test
+                t_far = cml_lane_select(mask, cml_lane_set(-1.0f), t_far);
+                if (hit_lanes == all) {
+                    return hit_lanes;
+                }
+                continue;
+            }
+
+            t_far = cml_lane_select(mask, t, t_far);
+            hit_u = cml_lane_select(mask, u, hit_u);
+            hit_v = cml_lane_select(mask, v, hit_v);
+            for (cml_u32 l = 0; l < CML_LANE_WIDTH; l++) {
+                if (bits & (1u << l)) {
+                    triangle[l] = bvh->indices[i];
+                }
+            }
+        }
+    }
+
+    if (!any_hit) {
+        cml_lane_store(lanes[0], t_far);
+        cml_lane_store(lanes[1], hit_u);
+        cml_lane_store(lanes[2], hit_v);
+        for (cml_u32 l = 0; l < count; l++) {
+            hits[l].triangle = triangle[l];
+            if (triangle[l] != CML_BVH_MISS) {
+                hits[l].t = lanes[0][l];
+                hits[l].u = lanes[1][l];
+                hits[l].v = lanes[2][l];
+            }
+        }
+    }
+    return hit_lanes;
+}
+
+BOOL cml_bvh_intersect(const cml_bvh* bvh, const float* origin,
+                       const float* direction, float t_max, cml_bvh_hit* hit) {
+    return cml_bvh_trace(bvh, origin, direction, &t_max, 1, FALSE, hit) != 0;
+}
+
+BOOL cml_bvh_occluded(const cml_bvh* bvh, const float* origin,
+                      const float* direction, float t_max) {
+    return cml_bvh_trace(bvh, origin, direction, &t_max, 1, TRUE, NULL) != 0;
+}
+
+typedef struct {
+    const cml_bvh* bvh;
+    const float* origins;
+    const float* directions;
+    const float* t_max;
+    cml_u32 count;
+    cml_bvh_hit* hits;
+    cml_u32* occluded;
+} cml_bvh_rays_job;
+
+/*
+    Traces the rays of the mask words begin .. end - 1, so
+    no two threads write to the same word.
+*/
+static void cml_bvh_rays_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_bvh_rays_job* job = arg;
+
+    for (cml_u32 w = begin; w < end; w++) {
+        cml_u32 word = 0;
+        cml_u32 last = 32 * w + 32 < job->count ? 32 * w + 32 : job->count;
+
+        for (cml_u32 r = 32 * w; r < last; r += CML_LANE_WIDTH) {
+            cml_u32 n = last - r < CML_LANE_WIDTH ? last - r : CML_LANE_WIDTH;
+            cml_u32 bits = cml_bvh_trace(
+                job->bvh, job->origins + 3 * (size_t)r,
+                job->directions + 3 * (size_t)r,
+                job->t_max ? job->t_max + r : NULL, n, job->occluded != NULL,
+                job->hits ? job->hits + r : NULL);
+            word |= bits << (r - 32 * w);
+        }
+
+        if (job->occluded) {
+            job->occluded[w] = word;
+        }
+    }
+}
+
+void cml_bvh_intersect_rays(const cml_bvh* bvh, const float* origins,
+                            const float* directions, const float* t_max,
+                            cml_u32 count, cml_bvh_hit* hits) {
+    cml_bvh_rays_job job;
+    job.bvh = bvh;
+    job.origins = origins;
+    job.directions = directions;
+    job.t_max = t_max;
+    job.count = count;
+    job.hits = hits;
+    job.occluded = NULL;
+
+    cml_parallel_for(0, CML_BVH_MASK_WORDS(count), 4, cml_bvh_rays_range,
+                     &job);
+}
+
+void cml_bvh_occluded_rays(const cml_bvh* bvh, const float* origins,
+                           const float* directions, const float* t_max,
+                           cml_u32 count, cml_u32* occluded) {
+    cml_bvh_rays_job job;
+    job.bvh = bvh;
+    job.origins = origins;
+    job.directions = directions;
+    job.t_max = t_max;
+    job.count = count;
+    job.hits = NULL;
+    job.occluded = occluded;
+
+    cml_parallel_for(0, CML_BVH_MASK_WORDS(count), 4, cml_bvh_rays_range,
+                     &job);
+}
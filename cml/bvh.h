@@ -0,0 +1,135 @@
+#ifndef CML_BVH_INCLUDED
+#define CML_BVH_INCLUDED
+
+#include "internal/cml_core.h"
+#include "vector.h"
+
+/*
+    Maximum number of triangles in a leaf.
+*/
+#define CML_BVH_MAX_LEAF_SIZE 8
+
+/*
+    Number of centroid bins per axis the SAH is evaluated
+    on.
+*/
+#define CML_BVH_BINS 16
+
+/*
+    "triangle" of a ray that hits nothing.
+*/
+#define CML_BVH_MISS 0xffffffffu
+
+/*
+    Node of the hierarchy, 32 bytes. The nodes are stored
+    depth first: the left child of an inner node i is node
+    i + 1, "first" is its right child and "axis" the axis
+    it was split on. A leaf (count > 0) holds the triangles
+    first .. first + count - 1.
+*/
+typedef struct {
+    float min[3];
+    cml_u32 first;
+    float max[3];
+    cml_u16 count;
+    cml_u16 axis;
+} cml_bvh_node;
+
+/*
+    Bounding volume hierarchy over "count" triangles. The
+    triangles are stored in leaf order as v0, v1 - v0,
+    v2 - v0 (9 floats each), indices[i] is the input index
+    of the i-th stored triangle.
+*/
+typedef struct {
+    cml_bvh_node* nodes;
+    cml_u32 node_count;
+    float* triangles;
+    cml_u32* indices;
+    cml_u32 count;
+} cml_bvh;
+
+/*
+    Closest hit of a ray: the distance "t" in units of the
+    direction and the barycentric coordinates "u" / "v" of
+    v1 / v2. "triangle" is the input index of the triangle
+    or CML_BVH_MISS, the other members are only set on a
+    hit.
+*/
+typedef struct {
+    float t;
+    float u, v;
+    cml_u32 triangle;
+} cml_bvh_hit;
+
+/*
+    Builds the hierarchy over "count" triangles of the
+    interleaved xyz array "vertices". Triangle i has the
+    vertices indices[3 * i .. 3 * i + 2]; if "indices" is
+    NULL the vertices are read as 3 per triangle.
+
+    Nodes are split at the lowest surface area heuristic
+    cost over CML_BVH_BINS bins of the triangle centroids.
+    Below a depth of 32 the split falls back to the median,
+    which bounds the depth of the tree by 64.
+*/
+cml_bvh cml_bvh_build(const float* vertices, const cml_u32* indices,
+                      cml_u32 count);
+
+/*
+    Same as cml_bvh_build() for an array of 3D vectors.
+*/
+cml_bvh cml_bvh_build_vectors(const vector* vertices, cml_u32 vertex_count,
+                              const cml_u32* indices, cml_u32 count);
+
+void cml_bvh_free(cml_bvh* bvh);
+
+/*
+    Finds the closest triangle hit by the ray from "origin"
+    along "direction" (3 floats each) with 0 < t < t_max.
+    Triangles are hit from both sides. Returns FALSE if
+    there is no hit.
+*/
+BOOL cml_bvh_intersect(const cml_bvh* bvh, const float* origin,
+                       const float* direction, float t_max, cml_bvh_hit* hit);
+
+/*
+    Returns TRUE if any triangle is hit with 0 < t < t_max,
+    which stops at the first hit (shadow and occlusion
+    rays).
+*/
+BOOL cml_bvh_occluded(const cml_bvh* bvh, const float* origin,
+                      const float* direction, float t_max);
+
+/*
+    Size in cml_u32 words of an occlusion mask for "count"
+    rays.
+*/
+#define CML_BVH_MASK_WORDS(count) (((count) + 31) / 32)
+
+/*
+    Traces "count" rays (interleaved xyz "origins" and
+    "directions", "t_max" per ray or NULL for no limit) and
+    writes the closest hit of ray i to hits[i].
+
+    The rays are traced in packets of 4 (SSE) or 8 (AVX)
+    through the hierarchy, every node and triangle is tested
+    against all rays of a packet at once. Coherent rays
+    (camera rays of neighboring pixels) traverse best.
+    Packets run on the thread pool.
+*/
+void cml_bvh_intersect_rays(const cml_bvh* bvh, const float* origins,
+                            const float* directions, const float* t_max,
+                            cml_u32 count, cml_bvh_hit* hits);
+
+/*
+    Same as cml_bvh_intersect_rays() for occlusion. Bit
+    i % 32 of occluded[i / 32] is set if ray i hits
+    something, "occluded" needs CML_BVH_MASK_WORDS(count)
+    words.
+*/
+void cml_bvh_occluded_rays(const cml_bvh* bvh, const float* origins,
+                           const float* directions, const float* t_max,
+                           cml_u32 count, cml_u32* occluded);
+
+#endif  // CML_BVH_INCLUDED
@@ -1,4 +1,26 @@
+#include "affine.h"
+#include "banded.h"
+#include "bvh.h"
+#include "curve.h"
+#include "frustum.h"
+#include "iterative.h"
+#include "kdtree.h"
+#include "mat4_batch.h"
 #include "matrix.h"
+#include "matrix_eigen.h"
+#include "matrix_factor.h"
+#include "matrix_io.h"
+#include "matrix_ooc.h"
+#include "matrix_strassen.h"
+#include "matrix_svd.h"
 #include "matrix_transform.h"
+#include "packed.h"
+#include "pairwise.h"
+#include "parallel.h"
+#include "quantized.h"
 #include "radians.h"
-#include "vector.h"
\ No newline at end of file
+#include "reduce.h"
+#include "skinning.h"
+#include "sparse.h"
+#include "vector.h"
+#include "vmath.h"
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "internal/cml_elementwise.h"
+
+#include <stddef.h>
+
+#include "parallel.h"
+
+typedef struct {
+    float* dst;
+    const float* src1;
+    const float* src2;
+    float scaler;
+    cml_elementwise_op op;
+} cml_elementwise_job;
+
+typedef struct {
+    float** dst;
+    float** src1;
+    float** src2;
+    float scaler;
+    cml_elementwise_op op;
+    cml_u32 cols;
+} cml_elementwise_rows_job;
+
+static void cml_elementwise_kernel(float* dst, const float* src1,
+                                   const float* src2, float scaler,
+                                   cml_elementwise_op op, cml_u32 begin,
+                                   cml_u32 end) {
+    // one loop per operation so each of them vectorizes
+    switch (op) {
+        case CML_OP_ADD_SCALER:
+            for (cml_u32 i = begin; i < end; i++) {
+                dst[i] = src1[i] + scaler;
+            }
+            break;
+        case CML_OP_SUBST_SCALER:
+            for (cml_u32 i = begin; i < end; i++) {
+                dst[i] = src1[i] - scaler;
+            }
+            break;
+        case CML_OP_MULT_SCALER:
+            for (cml_u32 i = begin; i < end; i++) {
+                dst[i] = src1[i] * scaler;
+            }
+            break;
+        case CML_OP_DIV_SCALER:
+            for (cml_u32 i = begin; i < end; i++) {
+                dst[i] = src1[i] / scaler;
+            }
+            break;
+        case CML_OP_ADD:
+            for (cml_u32 i = begin; i < end; i++) {
+                dst[i] = src1[i] + src2[i];
+            }
+            break;
+        case CML_OP_SUBST:
+            for (cml_u32 i = begin; i < end; i++) {
+                dst[i] = src1[i] - src2[i];
+            }
+            break;
+        case CML_OP_MULT:
+            for (cml_u32 i = begin; i < end; i++) {
+                dst[i] = src1[i] * src2[i];
+            }
+            break;
+        case CML_OP_DIV:
+            for (cml_u32 i = begin; i < end; i++) {
+                dst[i] = src1[i] / src2[i];
+            }
+            break;
+    }
+}
+
+static void cml_elementwise_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_elementwise_job* job = arg;
+
+    cml_elementwise_kernel(job->dst, job->src1, job->src2, job->scaler,
+                           job->op, begin, end);
+}
+
+static void cml_elementwise_rows_range(cml_u32 begin, cml_u32 end,
+                                       void* arg) {
+    cml_elementwise_rows_job* job = arg;
+
+    for (cml_u32 r = begin; r < end; r++) {
+        cml_elementwise_kernel(job->dst[r], job->src1[r],
+                               job->src2 ? job->src2[r] : NULL, job->scaler,
+                               job->op, 0, job->cols);
+    }
+}
+
+void cml_elementwise(float* dst, const float* src1, const float* src2,
+                     float scaler, cml_elementwise_op op, cml_u32 count) {
+    if (count < CML_PARALLEL_THRESHOLD) {
+        cml_elementwise_kernel(dst, src1, src2, scaler, op, 0, count);
+        return;
+    }
+
+    cml_elementwise_job job = {dst, src1, src2, scaler, op};
+    cml_parallel_for(0, count, 0, cml_elementwise_range, &job);
+}
+
+void cml_elementwise_rows(float** dst, float** src1, float** src2,
+                          float scaler, cml_elementwise_op op, cml_u32 rows,
+                          cml_u32 cols) {
+    cml_elementwise_rows_job job = {dst, src1, src2, scaler, op, cols};
+
+    if ((cml_u64)rows * cols < CML_PARALLEL_THRESHOLD) {
+        cml_elementwise_rows_range(0, rows, &job);
+        return;
+    }
+
+    cml_parallel_for(0, rows, 0, cml_elementwise_rows_range, &job);
+}
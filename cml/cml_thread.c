@@ -0,0 +1,142 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "internal/cml_thread.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+typedef struct {
+    cml_thread_fn fn;
+    void* arg;
+} cml_thread_start;
+
+#ifdef _WIN32
+
+static DWORD WINAPI cml_thread_entry(LPVOID param) {
+    cml_thread_start start = *(cml_thread_start*)param;
+    free(param);
+
+    start.fn(start.arg);
+    return 0;
+}
+
+BOOL cml_thread_create(cml_thread* thread, cml_thread_fn fn, void* arg) {
+    cml_thread_start* start = malloc(sizeof(cml_thread_start));
+    start->fn = fn;
+    start->arg = arg;
+
+    thread->handle = CreateThread(NULL, 0, cml_thread_entry, start, 0, NULL);
+    if (!thread->handle) {
+        free(start);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void cml_thread_join(cml_thread* thread) {
+    WaitForSingleObject((HANDLE)thread->handle, INFINITE);
+    CloseHandle((HANDLE)thread->handle);
+}
+
+cml_u32 cml_thread_hardware_concurrency(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
+// SRWLOCK and CONDITION_VARIABLE are pointer sized and zero initialized
+
+void cml_mutex_init(cml_mutex* mutex) {
+    InitializeSRWLock((PSRWLOCK)&mutex->handle);
+}
+
+void cml_mutex_destroy(cml_mutex* mutex) { (void)mutex; }
+
+void cml_mutex_lock(cml_mutex* mutex) {
+    AcquireSRWLockExclusive((PSRWLOCK)&mutex->handle);
+}
+
+void cml_mutex_unlock(cml_mutex* mutex) {
+    ReleaseSRWLockExclusive((PSRWLOCK)&mutex->handle);
+}
+
+void cml_cond_init(cml_cond* cond) {
+    InitializeConditionVariable((PCONDITION_VARIABLE)&cond->handle);
+}
+
+void cml_cond_destroy(cml_cond* cond) { (void)cond; }
+
+void cml_cond_wait(cml_cond* cond, cml_mutex* mutex) {
+    SleepConditionVariableSRW((PCONDITION_VARIABLE)&cond->handle,
+                              (PSRWLOCK)&mutex->handle, INFINITE, 0);
+}
+
+void cml_cond_broadcast(cml_cond* cond) {
+    WakeAllConditionVariable((PCONDITION_VARIABLE)&cond->handle);
+}
+
+#else
+
+static void* cml_thread_entry(void* param) {
+    cml_thread_start start = *(cml_thread_start*)param;
+    free(param);
+
+    start.fn(start.arg);
+    return NULL;
+}
+
+BOOL cml_thread_create(cml_thread* thread, cml_thread_fn fn, void* arg) {
+    cml_thread_start* start = malloc(sizeof(cml_thread_start));
+    start->fn = fn;
+    start->arg = arg;
+
+    if (pthread_create(&thread->handle, NULL, cml_thread_entry, start) != 0) {
+        free(start);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void cml_thread_join(cml_thread* thread) { pthread_join(thread->handle, NULL); }
+
+cml_u32 cml_thread_hardware_concurrency(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return count > 0 ? (cml_u32)count : 1;
+}
+
+void cml_mutex_init(cml_mutex* mutex) {
+    pthread_mutex_init(&mutex->handle, NULL);
+}
+
+void cml_mutex_destroy(cml_mutex* mutex) {
+    pthread_mutex_destroy(&mutex->handle);
+}
+
+void cml_mutex_lock(cml_mutex* mutex) { pthread_mutex_lock(&mutex->handle); }
+
+void cml_mutex_unlock(cml_mutex* mutex) {
+    pthread_mutex_unlock(&mutex->handle);
+}
+
+void cml_cond_init(cml_cond* cond) { pthread_cond_init(&cond->handle, NULL); }
+
+void cml_cond_destroy(cml_cond* cond) { pthread_cond_destroy(&cond->handle); }
+
+void cml_cond_wait(cml_cond* cond, cml_mutex* mutex) {
+    pthread_cond_wait(&cond->handle, &mutex->handle);
+}
+
+void cml_cond_broadcast(cml_cond* cond) {
+    pthread_cond_broadcast(&cond->handle);
+}
+
+#endif
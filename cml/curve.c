@@ -0,0 +1,223 @@
+#include "curve.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "internal/cml_simd.h"
+
+/*
+    Power basis of the segments: control k is weighted with
+    basis[type][0][k] + t * basis[type][1][k] + t^2 * ... .
+*/
+static const float cml_curve_basis[3][4][4] = {
+    // bezier
+    {{1.0f, 0.0f, 0.0f, 0.0f},
+     {-3.0f, 3.0f, 0.0f, 0.0f},
+     {3.0f, -6.0f, 3.0f, 0.0f},
+     {-1.0f, 3.0f, -3.0f, 1.0f}},
+    // catmull-rom
+    {{0.0f, 1.0f, 0.0f, 0.0f},
+     {-0.5f, 0.0f, 0.5f, 0.0f},
+     {1.0f, -2.5f, 2.0f, -0.5f},
+     {-0.5f, 1.5f, -1.5f, 0.5f}},
+    // hermite
+    {{1.0f, 0.0f, 0.0f, 0.0f},
+     {0.0f, 1.0f, 0.0f, 0.0f},
+     {-3.0f, -2.0f, 3.0f, -1.0f},
+     {2.0f, 1.0f, -2.0f, 1.0f}},
+};
+
+static void cml_curve_weights(cml_curve_type type, float t, float w[4]) {
+    const float(*b)[4] = cml_curve_basis[type];
+
+    for (cml_u32 k = 0; k < 4; k++) {
+        w[k] = b[0][k] + t * (b[1][k] + t * (b[2][k] + t * b[3][k]));
+    }
+}
+
+void cml_curve_evaluate(cml_curve_type type, const vector controls[4],
+                        const float* t, cml_u32 count, float* out) {
+    cml_u32 dimension = controls[0].dimension;
+    assert(controls[1].dimension == dimension &&
+           controls[2].dimension == dimension &&
+           controls[3].dimension == dimension);
+
+    const float* p0 = controls[0].values;
+    const float* p1 = controls[1].values;
+    const float* p2 = controls[2].values;
+    const float* p3 = controls[3].values;
+
+    for (cml_u32 i = 0; i < count; i++) {
+        float w[4];
+        cml_curve_weights(type, t[i], w);
+
+        float* point = out + (size_t)i * dimension;
+        for (cml_u32 j = 0; j < dimension; j++) {
+            point[j] =
+                w[0] * p0[j] + w[1] * p1[j] + w[2] * p2[j] + w[3] * p3[j];
+        }
+    }
+}
+
+void cml_curve_evaluate_vector(cml_curve_type type, const vector controls[4],
+                               float t, vector* out) {
+    assert(out->dimension == controls[0].dimension);
+
+    cml_curve_evaluate(type, controls, &t, 1, out->values);
+}
+
+void cml_curve_evaluate_batch(cml_curve_type type, const float* controls,
+                              const float* t, cml_u32 count, float* out) {
+    const float(*b)[4] = cml_curve_basis[type];
+    const float* p[4] = {controls, controls + count, controls + 2 * count,
+                         controls + 3 * count};
+
+    cml_lane basis[4][4];
+    for (cml_u32 c = 0; c < 4; c++) {
+        for (cml_u32 k = 0; k < 4; k++) {
+            basis[c][k] = cml_lane_set(b[c][k]);
+        }
+    }
+
+    cml_u32 i = 0;
+    for (; i + CML_LANE_WIDTH <= count; i += CML_LANE_WIDTH) {
+        cml_lane x = cml_lane_load(t + i);
+        cml_lane sum = cml_lane_set(0.0f);
+
+        for (cml_u32 k = 0; k < 4; k++) {
+            cml_lane w = cml_lane_mul(x, basis[3][k]);
+            w = cml_lane_add(basis[2][k], w);
+            w = cml_lane_add(basis[1][k], cml_lane_mul(x, w));
+            w = cml_lane_add(basis[0][k], cml_lane_mul(x, w));
+            sum = cml_lane_add(sum, cml_lane_mul(w, cml_lane_load(p[k] + i)));
+        }
+        cml_lane_store(out + i, sum);
+    }
+
+    for (; i < count; i++) {
+        float w[4];
+        cml_curve_weights(type, t[i], w);
+        out[i] = w[0] * p[0][i] + w[1] * p[1][i] + w[2] * p[2][i] +
+                 w[3] * p[3][i];
+    }
+}
+
+cml_keyframes cml_keyframes_create(const float* times, const float* values,
+                                   const float* tangents, cml_u32 count,
+                                   cml_u32 dimension, cml_keyframe_mode mode) {
+    assert(count > 0);
+
+    cml_keyframes ret;
+    ret.times = times;
+    ret.values = values;
+    ret.tangents = tangents;
+    ret.count = count;
+    ret.dimension = dimension;
+    ret.mode = mode;
+    ret.last = 0;
+    return ret;
+}
+
+cml_u32 cml_keyframes_segment(cml_keyframes* keys, float time) {
+    assert(keys->count >= 2);
+
+    const float* times = keys->times;
+    cml_u32 last = keys->count - 2;
+    cml_u32 i = keys->last;
+
+    // the cached segment and the next one cover playback in order
+    if (time >= times[i]) {
+        if (i == last || time < times[i + 1]) {
+            return i;
+        }
+        if (i + 1 == last || time < times[i + 2]) {
+            keys->last = i + 1;
+            return i + 1;
+        }
+    } else if (i == 0) {
+        return 0;
+    }
+
+    // largest i <= last with times[i] <= time
+    cml_u32 lo = 0;
+    cml_u32 hi = last;
+    while (lo < hi) {
+        cml_u32 mid = lo + (hi - lo + 1) / 2;
+        if (times[mid] <= time) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    keys->last = lo;
+    return lo;
+}
+
+/*
+    Tangent of key i per unit of time.
+*/
+static float cml_keyframes_tangent(const cml_keyframes* keys, cml_u32 i,
+                                   cml_u32 j) {
+    cml_u32 dimension = keys->dimension;
+    if (keys->tangents) {
+        return keys->tangents[(size_t)i * dimension + j];
+    }
+
+    // one sided differences at the first and last key
+    cml_u32 a = i > 0 ? i - 1 : 0;
+    cml_u32 b = i + 1 < keys->count ? i + 1 : i;
+    return (keys->values[(size_t)b * dimension + j] -
+            keys->values[(size_t)a * dimension + j]) /
+           (keys->times[b] - keys->times[a]);
+}
+
+void cml_keyframes_sample(cml_keyframes* keys, float time, float* out) {
+    cml_u32 dimension = keys->dimension;
+    const float* times = keys->times;
+
+    if (keys->count == 1 || time <= times[0]) {
+        memcpy(out, keys->values, dimension * sizeof(float));
+        return;
+    }
+    if (time >= times[keys->count - 1]) {
+        memcpy(out, keys->values + (size_t)(keys->count - 1) * dimension,
+               dimension * sizeof(float));
+        return;
+    }
+
+    cml_u32 i = cml_keyframes_segment(keys, time);
+    const float* a = keys->values + (size_t)i * dimension;
+    const float* b = a + dimension;
+
+    if (keys->mode == CML_KEYFRAME_STEP) {
+        memcpy(out, a, dimension * sizeof(float));
+        return;
+    }
+
+    float h = times[i + 1] - times[i];
+    float s = (time - times[i]) / h;
+
+    if (keys->mode == CML_KEYFRAME_LINEAR) {
+        for (cml_u32 j = 0; j < dimension; j++) {
+            out[j] = a[j] + s * (b[j] - a[j]);
+        }
+        return;
+    }
+
+    // the tangents are per unit of time, the segment runs over h
+    float w[4];
+    cml_curve_weights(CML_CURVE_HERMITE, s, w);
+    for (cml_u32 j = 0; j < dimension; j++) {
+        float m0 = cml_keyframes_tangent(keys, i, j) * h;
+        float m1 = cml_keyframes_tangent(keys, i + 1, j) * h;
+        out[j] = w[0] * a[j] + w[1] * m0 + w[2] * b[j] + w[3] * m1;
+    }
+}
+
+void cml_keyframes_sample_times(cml_keyframes* keys, const float* times,
+                                cml_u32 count, float* out) {
+    for (cml_u32 i = 0; i < count; i++) {
+        cml_keyframes_sample(keys, times[i], out + (size_t)i * keys->dimension);
+    }
+}
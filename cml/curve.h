@@ -0,0 +1,111 @@
+#ifndef CML_CURVE_INCLUDED
+#define CML_CURVE_INCLUDED
+
+#include "internal/cml_core.h"
+#include "vector.h"
+
+/*
+    Cubic curve segments given by 4 control values, t runs
+    from 0 to 1 over the segment:
+
+    CML_CURVE_BEZIER:       p0 p1 p2 p3, passes through p0
+                            and p3
+    CML_CURVE_CATMULL_ROM:  p0 p1 p2 p3, passes through p1 and
+                            p2 (uniform, tension 0.5)
+    CML_CURVE_HERMITE:      p0 m0 p1 m1, points and tangents
+
+    None of the functions allocate.
+*/
+typedef enum {
+    CML_CURVE_BEZIER = 0,
+    CML_CURVE_CATMULL_ROM,
+    CML_CURVE_HERMITE
+} cml_curve_type;
+
+/*
+    NOTE: all 4 "controls" have to have the same dimension.
+
+    Evaluates the curve at "count" parameters "t" and writes
+    point i to out[i * dimension .. (i + 1) * dimension - 1].
+*/
+void cml_curve_evaluate(cml_curve_type type, const vector controls[4],
+                        const float* t, cml_u32 count, float* out);
+
+/*
+    Evaluates the curve at "t" into the preallocated "out",
+    which has to have the dimension of the controls.
+*/
+void cml_curve_evaluate_vector(cml_curve_type type, const vector controls[4],
+                               float t, vector* out);
+
+/*
+    Evaluates "count" scalar curves (one per channel, a 3D
+    curve is 3 channels) at their own parameter t[i] and
+    writes the results to out[i]. Control k of curve i is
+    controls[k * count + i], so the evaluation runs on SIMD
+    lanes across curves.
+*/
+void cml_curve_evaluate_batch(cml_curve_type type, const float* controls,
+                              const float* t, cml_u32 count, float* out);
+
+/*
+    CML_KEYFRAME_STEP:    holds the value of the previous key
+    CML_KEYFRAME_LINEAR:  linear interpolation
+    CML_KEYFRAME_CUBIC:   cubic Hermite interpolation with the
+                          given tangents, or Catmull-Rom
+                          tangents (p[i + 1] - p[i - 1]) /
+                          (t[i + 1] - t[i - 1]) without them
+*/
+typedef enum {
+    CML_KEYFRAME_STEP = 0,
+    CML_KEYFRAME_LINEAR,
+    CML_KEYFRAME_CUBIC
+} cml_keyframe_mode;
+
+/*
+    Sampler over keys at ascending "times" with "dimension"
+    values each (key i at values[i * dimension]). "tangents"
+    (same layout, per unit of time) may be NULL. The arrays
+    are not copied.
+
+    "last" caches the segment of the previous lookup, so a
+    sampler must not be shared between threads.
+*/
+typedef struct {
+    const float* times;
+    const float* values;
+    const float* tangents;
+    cml_u32 count;
+    cml_u32 dimension;
+    cml_keyframe_mode mode;
+    cml_u32 last;
+} cml_keyframes;
+
+cml_keyframes cml_keyframes_create(const float* times, const float* values,
+                                   const float* tangents, cml_u32 count,
+                                   cml_u32 dimension, cml_keyframe_mode mode);
+
+/*
+    NOTE: the sampler needs at least 2 keys.
+
+    Returns the segment i with times[i] <= time <
+    times[i + 1], clamped to the first / last segment. The
+    cached segment and its successor are checked before the
+    binary search, so playback in order costs O(1).
+*/
+cml_u32 cml_keyframes_segment(cml_keyframes* keys, float time);
+
+/*
+    Writes the "dimension" values at "time" to "out". Times
+    before the first / after the last key hold that key.
+*/
+void cml_keyframes_sample(cml_keyframes* keys, float time, float* out);
+
+/*
+    Samples at "count" times (ascending times use the cached
+    segment), sample i is written to out[i * dimension].
+*/
+void cml_keyframes_sample_times(cml_keyframes* keys, const float* times,
+                                cml_u32 count, float* out);
+
+#endif  // CML_CURVE_INCLUDED
@@ -0,0 +1,266 @@
+#include "frustum.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include "internal/cml_simd.h"
+#include "parallel.h"
+
+/*
+    Returns row "r" of the clip transform. The matrices store
+    columns in values[c], so the row is spread over them.
+*/
+static void cml_frustum_row(matrix* m, cml_u32 r, float* out) {
+    for (cml_u32 c = 0; c < 4; c++) {
+        out[c] = m->values[c][r];
+    }
+}
+
+static cml_plane cml_plane_normalized(float a, float b, float c, float d) {
+    cml_plane ret;
+    float len = sqrtf(a * a + b * b + c * c);
+
+    if (len == 0.0f || !isfinite(len)) {
+        ret.a = ret.b = ret.c = 0.0f;
+        ret.d = 1.0f;
+        return ret;
+    }
+
+    ret.a = a / len;
+    ret.b = b / len;
+    ret.c = c / len;
+    ret.d = d / len;
+    return ret;
+}
+
+cml_frustum cml_frustum_from_matrix(matrix m) {
+    return cml_frustum_from_matrix_depth(m, CML_DEPTH_NEGATIVE_ONE_TO_ONE);
+}
+
+cml_frustum cml_frustum_from_matrix_depth(matrix m, cml_depth_mode depth) {
+    assert(m.rows == 4 && m.cols == 4);
+
+    float rows[4][4];
+    for (cml_u32 r = 0; r < 4; r++) {
+        cml_frustum_row(&m, r, rows[r]);
+    }
+
+    // -w <= x, y, z <= w gives w + row and w - row for every axis
+    cml_frustum ret;
+    for (cml_u32 i = 0; i < CML_FRUSTUM_PLANES; i++) {
+        float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+        const float* row = rows[i / 2];
+
+        ret.planes[i] = cml_plane_normalized(
+            rows[3][0] + sign * row[0], rows[3][1] + sign * row[1],
+            rows[3][2] + sign * row[2], rows[3][3] + sign * row[3]);
+    }
+
+    // 0 <= z <= w replaces the near (or reversed: the far) plane
+    const float* z = rows[2];
+    if (depth == CML_DEPTH_ZERO_TO_ONE) {
+        ret.planes[CML_FRUSTUM_NEAR] =
+            cml_plane_normalized(z[0], z[1], z[2], z[3]);
+    } else if (depth == CML_DEPTH_REVERSE_Z) {
+        ret.planes[CML_FRUSTUM_NEAR] = ret.planes[CML_FRUSTUM_FAR];
+        ret.planes[CML_FRUSTUM_FAR] =
+            cml_plane_normalized(z[0], z[1], z[2], z[3]);
+    }
+    return ret;
+}
+
+float cml_plane_distance(cml_plane p, float x, float y, float z) {
+    return p.a * x + p.b * y + p.c * z + p.d;
+}
+
+BOOL cml_frustum_test_sphere(const cml_frustum* f, float x, float y, float z,
+                             float radius) {
+    for (cml_u32 i = 0; i < CML_FRUSTUM_PLANES; i++) {
+        if (cml_plane_distance(f->planes[i], x, y, z) < -radius) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+BOOL cml_frustum_test_aabb(const cml_frustum* f, const float* min,
+                           const float* max) {
+    for (cml_u32 i = 0; i < CML_FRUSTUM_PLANES; i++) {
+        cml_plane p = f->planes[i];
+
+        // the corner furthest along the plane normal
+        float x = p.a >= 0.0f ? max[0] : min[0];
+        float y = p.b >= 0.0f ? max[1] : min[1];
+        float z = p.c >= 0.0f ? max[2] : min[2];
+
+        if (cml_plane_distance(p, x, y, z) < 0.0f) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+typedef struct {
+    const cml_frustum* f;
+    const float* objects;
+    cml_u32 count;
+    cml_u32* visible;
+} cml_frustum_cull_job;
+
+#ifdef CML_SIMD_SSE
+
+/*
+    Returns the visibility of 4 objects in the low 4 bits.
+    "x", "y", "z" are the centers and "ex", "ey", "ez" the
+    half extents of boxes. Spheres pass the radius in "ex".
+*/
+static cml_u32 cml_frustum_test4(const cml_frustum* f, __m128 x, __m128 y,
+                                 __m128 z, __m128 ex, __m128 ey, __m128 ez,
+                                 BOOL sphere) {
+    __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+    for (cml_u32 i = 0; i < CML_FRUSTUM_PLANES; i++) {
+        cml_plane p = f->planes[i];
+
+        __m128 dist = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(p.a)),
+                       _mm_mul_ps(y, _mm_set1_ps(p.b))),
+            _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(p.c)), _mm_set1_ps(p.d)));
+
+        __m128 radius;
+        if (sphere) {
+            radius = ex;
+        } else {
+            radius = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(fabsf(p.a))),
+                           _mm_mul_ps(ey, _mm_set1_ps(fabsf(p.b)))),
+                _mm_mul_ps(ez, _mm_set1_ps(fabsf(p.c))));
+        }
+
+        visible = _mm_and_ps(visible,
+                             _mm_cmpge_ps(_mm_add_ps(dist, radius),
+                                          _mm_setzero_ps()));
+    }
+    return (cml_u32)_mm_movemask_ps(visible);
+}
+
+#endif
+
+static void cml_frustum_cull_spheres_range(cml_u32 begin, cml_u32 end,
+                                           void* arg) {
+    cml_frustum_cull_job* job = arg;
+
+    for (cml_u32 w = begin; w < end; w++) {
+        cml_u32 first = w * 32;
+        cml_u32 last = first + 32 < job->count ? first + 32 : job->count;
+        cml_u32 word = 0;
+        cml_u32 i = first;
+
+#ifdef CML_SIMD_SSE
+        for (; i + 4 <= last; i += 4) {
+            const float* s = job->objects + 4 * i;
+            __m128 x = _mm_loadu_ps(s);
+            __m128 y = _mm_loadu_ps(s + 4);
+            __m128 z = _mm_loadu_ps(s + 8);
+            __m128 r = _mm_loadu_ps(s + 12);
+            _MM_TRANSPOSE4_PS(x, y, z, r);
+
+            word |= cml_frustum_test4(job->f, x, y, z, r, r, r, TRUE)
+                    << (i - first);
+        }
+#endif
+
+        for (; i < last; i++) {
+            const float* s = job->objects + 4 * i;
+
+            if (cml_frustum_test_sphere(job->f, s[0], s[1], s[2], s[3])) {
+                word |= 1u << (i - first);
+            }
+        }
+        job->visible[w] = word;
+    }
+}
+
+static void cml_frustum_cull_aabbs_range(cml_u32 begin, cml_u32 end,
+                                         void* arg) {
+    cml_frustum_cull_job* job = arg;
+
+    for (cml_u32 w = begin; w < end; w++) {
+        cml_u32 first = w * 32;
+        cml_u32 last = first + 32 < job->count ? first + 32 : job->count;
+        cml_u32 word = 0;
+        cml_u32 i = first;
+
+#ifdef CML_SIMD_SSE
+        for (; i + 4 <= last; i += 4) {
+            const float* b = job->objects + 6 * i;
+
+            // min x, y, z and max x of each box
+            __m128 min_x = _mm_loadu_ps(b);
+            __m128 min_y = _mm_loadu_ps(b + 6);
+            __m128 min_z = _mm_loadu_ps(b + 12);
+            __m128 max_x = _mm_loadu_ps(b + 18);
+            _MM_TRANSPOSE4_PS(min_x, min_y, min_z, max_x);
+
+            // max y, z of boxes 0 and 1, then of boxes 2 and 3
+            __m128 lo = _mm_loadh_pi(
+                _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(b + 4)),
+                (const __m64*)(b + 10));
+            __m128 hi = _mm_loadh_pi(
+                _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(b + 16)),
+                (const __m64*)(b + 22));
+            __m128 max_y = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 max_z = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+
+            __m128 half = _mm_set1_ps(0.5f);
+            __m128 x = _mm_mul_ps(_mm_add_ps(min_x, max_x), half);
+            __m128 y = _mm_mul_ps(_mm_add_ps(min_y, max_y), half);
+            __m128 z = _mm_mul_ps(_mm_add_ps(min_z, max_z), half);
+            __m128 ex = _mm_mul_ps(_mm_sub_ps(max_x, min_x), half);
+            __m128 ey = _mm_mul_ps(_mm_sub_ps(max_y, min_y), half);
+            __m128 ez = _mm_mul_ps(_mm_sub_ps(max_z, min_z), half);
+
+            word |= cml_frustum_test4(job->f, x, y, z, ex, ey, ez, FALSE)
+                    << (i - first);
+        }
+#endif
+
+        for (; i < last; i++) {
+            const float* b = job->objects + 6 * i;
+
+            if (cml_frustum_test_aabb(job->f, b, b + 3)) {
+                word |= 1u << (i - first);
+            }
+        }
+        job->visible[w] = word;
+    }
+}
+
+static void cml_frustum_cull(const cml_frustum* f, const float* objects,
+                             cml_u32 count, cml_u32* visible,
+                             cml_parallel_fn fn) {
+    cml_frustum_cull_job job;
+    job.f = f;
+    job.objects = objects;
+    job.count = count;
+    job.visible = visible;
+
+    cml_u32 words = CML_FRUSTUM_MASK_WORDS(count);
+    if (count < CML_PARALLEL_THRESHOLD) {
+        fn(0, words, &job);
+        return;
+    }
+    // every thread writes whole mask words
+    cml_parallel_for(0, words, 64, fn, &job);
+}
+
+void cml_frustum_cull_spheres(const cml_frustum* f, const float* spheres,
+                              cml_u32 count, cml_u32* visible) {
+    cml_frustum_cull(f, spheres, count, visible,
+                     cml_frustum_cull_spheres_range);
+}
+
+void cml_frustum_cull_aabbs(const cml_frustum* f, const float* aabbs,
+                            cml_u32 count, cml_u32* visible) {
+    cml_frustum_cull(f, aabbs, count, visible, cml_frustum_cull_aabbs_range);
+}
@@ -0,0 +1,100 @@
+#ifndef CML_FRUSTUM_INCLUDED
+#define CML_FRUSTUM_INCLUDED
+
+#include "internal/cml_core.h"
+#include "matrix.h"
+#include "matrix_transform.h"
+
+/*
+    Plane a * x + b * y + c * z + d = 0 with a normalized
+    normal (a, b, c). Points with a positive distance lie
+    on the inner side.
+*/
+typedef struct {
+    float a, b, c, d;
+} cml_plane;
+
+typedef enum {
+    CML_FRUSTUM_LEFT = 0,
+    CML_FRUSTUM_RIGHT,
+    CML_FRUSTUM_BOTTOM,
+    CML_FRUSTUM_TOP,
+    CML_FRUSTUM_NEAR,
+    CML_FRUSTUM_FAR,
+    CML_FRUSTUM_PLANES
+} cml_frustum_plane;
+
+typedef struct {
+    cml_plane planes[CML_FRUSTUM_PLANES];
+} cml_frustum;
+
+/*
+    Extracts the frustum planes of the given 4x4 projection
+    or view-projection matrix "m" (for example the result of
+    cml_mat_mat_mult(cml_look_at(...), cml_perspective(...))).
+    The planes are in the space the matrix transforms from,
+    world space for a view-projection matrix.
+
+    The matrix is expected to map the visible depth range to
+    -w <= z <= w like cml_perspective() and cml_ortho() do.
+    A plane that degenerates (the far plane of an infinite
+    projection) accepts every point.
+*/
+cml_frustum cml_frustum_from_matrix(matrix m);
+
+/*
+    Same as cml_frustum_from_matrix() for a matrix that maps
+    depth as selected by "depth" (see matrix_transform.h).
+*/
+cml_frustum cml_frustum_from_matrix_depth(matrix m, cml_depth_mode depth);
+
+/*
+    Returns the signed distance of the point (x, y, z) to
+    the given plane.
+*/
+float cml_plane_distance(cml_plane p, float x, float y, float z);
+
+/*
+    Returns TRUE if the sphere with the center (x, y, z) and
+    the given radius intersects the frustum.
+*/
+BOOL cml_frustum_test_sphere(const cml_frustum* f, float x, float y, float z,
+                             float radius);
+
+/*
+    Returns TRUE if the axis aligned box "min" / "max"
+    (3 floats each) intersects the frustum.
+*/
+BOOL cml_frustum_test_aabb(const cml_frustum* f, const float* min,
+                           const float* max);
+
+/*
+    Size in cml_u32 words of a visibility mask for "count"
+    objects.
+*/
+#define CML_FRUSTUM_MASK_WORDS(count) (((count) + 31) / 32)
+
+/*
+    Tests "count" spheres stored as x y z radius (4 floats
+    each) against the frustum. Bit i % 32 of visible[i / 32]
+    is set if sphere i is visible, "visible" needs
+    CML_FRUSTUM_MASK_WORDS(count) words.
+
+    The spheres are tested 4 at a time with SSE and on the
+    thread pool from CML_PARALLEL_THRESHOLD spheres on.
+
+    NOTE: Like the single tests this is conservative, objects
+          near the corners of the frustum may be reported as
+          visible although they are outside.
+*/
+void cml_frustum_cull_spheres(const cml_frustum* f, const float* spheres,
+                              cml_u32 count, cml_u32* visible);
+
+/*
+    Same as cml_frustum_cull_spheres() for axis aligned boxes
+    stored as min x y z, max x y z (6 floats each).
+*/
+void cml_frustum_cull_aabbs(const cml_frustum* f, const float* aabbs,
+                            cml_u32 count, cml_u32* visible);
+
+#endif  // CML_FRUSTUM_INCLUDED
@@ -18,6 +18,20 @@ typedef signed short cml_i16;
 typedef signed int cml_i32;
 typedef signed long long cml_i64;
 
+/*
+    Marks the small hot functions (cml_radians(), cml_dot(),
+    cml_vector_get_value_at_index(), ...). Compiling with
+    CML_STATIC_INLINE defined turns them into static inline
+    definitions in the headers, so the compiler can inline
+    them into the caller without link time optimization.
+    The single header build (tools/amalgamate.sh) defines it.
+*/
+#ifdef CML_STATIC_INLINE
+#define CML_INLINE static inline
+#else
+#define CML_INLINE
+#endif
+
 void swap_int(int* _1, int* _2);
 
 void swap_float(float* _1, float* _2);
@@ -0,0 +1,18 @@
+#ifndef CML_EIGEN3_INCLUDED
+#define CML_EIGEN3_INCLUDED
+
+#include "cml_core.h"
+
+/*
+    cml_eigen3_symmetric() on a double precision upper
+    triangle a = {a00, a01, a02, a11, a12, a22}, with the
+    eigenvalues "eval" and eigenvectors "evec" (same order
+    as cml_eigen3) left in double precision. Used by
+    callers that form "a" themselves (the 3x3 SVD builds
+    transpose(a) * a) and would lose its small eigenvalues
+    to a float rounding.
+*/
+void cml_eigen3_symmetric_double(const double* a, double eval[3],
+                                 double evec[3][3]);
+
+#endif  // CML_EIGEN3_INCLUDED
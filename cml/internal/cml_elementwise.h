@@ -0,0 +1,39 @@
+#ifndef CML_ELEMENTWISE_INCLUDED
+#define CML_ELEMENTWISE_INCLUDED
+
+#include "cml_core.h"
+
+/*
+    Element-wise operations shared by vectors and matrices.
+    The *_SCALER operations combine every element of src1
+    with the scaler, the others combine src1 and src2.
+*/
+typedef enum {
+    CML_OP_ADD_SCALER,
+    CML_OP_SUBST_SCALER,
+    CML_OP_MULT_SCALER,
+    CML_OP_DIV_SCALER,
+    CML_OP_ADD,
+    CML_OP_SUBST,
+    CML_OP_MULT,
+    CML_OP_DIV
+} cml_elementwise_op;
+
+/*
+    dst[i] = src1[i] op (src2[i] | scaler) for i < count.
+    Runs on the thread pool (see parallel.h) from
+    CML_PARALLEL_THRESHOLD elements on.
+*/
+void cml_elementwise(float* dst, const float* src1, const float* src2,
+                     float scaler, cml_elementwise_op op, cml_u32 count);
+
+/*
+    Same as cml_elementwise() for row arrays of matrices.
+    The rows are distributed over the thread pool from
+    rows * cols >= CML_PARALLEL_THRESHOLD on.
+*/
+void cml_elementwise_rows(float** dst, float** src1, float** src2,
+                          float scaler, cml_elementwise_op op, cml_u32 rows,
+                          cml_u32 cols);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef CML_FILE_INCLUDED
+#define CML_FILE_INCLUDED
+
+#include <stdio.h>
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+
+#include "cml_core.h"
+
+/*
+    Moves file to the absolute byte offset. Unlike fseek() the
+    offset is not limited to a long, which is 32 bits on
+    Windows. Files using it define _POSIX_C_SOURCE before
+    their first include for fseeko(). Returns 0 on success.
+*/
+static inline int cml_file_seek(FILE* file, cml_u64 offset) {
+#ifdef _WIN32
+    return _fseeki64(file, (__int64)offset, SEEK_SET);
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+}
+
+#endif  // CML_FILE_INCLUDED
@@ -0,0 +1,15 @@
+#ifndef CML_RADIANS_INLINE_INCLUDED
+#define CML_RADIANS_INLINE_INCLUDED
+
+#include "../radians.h"
+
+/*
+    Definitions of the CML_INLINE functions of radians.h,
+    compiled by radians.c or inlined with CML_STATIC_INLINE.
+*/
+
+CML_INLINE float cml_radians(float degrees) {
+    return (float)(degrees * 0.01745329251994329576923690768489);
+}
+
+#endif  // CML_RADIANS_INLINE_INCLUDED
@@ -0,0 +1,245 @@
+#ifndef CML_SIMD_INCLUDED
+#define CML_SIMD_INCLUDED
+
+#include <stddef.h>
+
+#include "cml_core.h"
+
+/*
+    Detects the SIMD instruction sets the library may use.
+    Every SIMD path has a scalar fallback, defining
+    CML_NO_SIMD forces the fallbacks.
+*/
+#ifndef CML_NO_SIMD
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CML_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX__)
+#define CML_SIMD_AVX 1
+#include <immintrin.h>
+#endif
+
+#if defined(CML_SIMD_SSE) && defined(__F16C__)
+#define CML_SIMD_F16C 1
+#include <immintrin.h>
+#endif
+
+#endif
+
+#ifdef CML_SIMD_SSE
+
+/*
+    Splits 4 interleaved xyz triples (12 floats, stored as the
+    registers x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3) into
+    one register per component.
+*/
+static inline void cml_simd_load_xyz4(const float* p, __m128* x, __m128* y,
+                                      __m128* z) {
+    __m128 a = _mm_loadu_ps(p);
+    __m128 b = _mm_loadu_ps(p + 4);
+    __m128 c = _mm_loadu_ps(p + 8);
+
+    __m128 t0 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 0, 2));
+    *x = _mm_shuffle_ps(a, t0, _MM_SHUFFLE(3, 0, 3, 0));
+    __m128 t1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 0, 1));
+    __m128 t2 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 0, 0, 3));
+    *y = _mm_shuffle_ps(t1, t2, _MM_SHUFFLE(3, 0, 2, 0));
+    __m128 t3 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 1, 0, 2));
+    __m128 t4 = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 0, 0));
+    *z = _mm_shuffle_ps(t3, t4, _MM_SHUFFLE(3, 0, 2, 0));
+}
+
+/*
+    Inverse of cml_simd_load_xyz4().
+*/
+static inline void cml_simd_store_xyz4(float* p, __m128 x, __m128 y,
+                                       __m128 z) {
+    __m128 xy_lo = _mm_unpacklo_ps(x, y);
+    __m128 xy_hi = _mm_unpackhi_ps(x, y);
+    __m128 yz_lo = _mm_unpacklo_ps(y, z);
+
+    __m128 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0));
+    __m128 zx_hi = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2));
+    __m128 yz_hi = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3));
+
+    _mm_storeu_ps(p, _mm_shuffle_ps(xy_lo, zx, _MM_SHUFFLE(2, 0, 1, 0)));
+    _mm_storeu_ps(p + 4, _mm_shuffle_ps(yz_lo, xy_hi, _MM_SHUFFLE(1, 0, 3, 2)));
+    _mm_storeu_ps(p + 8, _mm_shuffle_ps(zx_hi, yz_hi, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+#endif
+
+/*
+    Float lanes of the widest enabled instruction set, one
+    float with CML_NO_SIMD. Comparisons return masks with all
+    bits set per lane (1.0f for the scalar fallback).
+*/
+#if defined(CML_SIMD_AVX)
+
+typedef __m256 cml_lane;
+#define CML_LANE_WIDTH 8
+
+static inline cml_lane cml_lane_set(float x) { return _mm256_set1_ps(x); }
+static inline cml_lane cml_lane_load(const float* p) {
+    return _mm256_loadu_ps(p);
+}
+static inline void cml_lane_store(float* p, cml_lane a) {
+    _mm256_storeu_ps(p, a);
+}
+static inline cml_lane cml_lane_add(cml_lane a, cml_lane b) {
+    return _mm256_add_ps(a, b);
+}
+static inline cml_lane cml_lane_sub(cml_lane a, cml_lane b) {
+    return _mm256_sub_ps(a, b);
+}
+static inline cml_lane cml_lane_mul(cml_lane a, cml_lane b) {
+    return _mm256_mul_ps(a, b);
+}
+static inline cml_lane cml_lane_div(cml_lane a, cml_lane b) {
+    return _mm256_div_ps(a, b);
+}
+static inline cml_lane cml_lane_min(cml_lane a, cml_lane b) {
+    return _mm256_min_ps(a, b);
+}
+static inline cml_lane cml_lane_max(cml_lane a, cml_lane b) {
+    return _mm256_max_ps(a, b);
+}
+static inline cml_lane cml_lane_lt(cml_lane a, cml_lane b) {
+    return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+}
+static inline cml_lane cml_lane_le(cml_lane a, cml_lane b) {
+    return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+}
+static inline cml_lane cml_lane_and(cml_lane a, cml_lane b) {
+    return _mm256_and_ps(a, b);
+}
+static inline cml_lane cml_lane_select(cml_lane m, cml_lane a, cml_lane b) {
+    return _mm256_blendv_ps(b, a, m);
+}
+static inline cml_u32 cml_lane_bits(cml_lane m) {
+    return (cml_u32)_mm256_movemask_ps(m);
+}
+
+#elif defined(CML_SIMD_SSE)
+
+typedef __m128 cml_lane;
+#define CML_LANE_WIDTH 4
+
+static inline cml_lane cml_lane_set(float x) { return _mm_set1_ps(x); }
+static inline cml_lane cml_lane_load(const float* p) { return _mm_loadu_ps(p); }
+static inline void cml_lane_store(float* p, cml_lane a) { _mm_storeu_ps(p, a); }
+static inline cml_lane cml_lane_add(cml_lane a, cml_lane b) {
+    return _mm_add_ps(a, b);
+}
+static inline cml_lane cml_lane_sub(cml_lane a, cml_lane b) {
+    return _mm_sub_ps(a, b);
+}
+static inline cml_lane cml_lane_mul(cml_lane a, cml_lane b) {
+    return _mm_mul_ps(a, b);
+}
+static inline cml_lane cml_lane_div(cml_lane a, cml_lane b) {
+    return _mm_div_ps(a, b);
+}
+static inline cml_lane cml_lane_min(cml_lane a, cml_lane b) {
+    return _mm_min_ps(a, b);
+}
+static inline cml_lane cml_lane_max(cml_lane a, cml_lane b) {
+    return _mm_max_ps(a, b);
+}
+static inline cml_lane cml_lane_lt(cml_lane a, cml_lane b) {
+    return _mm_cmplt_ps(a, b);
+}
+static inline cml_lane cml_lane_le(cml_lane a, cml_lane b) {
+    return _mm_cmple_ps(a, b);
+}
+static inline cml_lane cml_lane_and(cml_lane a, cml_lane b) {
+    return _mm_and_ps(a, b);
+}
+static inline cml_lane cml_lane_select(cml_lane m, cml_lane a, cml_lane b) {
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+static inline cml_u32 cml_lane_bits(cml_lane m) {
+    return (cml_u32)_mm_movemask_ps(m);
+}
+
+#else
+
+typedef float cml_lane;
+#define CML_LANE_WIDTH 1
+
+static inline cml_lane cml_lane_set(float x) { return x; }
+static inline cml_lane cml_lane_load(const float* p) { return *p; }
+static inline void cml_lane_store(float* p, cml_lane a) { *p = a; }
+static inline cml_lane cml_lane_add(cml_lane a, cml_lane b) { return a + b; }
+static inline cml_lane cml_lane_sub(cml_lane a, cml_lane b) { return a - b; }
+static inline cml_lane cml_lane_mul(cml_lane a, cml_lane b) { return a * b; }
+static inline cml_lane cml_lane_div(cml_lane a, cml_lane b) { return a / b; }
+static inline cml_lane cml_lane_min(cml_lane a, cml_lane b) {
+    return a < b ? a : b;
+}
+static inline cml_lane cml_lane_max(cml_lane a, cml_lane b) {
+    return a > b ? a : b;
+}
+static inline cml_lane cml_lane_lt(cml_lane a, cml_lane b) {
+    return a < b ? 1.0f : 0.0f;
+}
+static inline cml_lane cml_lane_le(cml_lane a, cml_lane b) {
+    return a <= b ? 1.0f : 0.0f;
+}
+static inline cml_lane cml_lane_and(cml_lane a, cml_lane b) { return a * b; }
+static inline cml_lane cml_lane_select(cml_lane m, cml_lane a, cml_lane b) {
+    return m != 0.0f ? a : b;
+}
+static inline cml_u32 cml_lane_bits(cml_lane m) { return m != 0.0f; }
+
+#endif
+
+/*
+    Columns of the register block of cml_lane_micro().
+*/
+#define CML_LANE_PANEL (2 * CML_LANE_WIDTH)
+
+/*
+    c (rows x CML_LANE_PANEL) = (or +=) a (rows x depth) *
+    b (depth x CML_LANE_PANEL) for rows <= 4, the block of c
+    is kept in registers. The GEMM style kernels pack b into
+    contiguous panels (ldb = CML_LANE_PANEL) first.
+*/
+static inline void cml_lane_micro(float* c, cml_u32 ldc, const float* a,
+                                  cml_u32 lda, const float* b, cml_u32 ldb,
+                                  cml_u32 rows, cml_u32 depth,
+                                  BOOL accumulate) {
+    cml_lane acc[4][2];
+    for (cml_u32 r = 0; r < rows; r++) {
+        acc[r][0] = cml_lane_set(0.0f);
+        acc[r][1] = cml_lane_set(0.0f);
+    }
+
+    for (cml_u32 p = 0; p < depth; p++) {
+        cml_lane b0 = cml_lane_load(b + (size_t)p * ldb);
+        cml_lane b1 = cml_lane_load(b + (size_t)p * ldb + CML_LANE_WIDTH);
+
+        for (cml_u32 r = 0; r < rows; r++) {
+            cml_lane x = cml_lane_set(a[(size_t)r * lda + p]);
+            acc[r][0] = cml_lane_add(acc[r][0], cml_lane_mul(x, b0));
+            acc[r][1] = cml_lane_add(acc[r][1], cml_lane_mul(x, b1));
+        }
+    }
+
+    for (cml_u32 r = 0; r < rows; r++) {
+        float* row = c + (size_t)r * ldc;
+        if (accumulate) {
+            acc[r][0] = cml_lane_add(acc[r][0], cml_lane_load(row));
+            acc[r][1] =
+                cml_lane_add(acc[r][1], cml_lane_load(row + CML_LANE_WIDTH));
+        }
+        cml_lane_store(row, acc[r][0]);
+        cml_lane_store(row + CML_LANE_WIDTH, acc[r][1]);
+    }
+}
+
+#endif
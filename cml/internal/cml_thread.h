@@ -0,0 +1,88 @@
+#ifndef CML_THREAD_INCLUDED
+#define CML_THREAD_INCLUDED
+
+#include "cml_core.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+/*
+    Minimal platform independent thread wrapper used
+    internally by the library (pthreads or win32 threads).
+*/
+typedef void (*cml_thread_fn)(void* arg);
+
+typedef struct {
+#ifdef _WIN32
+    void* handle;
+#else
+    pthread_t handle;
+#endif
+} cml_thread;
+
+typedef struct {
+#ifdef _WIN32
+    void* handle;
+#else
+    pthread_mutex_t handle;
+#endif
+} cml_mutex;
+
+typedef struct {
+#ifdef _WIN32
+    void* handle;
+#else
+    pthread_cond_t handle;
+#endif
+} cml_cond;
+
+/*
+    Storage class for variables that exist once per thread.
+*/
+#if defined(_MSC_VER)
+#define CML_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define CML_THREAD_LOCAL __thread
+#else
+#define CML_THREAD_LOCAL _Thread_local
+#endif
+
+/*
+    Starts a new thread that runs fn(arg). Returns FALSE
+    if the thread could not be created.
+*/
+BOOL cml_thread_create(cml_thread* thread, cml_thread_fn fn, void* arg);
+
+/*
+    Waits for the given thread to finish.
+*/
+void cml_thread_join(cml_thread* thread);
+
+/*
+    Returns the number of hardware threads of the machine.
+*/
+cml_u32 cml_thread_hardware_concurrency(void);
+
+void cml_mutex_init(cml_mutex* mutex);
+
+void cml_mutex_destroy(cml_mutex* mutex);
+
+void cml_mutex_lock(cml_mutex* mutex);
+
+void cml_mutex_unlock(cml_mutex* mutex);
+
+void cml_cond_init(cml_cond* cond);
+
+void cml_cond_destroy(cml_cond* cond);
+
+/*
+    Atomically unlocks the given mutex and waits for the
+    condition to be signaled. The mutex is locked again
+    before the function returns.
+*/
+void cml_cond_wait(cml_cond* cond, cml_mutex* mutex);
+
+void cml_cond_broadcast(cml_cond* cond);
+
+#endif
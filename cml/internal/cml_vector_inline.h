@@ -0,0 +1,134 @@
+#ifndef CML_VECTOR_INLINE_INCLUDED
+#define CML_VECTOR_INLINE_INCLUDED
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "../reduce.h"
+#include "../vector.h"
+#include "cml_elementwise.h"
+
+/*
+    Definitions of the CML_INLINE functions of vector.h,
+    compiled by vector.c or inlined with CML_STATIC_INLINE.
+*/
+
+/*
+    Vectors up to this dimension (2d to 4d points, colors,
+    quaternions) are processed right here instead of by
+    cml_elementwise() and the reduce.h functions, so the
+    inlined functions make no library call for them.
+*/
+#define CML_VECTOR_INLINE_DIMENSION 4
+
+/*
+    Sum of up to 4 terms combined in the order of the lanes
+    of the reduce.h kernels (CML_REDUCE_LANES >= 4), so the
+    results match cml_reduce_dot() and friends bit for bit.
+*/
+static inline float cml_vector_small_sum(const float terms[4]) {
+    return (terms[0] + terms[2]) + (terms[1] + terms[3]);
+}
+
+CML_INLINE vector cml_vector_allocate(cml_u32 dimension) {
+    vector ret;
+
+    ret.dimension = dimension;
+    ret.values = malloc(dimension * sizeof(float));
+
+    return ret;
+}
+
+CML_INLINE vector cml_vec_vec_add(vector v1, vector v2) {
+    assert(v1.dimension == v2.dimension);
+
+    vector ret = cml_vector_allocate(v1.dimension);
+
+    if (v1.dimension <= CML_VECTOR_INLINE_DIMENSION) {
+        for (cml_u32 i = 0; i < v1.dimension; i++) {
+            ret.values[i] = v1.values[i] + v2.values[i];
+        }
+        return ret;
+    }
+    cml_elementwise(ret.values, v1.values, v2.values, 0.0f, CML_OP_ADD,
+                    v1.dimension);
+    return ret;
+}
+
+CML_INLINE void cml_vec_add_to_vec(vector* v1, vector v2) {
+    assert(v1->dimension == v2.dimension);
+
+    if (v1->dimension <= CML_VECTOR_INLINE_DIMENSION) {
+        for (cml_u32 i = 0; i < v1->dimension; i++) {
+            v1->values[i] += v2.values[i];
+        }
+        return;
+    }
+    cml_elementwise(v1->values, v1->values, v2.values, 0.0f, CML_OP_ADD,
+                    v1->dimension);
+}
+
+CML_INLINE vector cml_vec_vec_subst(vector v1, vector v2) {
+    assert(v1.dimension == v2.dimension);
+
+    vector ret = cml_vector_allocate(v1.dimension);
+
+    if (v1.dimension <= CML_VECTOR_INLINE_DIMENSION) {
+        for (cml_u32 i = 0; i < v1.dimension; i++) {
+            ret.values[i] = v1.values[i] - v2.values[i];
+        }
+        return ret;
+    }
+    cml_elementwise(ret.values, v1.values, v2.values, 0.0f, CML_OP_SUBST,
+                    v1.dimension);
+    return ret;
+}
+
+CML_INLINE void cml_subst_vec_from_vec(vector* v1, vector v2) {
+    assert(v1->dimension == v2.dimension);
+
+    if (v1->dimension <= CML_VECTOR_INLINE_DIMENSION) {
+        for (cml_u32 i = 0; i < v1->dimension; i++) {
+            v1->values[i] -= v2.values[i];
+        }
+        return;
+    }
+    cml_elementwise(v1->values, v1->values, v2.values, 0.0f, CML_OP_SUBST,
+                    v1->dimension);
+}
+
+CML_INLINE float cml_dot(vector v1, vector v2) {
+    assert(v1.dimension == v2.dimension);
+
+    if (v1.dimension <= CML_VECTOR_INLINE_DIMENSION) {
+        float terms[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (cml_u32 i = 0; i < v1.dimension; i++) {
+            terms[i] += v1.values[i] * v2.values[i];
+        }
+        return cml_vector_small_sum(terms);
+    }
+    return cml_reduce_dot(v1.values, v2.values, v1.dimension,
+                          CML_REDUCE_PAIRWISE);
+}
+
+CML_INLINE float cml_vector_magnitude_squared(vector v) {
+    if (v.dimension <= CML_VECTOR_INLINE_DIMENSION) {
+        float terms[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (cml_u32 i = 0; i < v.dimension; i++) {
+            terms[i] += v.values[i] * v.values[i];
+        }
+        return cml_vector_small_sum(terms);
+    }
+    return cml_reduce_sum_squares(v.values, v.dimension, CML_REDUCE_PAIRWISE);
+}
+
+CML_INLINE float cml_vector_magnitude(vector v) {
+    return (float)sqrt(cml_vector_magnitude_squared(v));
+}
+
+CML_INLINE float cml_vector_get_value_at_index(vector v, cml_u32 index) {
+    return v.values[index];
+}
+
+#endif  // CML_VECTOR_INLINE_INCLUDED
@@ -0,0 +1,370 @@
+#include "iterative.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reduce.h"
+
+static float cml_solver_dot(const float* a, const float* b, cml_u32 n) {
+    return cml_reduce_dot(a, b, n, CML_REDUCE_PAIRWISE);
+}
+
+static float cml_solver_norm(const float* a, cml_u32 n) {
+    return sqrtf(cml_reduce_sum_squares(a, n, CML_REDUCE_PAIRWISE));
+}
+
+// y += a * x
+static void cml_solver_axpy(float* y, const float* x, float a, cml_u32 n) {
+    for (cml_u32 i = 0; i < n; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+void cml_sparse_linear_op(const float* x, float* y, void* arg) {
+    cml_sparse_mat_vec(arg, x, y);
+}
+
+cml_solver_settings cml_solver_default_settings(void) {
+    cml_solver_settings ret;
+    ret.max_iterations = 1000;
+    ret.tolerance = 1e-5f;
+    ret.preconditioner = NULL;
+    ret.preconditioner_arg = NULL;
+    return ret;
+}
+
+static void cml_solver_precondition(const cml_solver_settings* settings,
+                                    const float* r, float* z) {
+    settings->preconditioner(r, z, settings->preconditioner_arg);
+}
+
+/*
+    r = b - a * x, returns |b| (1 if b is zero so that the
+    relative residual stays defined).
+*/
+static float cml_solver_residual(cml_linear_op a, void* a_arg, cml_u32 n,
+                                 const float* b, const float* x, float* r) {
+    a(x, r, a_arg);
+    for (cml_u32 i = 0; i < n; i++) {
+        r[i] = b[i] - r[i];
+    }
+
+    float norm = cml_solver_norm(b, n);
+    return norm > 0.0f ? norm : 1.0f;
+}
+
+cml_solver_result cml_cg(cml_linear_op a, void* a_arg, cml_u32 n,
+                         const float* b, float* x,
+                         const cml_solver_settings* settings) {
+    BOOL precondition = settings->preconditioner != NULL;
+    float* storage = malloc((size_t)n * (precondition ? 4 : 3) * sizeof(float));
+    float* r = storage;
+    float* p = r + n;
+    float* ap = p + n;
+    float* z = precondition ? ap + n : r;
+
+    cml_solver_result ret;
+    ret.iterations = 0;
+    ret.converged = FALSE;
+
+    float b_norm = cml_solver_residual(a, a_arg, n, b, x, r);
+    float last_true = INFINITY;
+    float rz = 0.0f;
+    BOOL restart = TRUE;
+
+    for (;;) {
+        if (restart) {
+            ret.residual = cml_solver_norm(r, n) / b_norm;
+            if (ret.residual <= settings->tolerance ||
+                !(ret.residual < last_true)) {
+                // converged, or float rounding keeps it from improving
+                break;
+            }
+            last_true = ret.residual;
+
+            if (precondition) {
+                cml_solver_precondition(settings, r, z);
+            }
+            memcpy(p, z, n * sizeof(float));
+            rz = cml_solver_dot(r, z, n);
+            restart = FALSE;
+        }
+
+        if (ret.iterations >= settings->max_iterations) {
+            break;
+        }
+        a(p, ap, a_arg);
+
+        float pap = cml_solver_dot(p, ap, n);
+        if (!(pap > 0.0f)) {
+            // a is not positive definite (or p vanished)
+            break;
+        }
+
+        float alpha = rz / pap;
+        cml_solver_axpy(x, p, alpha, n);
+        cml_solver_axpy(r, ap, -alpha, n);
+        ret.iterations++;
+        ret.residual = cml_solver_norm(r, n) / b_norm;
+
+        if (ret.residual <= settings->tolerance) {
+            // the recurrence drifts from b - a * x, verify it
+            cml_solver_residual(a, a_arg, n, b, x, r);
+            restart = TRUE;
+            continue;
+        }
+
+        if (precondition) {
+            cml_solver_precondition(settings, r, z);
+        }
+        float rz_next = cml_solver_dot(r, z, n);
+        float beta = rz_next / rz;
+        rz = rz_next;
+
+        for (cml_u32 i = 0; i < n; i++) {
+            p[i] = z[i] + beta * p[i];
+        }
+    }
+
+    ret.converged = ret.residual <= settings->tolerance;
+    free(storage);
+    return ret;
+}
+
+cml_solver_result cml_bicgstab(cml_linear_op a, void* a_arg, cml_u32 n,
+                               const float* b, float* x,
+                               const cml_solver_settings* settings) {
+    BOOL precondition = settings->preconditioner != NULL;
+    float* storage = malloc((size_t)n * (precondition ? 7 : 5) * sizeof(float));
+    float* r = storage;
+    float* r0 = r + n;
+    float* p = r0 + n;
+    float* v = p + n;
+    float* t = v + n;
+    float* p_hat = precondition ? t + n : p;
+    float* s_hat = precondition ? p_hat + n : r;
+
+    cml_solver_result ret;
+    ret.iterations = 0;
+    ret.converged = FALSE;
+
+    float b_norm = cml_solver_residual(a, a_arg, n, b, x, r);
+    float last_true = INFINITY;
+    float rho = 1.0f, alpha = 1.0f, omega = 1.0f;
+    BOOL restart = TRUE;
+
+    for (;;) {
+        if (restart) {
+            ret.residual = cml_solver_norm(r, n) / b_norm;
+            if (ret.residual <= settings->tolerance ||
+                !(ret.residual < last_true)) {
+                break;
+            }
+            last_true = ret.residual;
+
+            memcpy(r0, r, n * sizeof(float));
+            memset(p, 0, n * sizeof(float));
+            memset(v, 0, n * sizeof(float));
+            rho = alpha = omega = 1.0f;
+            restart = FALSE;
+        }
+
+        if (ret.iterations >= settings->max_iterations) {
+            break;
+        }
+
+        float rho_next = cml_solver_dot(r0, r, n);
+        if (rho_next == 0.0f || omega == 0.0f) {
+            // breakdown, r is orthogonal to the shadow residual
+            break;
+        }
+
+        float beta = (rho_next / rho) * (alpha / omega);
+        rho = rho_next;
+        for (cml_u32 i = 0; i < n; i++) {
+            p[i] = r[i] + beta * (p[i] - omega * v[i]);
+        }
+
+        if (precondition) {
+            cml_solver_precondition(settings, p, p_hat);
+        }
+        a(p_hat, v, a_arg);
+
+        float r0v = cml_solver_dot(r0, v, n);
+        if (r0v == 0.0f) {
+            break;
+        }
+        alpha = rho / r0v;
+
+        // s = r - alpha * v, kept in r
+        cml_solver_axpy(r, v, -alpha, n);
+        cml_solver_axpy(x, p_hat, alpha, n);
+        ret.iterations++;
+        ret.residual = cml_solver_norm(r, n) / b_norm;
+
+        if (ret.residual > settings->tolerance) {
+            if (precondition) {
+                cml_solver_precondition(settings, r, s_hat);
+            }
+            a(s_hat, t, a_arg);
+
+            float tt = cml_solver_dot(t, t, n);
+            omega = tt > 0.0f ? cml_solver_dot(t, r, n) / tt : 0.0f;
+
+            cml_solver_axpy(x, s_hat, omega, n);
+            cml_solver_axpy(r, t, -omega, n);
+            ret.residual = cml_solver_norm(r, n) / b_norm;
+        }
+
+        if (ret.residual <= settings->tolerance) {
+            // the recurrence drifts from b - a * x, verify it
+            cml_solver_residual(a, a_arg, n, b, x, r);
+            restart = TRUE;
+        }
+    }
+
+    ret.converged = ret.residual <= settings->tolerance;
+    free(storage);
+    return ret;
+}
+
+cml_jacobi cml_jacobi_from_diagonal(const float* diagonal, cml_u32 n) {
+    cml_jacobi ret;
+    ret.n = n;
+    ret.inverse_diagonal = malloc(n * sizeof(float));
+
+    for (cml_u32 i = 0; i < n; i++) {
+        ret.inverse_diagonal[i] = diagonal[i] != 0.0f ? 1.0f / diagonal[i]
+                                                      : 1.0f;
+    }
+    return ret;
+}
+
+cml_jacobi cml_jacobi_from_sparse(const cml_sparse* a) {
+    assert(a->rows == a->cols);
+
+    float* diagonal = malloc(a->rows * sizeof(float));
+    cml_sparse_diagonal(a, diagonal);
+
+    cml_jacobi ret = cml_jacobi_from_diagonal(diagonal, a->rows);
+    free(diagonal);
+    return ret;
+}
+
+void cml_jacobi_free(cml_jacobi* jacobi) {
+    free(jacobi->inverse_diagonal);
+    jacobi->inverse_diagonal = NULL;
+    jacobi->n = 0;
+}
+
+void cml_jacobi_apply(const float* r, float* z, void* arg) {
+    const cml_jacobi* jacobi = arg;
+
+    for (cml_u32 i = 0; i < jacobi->n; i++) {
+        z[i] = jacobi->inverse_diagonal[i] * r[i];
+    }
+}
+
+BOOL cml_ic0_factor(const cml_sparse* a, cml_ic0* out) {
+    assert(a->rows == a->cols);
+
+    cml_u32 n = a->rows;
+    cml_sparse l;
+    l.rows = n;
+    l.cols = n;
+    l.row_offsets = malloc((n + 1) * sizeof(cml_u32));
+
+    // the lower triangle keeps the sorted column order
+    l.nnz = 0;
+    for (cml_u32 r = 0; r < n; r++) {
+        for (cml_u32 i = a->row_offsets[r]; i < a->row_offsets[r + 1]; i++) {
+            l.nnz += a->col_indices[i] <= r;
+        }
+    }
+    l.col_indices = malloc(l.nnz * sizeof(cml_u32));
+    l.values = malloc(l.nnz * sizeof(float));
+
+    cml_u32 k = 0;
+    for (cml_u32 r = 0; r < n; r++) {
+        l.row_offsets[r] = k;
+        for (cml_u32 i = a->row_offsets[r]; i < a->row_offsets[r + 1]; i++) {
+            if (a->col_indices[i] <= r) {
+                l.col_indices[k] = a->col_indices[i];
+                l.values[k] = a->values[i];
+                k++;
+            }
+        }
+    }
+    l.row_offsets[n] = k;
+
+    for (cml_u32 r = 0; r < n; r++) {
+        cml_u32 begin = l.row_offsets[r];
+        cml_u32 end = l.row_offsets[r + 1];
+
+        // the diagonal is the last entry of every row
+        if (begin == end || l.col_indices[end - 1] != r) {
+            cml_sparse_free(&l);
+            return FALSE;
+        }
+
+        for (cml_u32 i = begin; i < end; i++) {
+            cml_u32 c = l.col_indices[i];
+
+            // sum of l[r][j] * l[c][j] over the common columns j < c
+            double sum = l.values[i];
+            cml_u32 p = begin;
+            cml_u32 q = l.row_offsets[c];
+            while (p < i && q < l.row_offsets[c + 1] - 1) {
+                if (l.col_indices[p] < l.col_indices[q]) {
+                    p++;
+                } else if (l.col_indices[p] > l.col_indices[q]) {
+                    q++;
+                } else {
+                    sum -= (double)l.values[p++] * l.values[q++];
+                }
+            }
+
+            if (c < r) {
+                l.values[i] = (float)(sum / l.values[l.row_offsets[c + 1] - 1]);
+            } else if (sum > 0.0) {
+                l.values[i] = (float)sqrt(sum);
+            } else {
+                cml_sparse_free(&l);
+                return FALSE;
+            }
+        }
+    }
+
+    out->l = l;
+    return TRUE;
+}
+
+void cml_ic0_free(cml_ic0* ic) {
+    cml_sparse_free(&ic->l);
+}
+
+void cml_ic0_apply(const float* r, float* z, void* arg) {
+    const cml_sparse* l = &((const cml_ic0*)arg)->l;
+    cml_u32 n = l->rows;
+
+    // l * y = r
+    for (cml_u32 i = 0; i < n; i++) {
+        cml_u32 diagonal = l->row_offsets[i + 1] - 1;
+        float sum = r[i];
+        for (cml_u32 k = l->row_offsets[i]; k < diagonal; k++) {
+            sum -= l->values[k] * z[l->col_indices[k]];
+        }
+        z[i] = sum / l->values[diagonal];
+    }
+
+    // transpose(l) * z = y, column oriented over the rows of l
+    for (cml_u32 i = n; i-- > 0;) {
+        cml_u32 diagonal = l->row_offsets[i + 1] - 1;
+        z[i] /= l->values[diagonal];
+        for (cml_u32 k = l->row_offsets[i]; k < diagonal; k++) {
+            z[l->col_indices[k]] -= l->values[k] * z[i];
+        }
+    }
+}
@@ -0,0 +1,125 @@
+#ifndef CML_ITERATIVE_INCLUDED
+#define CML_ITERATIVE_INCLUDED
+
+#include "internal/cml_core.h"
+#include "sparse.h"
+
+/*
+    Iterative solvers for large linear systems a * x = b.
+    The matrix is only accessed through a linear operator,
+    so it can be a cml_sparse (see cml_sparse_linear_op()) or
+    any matrix free product; the memory needed on top of it
+    is a few vectors of n floats.
+*/
+
+/*
+    Computes y = op(x). "arg" is passed through unchanged.
+*/
+typedef void (*cml_linear_op)(const float* x, float* y, void* arg);
+
+/*
+    Linear operator of a cml_sparse, pass the matrix as "arg".
+*/
+void cml_sparse_linear_op(const float* x, float* y, void* arg);
+
+typedef struct {
+    cml_u32 max_iterations;
+    /*
+        The iteration stops once |b - a * x| <= tolerance * |b|.
+    */
+    float tolerance;
+    /*
+        Applies the preconditioner z = inverse(m) * r, NULL
+        for none.
+    */
+    cml_linear_op preconditioner;
+    void* preconditioner_arg;
+} cml_solver_settings;
+
+typedef struct {
+    cml_u32 iterations;
+    /*
+        Relative residual |b - a * x| / |b| of the returned x.
+    */
+    float residual;
+    BOOL converged;
+} cml_solver_result;
+
+/*
+    Returns 1000 iterations, a tolerance of 1e-5 and no
+    preconditioner.
+*/
+cml_solver_settings cml_solver_default_settings(void);
+
+/*
+    NOTE: a has to be symmetric positive definite, and so
+          has the preconditioner.
+
+    Solves a * x = b with the preconditioned conjugate
+    gradient method. "x" holds the initial guess (warm start,
+    zero it for a cold start) and receives the solution.
+    Needs 4 vectors of n floats (3 without a preconditioner).
+*/
+cml_solver_result cml_cg(cml_linear_op a, void* a_arg, cml_u32 n,
+                         const float* b, float* x,
+                         const cml_solver_settings* settings);
+
+/*
+    Solves a * x = b for a general (non symmetric) a with the
+    right preconditioned BiCGSTAB method. "x" holds the
+    initial guess and receives the solution. Needs 7 vectors
+    of n floats (5 without a preconditioner).
+*/
+cml_solver_result cml_bicgstab(cml_linear_op a, void* a_arg, cml_u32 n,
+                               const float* b, float* x,
+                               const cml_solver_settings* settings);
+
+/*
+    Jacobi (diagonal) preconditioner. Zero diagonal entries
+    are treated as 1.
+*/
+typedef struct {
+    cml_u32 n;
+    float* inverse_diagonal;
+} cml_jacobi;
+
+cml_jacobi cml_jacobi_from_diagonal(const float* diagonal, cml_u32 n);
+
+cml_jacobi cml_jacobi_from_sparse(const cml_sparse* a);
+
+void cml_jacobi_free(cml_jacobi* jacobi);
+
+/*
+    Preconditioner callback, pass the cml_jacobi as "arg".
+*/
+void cml_jacobi_apply(const float* r, float* z, void* arg);
+
+/*
+    Zero fill-in incomplete Cholesky factor: "l" is lower
+    triangular with the pattern of the lower triangle of the
+    factored matrix, so it needs about half of its memory.
+*/
+typedef struct {
+    cml_sparse l;
+} cml_ic0;
+
+/*
+    NOTE: "a" has to be symmetric, only its lower triangle
+          is read.
+
+    Computes the incomplete Cholesky factorization of "a".
+    Returns FALSE (and allocates nothing) if a pivot is not
+    positive, which can happen for positive definite matrices
+    that are not diagonally dominant; cml_jacobi is the safe
+    fallback then.
+*/
+BOOL cml_ic0_factor(const cml_sparse* a, cml_ic0* out);
+
+void cml_ic0_free(cml_ic0* ic);
+
+/*
+    Preconditioner callback, pass the cml_ic0 as "arg".
+*/
+void cml_ic0_apply(const float* r, float* z, void* arg);
+
+#endif  // CML_ITERATIVE_INCLUDED
@@ -0,0 +1,470 @@
+#include "kdtree.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+
+/*
+    Depth of the top of the tree that is built on the calling
+    thread, the 2^depth subtrees below it are built in
+    parallel.
+*/
+#define CML_KDTREE_TASK_DEPTH 6
+
+/*
+    Bound on the depth of a median split tree over 2^32
+    points, used for the traversal stacks.
+*/
+#define CML_KDTREE_MAX_DEPTH 64
+
+/*
+    Returns the number of leaves of a tree over n points.
+    Median splits keep the sizes of a level within {v, v + 1},
+    so only the two counts have to be tracked.
+*/
+static cml_u32 cml_kdtree_leaves(cml_u32 n) {
+    cml_u32 v = n;
+    cml_u32 count_v = 1, count_v1 = 0;
+    cml_u32 leaves = 0;
+
+    for (;;) {
+        if (v + 1 <= CML_KDTREE_LEAF_SIZE) {
+            return leaves + count_v + count_v1;
+        }
+        if (v <= CML_KDTREE_LEAF_SIZE) {
+            leaves += count_v;
+            count_v = 0;
+        }
+
+        // v splits into v / 2 and v - v / 2, v + 1 likewise
+        cml_u32 next_v, next_v1;
+        if (v % 2 == 0) {
+            next_v = 2 * count_v + count_v1;
+            next_v1 = count_v1;
+        } else {
+            next_v = count_v;
+            next_v1 = count_v + 2 * count_v1;
+        }
+        v /= 2;
+        count_v = next_v;
+        count_v1 = next_v1;
+    }
+}
+
+static cml_u32 cml_kdtree_node_count(cml_u32 n) {
+    return n == 0 ? 0 : 2 * cml_kdtree_leaves(n) - 1;
+}
+
+typedef struct {
+    cml_u32 node;
+    cml_u32 begin, end;
+} cml_kdtree_task;
+
+typedef struct {
+    const float* source;
+    cml_kdtree* tree;
+    cml_kdtree_task* tasks;
+    cml_u32 task_count;
+} cml_kdtree_build_job;
+
+static float cml_kdtree_coord(const cml_kdtree_build_job* job, cml_u32 i,
+                              cml_u32 axis) {
+    return job->source[(size_t)i * job->tree->dimension + axis];
+}
+
+/*
+    Reorders indices[begin .. end - 1] so that indices[k]
+    holds the point that belongs there by "axis" with no
+    larger point before and no smaller one after it.
+*/
+static void cml_kdtree_select(const cml_kdtree_build_job* job,
+                              cml_u32* indices, cml_u32 begin, cml_u32 end,
+                              cml_u32 k, cml_u32 axis) {
+    cml_u32 lo = begin, hi = end - 1;
+
+    while (lo < hi) {
+        float pivot = cml_kdtree_coord(job, indices[lo + (hi - lo) / 2], axis);
+        cml_u32 i = lo, j = hi;
+
+        while (i <= j) {
+            while (cml_kdtree_coord(job, indices[i], axis) < pivot) {
+                i++;
+            }
+            while (cml_kdtree_coord(job, indices[j], axis) > pivot) {
+                j--;
+            }
+            if (i <= j) {
+                cml_u32 tmp = indices[i];
+                indices[i] = indices[j];
+                indices[j] = tmp;
+                i++;
+                if (j == 0) {
+                    break;
+                }
+                j--;
+            }
+        }
+
+        // lo .. j <= pivot <= i .. hi
+        if (k <= j) {
+            hi = j;
+        } else if (k >= i) {
+            lo = i;
+        } else {
+            return;
+        }
+    }
+}
+
+static void cml_kdtree_build_node(cml_kdtree_build_job* job, cml_u32 node,
+                                  cml_u32 begin, cml_u32 end, cml_u32 depth) {
+    cml_kdtree* tree = job->tree;
+    cml_kdtree_node* n = tree->nodes + node;
+    cml_u32 dimension = tree->dimension;
+    n->begin = begin;
+    n->end = end;
+
+    if (end - begin <= CML_KDTREE_LEAF_SIZE) {
+        n->axis = CML_KDTREE_LEAF;
+        n->split = 0.0f;
+        n->right = 0;
+
+        // the leaf points are copied in tree order
+        for (cml_u32 i = begin; i < end; i++) {
+            memcpy(tree->points + (size_t)i * dimension,
+                   job->source + (size_t)tree->indices[i] * dimension,
+                   dimension * sizeof(float));
+        }
+        return;
+    }
+
+    if (job->tasks && depth == CML_KDTREE_TASK_DEPTH) {
+        cml_kdtree_task* task = job->tasks + job->task_count++;
+        task->node = node;
+        task->begin = begin;
+        task->end = end;
+        return;
+    }
+
+    cml_u32 axis = 0;
+    float extent = -1.0f;
+    for (cml_u32 a = 0; a < dimension; a++) {
+        float min = cml_kdtree_coord(job, tree->indices[begin], a);
+        float max = min;
+        for (cml_u32 i = begin + 1; i < end; i++) {
+            float v = cml_kdtree_coord(job, tree->indices[i], a);
+            min = v < min ? v : min;
+            max = v > max ? v : max;
+        }
+        if (max - min > extent) {
+            extent = max - min;
+            axis = a;
+        }
+    }
+
+    cml_u32 mid = begin + (end - begin) / 2;
+    cml_kdtree_select(job, tree->indices, begin, end, mid, axis);
+
+    n->axis = axis;
+    n->split = cml_kdtree_coord(job, tree->indices[mid], axis);
+    n->right = node + 1 + cml_kdtree_node_count(mid - begin);
+
+    cml_kdtree_build_node(job, node + 1, begin, mid, depth + 1);
+    cml_kdtree_build_node(job, n->right, mid, end, depth + 1);
+}
+
+static void cml_kdtree_build_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_kdtree_build_job* job = arg;
+
+    for (cml_u32 t = begin; t < end; t++) {
+        const cml_kdtree_task* task = job->tasks + t;
+        cml_kdtree_build_node(job, task->node, task->begin, task->end,
+                              CML_KDTREE_TASK_DEPTH + 1);
+    }
+}
+
+cml_kdtree cml_kdtree_build(const float* points, cml_u32 count,
+                            cml_u32 dimension) {
+    assert(dimension > 0);
+
+    cml_kdtree ret;
+    ret.dimension = dimension;
+    ret.count = count;
+    ret.points = malloc((size_t)count * dimension * sizeof(float));
+    ret.indices = malloc(count * sizeof(cml_u32));
+    ret.node_count = cml_kdtree_node_count(count);
+    ret.nodes = malloc(ret.node_count * sizeof(cml_kdtree_node));
+
+    for (cml_u32 i = 0; i < count; i++) {
+        ret.indices[i] = i;
+    }
+    if (count == 0) {
+        return ret;
+    }
+
+    cml_kdtree_build_job job;
+    job.source = points;
+    job.tree = &ret;
+    job.tasks = NULL;
+    job.task_count = 0;
+
+    if ((cml_u64)count * dimension < CML_PARALLEL_THRESHOLD) {
+        cml_kdtree_build_node(&job, 0, 0, count, 0);
+        return ret;
+    }
+
+    // the top levels are split here, the subtrees below in parallel
+    job.tasks = malloc((1u << CML_KDTREE_TASK_DEPTH) * sizeof(cml_kdtree_task));
+    cml_kdtree_build_node(&job, 0, 0, count, 0);
+    cml_parallel_for(0, job.task_count, 1, cml_kdtree_build_range, &job);
+    free(job.tasks);
+    return ret;
+}
+
+cml_kdtree cml_kdtree_build_vectors(const vector* points, cml_u32 count) {
+    cml_u32 dimension = count > 0 ? points[0].dimension : 1;
+    float* packed = malloc((size_t)count * dimension * sizeof(float));
+
+    for (cml_u32 i = 0; i < count; i++) {
+        assert(points[i].dimension == dimension);
+        memcpy(packed + (size_t)i * dimension, points[i].values,
+               dimension * sizeof(float));
+    }
+
+    cml_kdtree ret = cml_kdtree_build(packed, count, dimension);
+    free(packed);
+    return ret;
+}
+
+void cml_kdtree_free(cml_kdtree* tree) {
+    free(tree->points);
+    free(tree->indices);
+    free(tree->nodes);
+    tree->points = NULL;
+    tree->indices = NULL;
+    tree->nodes = NULL;
+    tree->count = 0;
+    tree->node_count = 0;
+}
+
+static float cml_kdtree_distance2(const float* a, const float* b,
+                                  cml_u32 dimension) {
+    float sum = 0.0f;
+    for (cml_u32 i = 0; i < dimension; i++) {
+        float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+/*
+    Restores the max heap property below "i".
+*/
+static void cml_kdtree_sift_down(cml_u32* indices, float* distances,
+                                 cml_u32 count, cml_u32 i) {
+    for (;;) {
+        cml_u32 largest = i;
+        cml_u32 l = 2 * i + 1, r = 2 * i + 2;
+        if (l < count && distances[l] > distances[largest]) {
+            largest = l;
+        }
+        if (r < count && distances[r] > distances[largest]) {
+            largest = r;
+        }
+        if (largest == i) {
+            return;
+        }
+
+        float d = distances[i];
+        distances[i] = distances[largest];
+        distances[largest] = d;
+        cml_u32 t = indices[i];
+        indices[i] = indices[largest];
+        indices[largest] = t;
+        i = largest;
+    }
+}
+
+typedef struct {
+    cml_u32 node;
+    float bound;
+} cml_kdtree_entry;
+
+cml_u32 cml_kdtree_knn(const cml_kdtree* tree, const float* query, cml_u32 k,
+                       cml_u32* indices, float* distances) {
+    if (k == 0 || tree->count == 0) {
+        return 0;
+    }
+
+    cml_u32 dimension = tree->dimension;
+    cml_u32 found = 0;
+
+    // indices / distances hold a max heap of the k best so far
+    cml_kdtree_entry stack[CML_KDTREE_MAX_DEPTH];
+    cml_u32 top = 0;
+    stack[top].node = 0;
+    stack[top++].bound = 0.0f;
+
+    while (top > 0) {
+        cml_kdtree_entry entry = stack[--top];
+        if (found == k && entry.bound >= distances[0]) {
+            continue;
+        }
+
+        const cml_kdtree_node* n = tree->nodes + entry.node;
+        while (n->axis != CML_KDTREE_LEAF) {
+            float d = query[n->axis] - n->split;
+            cml_u32 near = d < 0.0f ? (cml_u32)(n - tree->nodes) + 1 : n->right;
+            cml_u32 far = d < 0.0f ? n->right : (cml_u32)(n - tree->nodes) + 1;
+
+            // the far side is at least as far as the split plane
+            float bound = d * d > entry.bound ? d * d : entry.bound;
+            if (found < k || bound < distances[0]) {
+                stack[top].node = far;
+                stack[top++].bound = bound;
+            }
+            n = tree->nodes + near;
+        }
+
+        for (cml_u32 i = n->begin; i < n->end; i++) {
+            float d = cml_kdtree_distance2(
+                query, tree->points + (size_t)i * dimension, dimension);
+
+            if (found < k) {
+                // sift the new element up
+                cml_u32 c = found++;
+                while (c > 0 && distances[(c - 1) / 2] < d) {
+                    distances[c] = distances[(c - 1) / 2];
+                    indices[c] = indices[(c - 1) / 2];
+                    c = (c - 1) / 2;
+                }
+                distances[c] = d;
+                indices[c] = tree->indices[i];
+            } else if (d < distances[0]) {
+                distances[0] = d;
+                indices[0] = tree->indices[i];
+                cml_kdtree_sift_down(indices, distances, found, 0);
+            }
+        }
+    }
+
+    // heap sort, nearest first
+    for (cml_u32 end = found; end-- > 1;) {
+        float d = distances[0];
+        distances[0] = distances[end];
+        distances[end] = d;
+        cml_u32 t = indices[0];
+        indices[0] = indices[end];
+        indices[end] = t;
+        cml_kdtree_sift_down(indices, distances, end, 0);
+    }
+    return found;
+}
+
+cml_u32 cml_kdtree_radius(const cml_kdtree* tree, const float* query,
+                          float radius, cml_u32* indices, cml_u32 capacity) {
+    if (tree->count == 0) {
+        return 0;
+    }
+
+    cml_u32 dimension = tree->dimension;
+    float radius2 = radius * radius;
+    cml_u32 found = 0;
+
+    cml_kdtree_entry stack[CML_KDTREE_MAX_DEPTH];
+    cml_u32 top = 0;
+    stack[top].node = 0;
+    stack[top++].bound = 0.0f;
+
+    while (top > 0) {
+        cml_kdtree_entry entry = stack[--top];
+
+        const cml_kdtree_node* n = tree->nodes + entry.node;
+        while (n->axis != CML_KDTREE_LEAF) {
+            float d = query[n->axis] - n->split;
+            cml_u32 near = d < 0.0f ? (cml_u32)(n - tree->nodes) + 1 : n->right;
+            cml_u32 far = d < 0.0f ? n->right : (cml_u32)(n - tree->nodes) + 1;
+
+            float bound = d * d > entry.bound ? d * d : entry.bound;
+            if (bound <= radius2) {
+                stack[top].node = far;
+                stack[top++].bound = bound;
+            }
+            n = tree->nodes + near;
+        }
+
+        for (cml_u32 i = n->begin; i < n->end; i++) {
+            float d = cml_kdtree_distance2(
+                query, tree->points + (size_t)i * dimension, dimension);
+            if (d <= radius2) {
+                if (found < capacity) {
+                    indices[found] = tree->indices[i];
+                }
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+typedef struct {
+    const cml_kdtree* tree;
+    const float* queries;
+    cml_u32 k;
+    float radius;
+    cml_u32* indices;
+    float* distances;
+    cml_u32* counts;
+} cml_kdtree_query_job;
+
+static void cml_kdtree_knn_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_kdtree_query_job* job = arg;
+    cml_u32 dimension = job->tree->dimension;
+
+    for (cml_u32 q = begin; q < end; q++) {
+        cml_kdtree_knn(job->tree, job->queries + (size_t)q * dimension, job->k,
+                       job->indices + (size_t)q * job->k,
+                       job->distances + (size_t)q * job->k);
+    }
+}
+
+void cml_kdtree_knn_batch(const cml_kdtree* tree, const float* queries,
+                          cml_u32 count, cml_u32 k, cml_u32* indices,
+                          float* distances) {
+    cml_kdtree_query_job job;
+    job.tree = tree;
+    job.queries = queries;
+    job.k = k;
+    job.indices = indices;
+    job.distances = distances;
+
+    // every query is a tree traversal, so batches are split early
+    cml_parallel_for(0, count, 64, cml_kdtree_knn_range, &job);
+}
+
+static void cml_kdtree_radius_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_kdtree_query_job* job = arg;
+    cml_u32 dimension = job->tree->dimension;
+
+    for (cml_u32 q = begin; q < end; q++) {
+        job->counts[q] = cml_kdtree_radius(
+            job->tree, job->queries + (size_t)q * dimension, job->radius,
+            job->indices + (size_t)q * job->k, job->k);
+    }
+}
+
+void cml_kdtree_radius_batch(const cml_kdtree* tree, const float* queries,
+                             cml_u32 count, float radius, cml_u32* indices,
+                             cml_u32 capacity, cml_u32* counts) {
+    cml_kdtree_query_job job;
+    job.tree = tree;
+    job.queries = queries;
+    job.k = capacity;
+    job.radius = radius;
+    job.indices = indices;
+    job.counts = counts;
+
+    cml_parallel_for(0, count, 64, cml_kdtree_radius_range, &job);
+}
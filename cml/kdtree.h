@@ -0,0 +1,101 @@
+#ifndef CML_KDTREE_INCLUDED
+#define CML_KDTREE_INCLUDED
+
+#include "internal/cml_core.h"
+#include "vector.h"
+
+/*
+    Maximum number of points in a leaf.
+*/
+#define CML_KDTREE_LEAF_SIZE 8
+
+/*
+    "axis" of a leaf node.
+*/
+#define CML_KDTREE_LEAF 0xffffffffu
+
+/*
+    Node of the tree. The nodes are stored depth first, so
+    the left child of node i is node i + 1 and only the
+    right child is linked. Every node covers the points
+    begin .. end - 1, a leaf has "axis" == CML_KDTREE_LEAF.
+*/
+typedef struct {
+    float split;
+    cml_u32 axis;
+    cml_u32 right;
+    cml_u32 begin, end;
+} cml_kdtree_node;
+
+/*
+    k-d tree over "count" points of "dimension" floats. The
+    points are copied in tree order, so a leaf is one
+    contiguous block; indices[i] is the index the i-th stored
+    point had in the input.
+*/
+typedef struct {
+    cml_u32 dimension;
+    cml_u32 count;
+    float* points;
+    cml_u32* indices;
+    cml_kdtree_node* nodes;
+    cml_u32 node_count;
+} cml_kdtree;
+
+/*
+    Builds a tree over "count" points stored one after
+    another (point i at points[i * dimension]). Every node
+    splits its points at the median of the axis with the
+    largest extent. Large trees build their subtrees on the
+    thread pool.
+*/
+cml_kdtree cml_kdtree_build(const float* points, cml_u32 count,
+                            cml_u32 dimension);
+
+/*
+    NOTE: all points have to have the same dimension.
+
+    Builds a tree over an array of vectors.
+*/
+cml_kdtree cml_kdtree_build_vectors(const vector* points, cml_u32 count);
+
+void cml_kdtree_free(cml_kdtree* tree);
+
+/*
+    Finds the k points closest to "query" and writes their
+    input indices and squared distances, nearest first, to
+    "indices" and "distances" (k elements each). Returns the
+    number of points found, min(k, count).
+*/
+cml_u32 cml_kdtree_knn(const cml_kdtree* tree, const float* query, cml_u32 k,
+                       cml_u32* indices, float* distances);
+
+/*
+    Finds the points within "radius" of "query" and writes
+    the input indices of up to "capacity" of them (in no
+    particular order) to "indices". Returns the number of
+    points in the radius, which may exceed "capacity".
+*/
+cml_u32 cml_kdtree_radius(const cml_kdtree* tree, const float* query,
+                          float radius, cml_u32* indices, cml_u32 capacity);
+
+/*
+    Runs cml_kdtree_knn() for "count" queries (query q at
+    queries[q * dimension]), the results of query q start at
+    indices[q * k] and distances[q * k]. Large batches run
+    on the thread pool.
+*/
+void cml_kdtree_knn_batch(const cml_kdtree* tree, const float* queries,
+                          cml_u32 count, cml_u32 k, cml_u32* indices,
+                          float* distances);
+
+/*
+    Runs cml_kdtree_radius() for "count" queries, query q
+    writes up to "capacity" indices to indices[q * capacity]
+    and its number of points to counts[q].
+*/
+void cml_kdtree_radius_batch(const cml_kdtree* tree, const float* queries,
+                             cml_u32 count, float radius, cml_u32* indices,
+                             cml_u32 capacity, cml_u32* counts);
+
+#endif  // CML_KDTREE_INCLUDED
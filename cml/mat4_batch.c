@@ -0,0 +1,372 @@
+#include "mat4_batch.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal/cml_simd.h"
+#include "parallel.h"
+
+#define CML_MAT4_BLOCK (16 * CML_MAT4_BATCH_WIDTH)
+
+/*
+    Lane type that holds one element of all matrices of a
+    block: one AVX register, two SSE registers or a plain
+    array for the scalar fallback.
+*/
+#if defined(CML_SIMD_AVX)
+
+typedef __m256 cml_mb;
+
+static inline cml_mb mb_load(const float* p) { return _mm256_loadu_ps(p); }
+static inline void mb_store(float* p, cml_mb a) { _mm256_storeu_ps(p, a); }
+static inline cml_mb mb_set(float x) { return _mm256_set1_ps(x); }
+static inline cml_mb mb_add(cml_mb a, cml_mb b) { return _mm256_add_ps(a, b); }
+static inline cml_mb mb_sub(cml_mb a, cml_mb b) { return _mm256_sub_ps(a, b); }
+static inline cml_mb mb_mul(cml_mb a, cml_mb b) { return _mm256_mul_ps(a, b); }
+static inline cml_mb mb_div(cml_mb a, cml_mb b) { return _mm256_div_ps(a, b); }
+
+#elif defined(CML_SIMD_SSE)
+
+typedef struct {
+    __m128 lo, hi;
+} cml_mb;
+
+static inline cml_mb mb_load(const float* p) {
+    cml_mb ret = {_mm_loadu_ps(p), _mm_loadu_ps(p + 4)};
+    return ret;
+}
+static inline void mb_store(float* p, cml_mb a) {
+    _mm_storeu_ps(p, a.lo);
+    _mm_storeu_ps(p + 4, a.hi);
+}
+static inline cml_mb mb_set(float x) {
+    cml_mb ret = {_mm_set1_ps(x), _mm_set1_ps(x)};
+    return ret;
+}
+static inline cml_mb mb_add(cml_mb a, cml_mb b) {
+    cml_mb ret = {_mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi)};
+    return ret;
+}
+static inline cml_mb mb_sub(cml_mb a, cml_mb b) {
+    cml_mb ret = {_mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi)};
+    return ret;
+}
+static inline cml_mb mb_mul(cml_mb a, cml_mb b) {
+    cml_mb ret = {_mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi)};
+    return ret;
+}
+static inline cml_mb mb_div(cml_mb a, cml_mb b) {
+    cml_mb ret = {_mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi)};
+    return ret;
+}
+
+#else
+
+typedef struct {
+    float v[CML_MAT4_BATCH_WIDTH];
+} cml_mb;
+
+#define CML_MB_LANES(expr)                                \
+    cml_mb ret;                                           \
+    for (cml_u32 l = 0; l < CML_MAT4_BATCH_WIDTH; l++) {  \
+        ret.v[l] = expr;                                  \
+    }                                                     \
+    return ret
+
+static inline cml_mb mb_load(const float* p) { CML_MB_LANES(p[l]); }
+static inline void mb_store(float* p, cml_mb a) {
+    memcpy(p, a.v, sizeof(a.v));
+}
+static inline cml_mb mb_set(float x) { CML_MB_LANES(x); }
+static inline cml_mb mb_add(cml_mb a, cml_mb b) {
+    CML_MB_LANES(a.v[l] + b.v[l]);
+}
+static inline cml_mb mb_sub(cml_mb a, cml_mb b) {
+    CML_MB_LANES(a.v[l] - b.v[l]);
+}
+static inline cml_mb mb_mul(cml_mb a, cml_mb b) {
+    CML_MB_LANES(a.v[l] * b.v[l]);
+}
+static inline cml_mb mb_div(cml_mb a, cml_mb b) {
+    CML_MB_LANES(a.v[l] / b.v[l]);
+}
+
+#endif
+
+static cml_u32 cml_mat4_batch_blocks(cml_u32 count) {
+    return (count + CML_MAT4_BATCH_WIDTH - 1) / CML_MAT4_BATCH_WIDTH;
+}
+
+static float* cml_mat4_batch_element(const cml_mat4_batch* b, cml_u32 index,
+                                     cml_u32 e) {
+    return b->values + (index / CML_MAT4_BATCH_WIDTH) * CML_MAT4_BLOCK +
+           e * CML_MAT4_BATCH_WIDTH + index % CML_MAT4_BATCH_WIDTH;
+}
+
+cml_mat4_batch cml_mat4_batch_allocate(cml_u32 count) {
+    cml_mat4_batch ret;
+
+    ret.count = count;
+    ret.values = calloc((size_t)cml_mat4_batch_blocks(count) * CML_MAT4_BLOCK,
+                        sizeof(float));
+
+    return ret;
+}
+
+void cml_mat4_batch_free(cml_mat4_batch* b) {
+    free(b->values);
+    b->values = NULL;
+    b->count = 0;
+}
+
+void cml_mat4_batch_set(cml_mat4_batch* b, cml_u32 index, matrix m) {
+    assert(index < b->count && m.rows == 4 && m.cols == 4);
+
+    for (cml_u32 e = 0; e < 16; e++) {
+        *cml_mat4_batch_element(b, index, e) = m.values[e / 4][e % 4];
+    }
+}
+
+matrix cml_mat4_batch_get(const cml_mat4_batch* b, cml_u32 index) {
+    assert(index < b->count);
+
+    matrix ret = cml_matrix_allocate(4, 4);
+    for (cml_u32 e = 0; e < 16; e++) {
+        ret.values[e / 4][e % 4] = *cml_mat4_batch_element(b, index, e);
+    }
+    return ret;
+}
+
+void cml_mat4_batch_pack(cml_mat4_batch* b, const float* src) {
+    for (cml_u32 i = 0; i < b->count; i++) {
+        for (cml_u32 e = 0; e < 16; e++) {
+            *cml_mat4_batch_element(b, i, e) = src[i * 16 + e];
+        }
+    }
+}
+
+void cml_mat4_batch_unpack(const cml_mat4_batch* b, float* dst) {
+    for (cml_u32 i = 0; i < b->count; i++) {
+        for (cml_u32 e = 0; e < 16; e++) {
+            dst[i * 16 + e] = *cml_mat4_batch_element(b, i, e);
+        }
+    }
+}
+
+typedef enum {
+    CML_MAT4_MULT,
+    CML_MAT4_MULT_BY,
+    CML_MAT4_PREMULT_BY,
+    CML_MAT4_INVERSE,
+    CML_MAT4_TRANSPOSE
+} cml_mat4_batch_op;
+
+typedef struct {
+    float* dst;
+    const float* a;
+    const float* b;
+    float m[16];
+    cml_mat4_batch_op op;
+} cml_mat4_batch_job;
+
+static void cml_mat4_block_mult(cml_mb* out, const cml_mb* a,
+                                const cml_mb* b) {
+    for (cml_u32 r = 0; r < 4; r++) {
+        for (cml_u32 c = 0; c < 4; c++) {
+            cml_mb sum = mb_mul(a[r * 4], b[c]);
+            sum = mb_add(sum, mb_mul(a[r * 4 + 1], b[4 + c]));
+            sum = mb_add(sum, mb_mul(a[r * 4 + 2], b[8 + c]));
+            out[r * 4 + c] = mb_add(sum, mb_mul(a[r * 4 + 3], b[12 + c]));
+        }
+    }
+}
+
+/*
+    Inverse through the 2x2 sub-determinants of the upper
+    (s) and lower (c) two rows.
+*/
+static void cml_mat4_block_inverse(cml_mb* out, const cml_mb* m) {
+#define M(r, c) m[(r) * 4 + (c)]
+#define DET2(a, b, c, d) mb_sub(mb_mul(a, b), mb_mul(c, d))
+    cml_mb s0 = DET2(M(0, 0), M(1, 1), M(1, 0), M(0, 1));
+    cml_mb s1 = DET2(M(0, 0), M(1, 2), M(1, 0), M(0, 2));
+    cml_mb s2 = DET2(M(0, 0), M(1, 3), M(1, 0), M(0, 3));
+    cml_mb s3 = DET2(M(0, 1), M(1, 2), M(1, 1), M(0, 2));
+    cml_mb s4 = DET2(M(0, 1), M(1, 3), M(1, 1), M(0, 3));
+    cml_mb s5 = DET2(M(0, 2), M(1, 3), M(1, 2), M(0, 3));
+
+    cml_mb c0 = DET2(M(2, 0), M(3, 1), M(3, 0), M(2, 1));
+    cml_mb c1 = DET2(M(2, 0), M(3, 2), M(3, 0), M(2, 2));
+    cml_mb c2 = DET2(M(2, 0), M(3, 3), M(3, 0), M(2, 3));
+    cml_mb c3 = DET2(M(2, 1), M(3, 2), M(3, 1), M(2, 2));
+    cml_mb c4 = DET2(M(2, 1), M(3, 3), M(3, 1), M(2, 3));
+    cml_mb c5 = DET2(M(2, 2), M(3, 3), M(3, 2), M(2, 3));
+
+    cml_mb det = mb_add(mb_sub(mb_mul(s0, c5), mb_mul(s1, c4)),
+                        mb_add(mb_mul(s2, c3), mb_mul(s3, c2)));
+    det = mb_add(det, mb_sub(mb_mul(s5, c0), mb_mul(s4, c1)));
+    cml_mb inv = mb_div(mb_set(1.0f), det);
+
+    // x * a - y * b + z * c
+#define COF(x, a, y, b, z, c) \
+    mb_mul(mb_add(mb_sub(mb_mul(x, a), mb_mul(y, b)), mb_mul(z, c)), inv)
+#define NCOF(x, a, y, b, z, c) \
+    mb_mul(mb_sub(mb_sub(mb_mul(y, b), mb_mul(x, a)), mb_mul(z, c)), inv)
+
+    out[0] = COF(M(1, 1), c5, M(1, 2), c4, M(1, 3), c3);
+    out[1] = NCOF(M(0, 1), c5, M(0, 2), c4, M(0, 3), c3);
+    out[2] = COF(M(3, 1), s5, M(3, 2), s4, M(3, 3), s3);
+    out[3] = NCOF(M(2, 1), s5, M(2, 2), s4, M(2, 3), s3);
+
+    out[4] = NCOF(M(1, 0), c5, M(1, 2), c2, M(1, 3), c1);
+    out[5] = COF(M(0, 0), c5, M(0, 2), c2, M(0, 3), c1);
+    out[6] = NCOF(M(3, 0), s5, M(3, 2), s2, M(3, 3), s1);
+    out[7] = COF(M(2, 0), s5, M(2, 2), s2, M(2, 3), s1);
+
+    out[8] = COF(M(1, 0), c4, M(1, 1), c2, M(1, 3), c0);
+    out[9] = NCOF(M(0, 0), c4, M(0, 1), c2, M(0, 3), c0);
+    out[10] = COF(M(3, 0), s4, M(3, 1), s2, M(3, 3), s0);
+    out[11] = NCOF(M(2, 0), s4, M(2, 1), s2, M(2, 3), s0);
+
+    out[12] = NCOF(M(1, 0), c3, M(1, 1), c1, M(1, 2), c0);
+    out[13] = COF(M(0, 0), c3, M(0, 1), c1, M(0, 2), c0);
+    out[14] = NCOF(M(3, 0), s3, M(3, 1), s1, M(3, 2), s0);
+    out[15] = COF(M(2, 0), s3, M(2, 1), s1, M(2, 2), s0);
+#undef NCOF
+#undef COF
+#undef DET2
+#undef M
+}
+
+static void cml_mat4_batch_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_mat4_batch_job* job = arg;
+    cml_mb a[16], b[16], out[16];
+
+    if (job->op == CML_MAT4_MULT_BY || job->op == CML_MAT4_PREMULT_BY) {
+        for (cml_u32 e = 0; e < 16; e++) {
+            b[e] = mb_set(job->m[e]);
+        }
+    }
+
+    for (cml_u32 block = begin; block < end; block++) {
+        const float* pa = job->a + (size_t)block * CML_MAT4_BLOCK;
+        float* pd = job->dst + (size_t)block * CML_MAT4_BLOCK;
+
+        for (cml_u32 e = 0; e < 16; e++) {
+            a[e] = mb_load(pa + e * CML_MAT4_BATCH_WIDTH);
+        }
+
+        switch (job->op) {
+            case CML_MAT4_MULT: {
+                const float* pb = job->b + (size_t)block * CML_MAT4_BLOCK;
+                for (cml_u32 e = 0; e < 16; e++) {
+                    b[e] = mb_load(pb + e * CML_MAT4_BATCH_WIDTH);
+                }
+                cml_mat4_block_mult(out, a, b);
+                break;
+            }
+            case CML_MAT4_MULT_BY:
+                cml_mat4_block_mult(out, a, b);
+                break;
+            case CML_MAT4_PREMULT_BY:
+                cml_mat4_block_mult(out, b, a);
+                break;
+            case CML_MAT4_INVERSE:
+                cml_mat4_block_inverse(out, a);
+                break;
+            case CML_MAT4_TRANSPOSE:
+                for (cml_u32 e = 0; e < 16; e++) {
+                    out[e] = a[(e % 4) * 4 + e / 4];
+                }
+                break;
+        }
+
+        for (cml_u32 e = 0; e < 16; e++) {
+            mb_store(pd + e * CML_MAT4_BATCH_WIDTH, out[e]);
+        }
+    }
+}
+
+static void cml_mat4_batch_run(cml_mat4_batch_job* job, cml_u32 count) {
+    cml_u32 blocks = cml_mat4_batch_blocks(count);
+
+    if ((cml_u64)blocks * CML_MAT4_BLOCK < CML_PARALLEL_THRESHOLD) {
+        cml_mat4_batch_range(0, blocks, job);
+        return;
+    }
+    cml_parallel_for(0, blocks, 64, cml_mat4_batch_range, job);
+}
+
+static void cml_mat4_batch_set_common(cml_mat4_batch_job* job, matrix m) {
+    assert(m.rows == 4 && m.cols == 4);
+
+    for (cml_u32 e = 0; e < 16; e++) {
+        job->m[e] = m.values[e / 4][e % 4];
+    }
+}
+
+void cml_mat4_batch_mult(cml_mat4_batch* dst, const cml_mat4_batch* a,
+                         const cml_mat4_batch* b) {
+    assert(dst->count == a->count && a->count == b->count);
+
+    cml_mat4_batch_job job;
+    job.dst = dst->values;
+    job.a = a->values;
+    job.b = b->values;
+    job.op = CML_MAT4_MULT;
+
+    cml_mat4_batch_run(&job, a->count);
+}
+
+void cml_mat4_batch_mult_by(cml_mat4_batch* dst, const cml_mat4_batch* a,
+                            matrix m) {
+    assert(dst->count == a->count);
+
+    cml_mat4_batch_job job;
+    job.dst = dst->values;
+    job.a = a->values;
+    job.b = NULL;
+    job.op = CML_MAT4_MULT_BY;
+    cml_mat4_batch_set_common(&job, m);
+
+    cml_mat4_batch_run(&job, a->count);
+}
+
+void cml_mat4_batch_premult_by(cml_mat4_batch* dst, matrix m,
+                               const cml_mat4_batch* a) {
+    assert(dst->count == a->count);
+
+    cml_mat4_batch_job job;
+    job.dst = dst->values;
+    job.a = a->values;
+    job.b = NULL;
+    job.op = CML_MAT4_PREMULT_BY;
+    cml_mat4_batch_set_common(&job, m);
+
+    cml_mat4_batch_run(&job, a->count);
+}
+
+void cml_mat4_batch_inverse(cml_mat4_batch* dst, const cml_mat4_batch* a) {
+    assert(dst->count == a->count);
+
+    cml_mat4_batch_job job;
+    job.dst = dst->values;
+    job.a = a->values;
+    job.b = NULL;
+    job.op = CML_MAT4_INVERSE;
+
+    cml_mat4_batch_run(&job, a->count);
+}
+
+void cml_mat4_batch_transpose(cml_mat4_batch* dst, const cml_mat4_batch* a) {
+    assert(dst->count == a->count);
+
+    cml_mat4_batch_job job;
+    job.dst = dst->values;
+    job.a = a->values;
+    job.b = NULL;
+    job.op = CML_MAT4_TRANSPOSE;
+
+    cml_mat4_batch_run(&job, a->count);
+}
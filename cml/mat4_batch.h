@@ -0,0 +1,89 @@
+#ifndef CML_MAT4_BATCH_INCLUDED
+#define CML_MAT4_BATCH_INCLUDED
+
+#include "internal/cml_core.h"
+#include "matrix.h"
+
+/*
+    Number of matrices that are interleaved in one block of
+    a batch. A block holds element e of its matrices next to
+    each other, so one AVX register (two SSE registers) holds
+    the same element of 8 matrices.
+*/
+#define CML_MAT4_BATCH_WIDTH 8
+
+/*
+    Array of 4x4 matrices in structure-of-arrays layout.
+    Element values[r][c] of matrix i is stored at
+
+        values[(i / W) * 16 * W + (r * 4 + c) * W + i % W]
+
+    with W = CML_MAT4_BATCH_WIDTH. The last block is padded
+    with zero matrices.
+*/
+typedef struct {
+    cml_u32 count;
+    float* values;
+} cml_mat4_batch;
+
+/*
+    Allocates a batch of "count" zero matrices.
+*/
+cml_mat4_batch cml_mat4_batch_allocate(cml_u32 count);
+
+void cml_mat4_batch_free(cml_mat4_batch* b);
+
+/*
+    Copies the 4x4 matrix "m" to / from the matrix at
+    "index" of the batch.
+*/
+void cml_mat4_batch_set(cml_mat4_batch* b, cml_u32 index, matrix m);
+
+matrix cml_mat4_batch_get(const cml_mat4_batch* b, cml_u32 index);
+
+/*
+    Copies b->count matrices stored one after another as 16
+    floats in the order values[0][0], values[0][1], ... into /
+    out of the batch.
+*/
+void cml_mat4_batch_pack(cml_mat4_batch* b, const float* src);
+
+void cml_mat4_batch_unpack(const cml_mat4_batch* b, float* dst);
+
+/*
+    NOTE: All batches passed to the following functions need
+          the same count. "dst" may be one of the inputs.
+
+    The functions process 8 matrices at a time with AVX (or
+    SSE, or scalar code) and run on the thread pool from
+    CML_PARALLEL_THRESHOLD elements on.
+
+    dst[i] = a[i] * b[i]
+*/
+void cml_mat4_batch_mult(cml_mat4_batch* dst, const cml_mat4_batch* a,
+                         const cml_mat4_batch* b);
+
+/*
+    dst[i] = a[i] * m
+*/
+void cml_mat4_batch_mult_by(cml_mat4_batch* dst, const cml_mat4_batch* a,
+                            matrix m);
+
+/*
+    dst[i] = m * a[i]
+*/
+void cml_mat4_batch_premult_by(cml_mat4_batch* dst, matrix m,
+                               const cml_mat4_batch* a);
+
+/*
+    dst[i] = inverse(a[i]). Singular matrices result in
+    infinite or NaN values.
+*/
+void cml_mat4_batch_inverse(cml_mat4_batch* dst, const cml_mat4_batch* a);
+
+/*
+    dst[i] = transpose(a[i])
+*/
+void cml_mat4_batch_transpose(cml_mat4_batch* dst, const cml_mat4_batch* a);
+
+#endif  // CML_MAT4_BATCH_INCLUDED
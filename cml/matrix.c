@@ -5,13 +5,17 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "internal/cml_elementwise.h"
+#include "internal/cml_simd.h"
+#include "parallel.h"
+
 matrix cml_matrix_allocate(cml_u32 rows, cml_u32 cols) {
     matrix ret;
 
     ret.cols = cols;
     ret.rows = rows;
 
-    ret.values = malloc(sizeof(float) * rows * cols);
+    ret.values = malloc(rows * sizeof(float*));
 
     for (cml_u32 i = 0; i < ret.rows; i++) {
         ret.values[i] = malloc(cols * sizeof(float));
@@ -70,6 +74,26 @@ matrix cml_matrix_copy_mem(matrix* m) {
     return ret;
 }
 
+matrix cml_matrix_clone(matrix m) {
+    matrix ret = cml_matrix_allocate(m.rows, m.cols);
+
+    for (cml_u32 r = 0; r < m.rows; r++) {
+        memcpy(ret.values[r], m.values[r], m.cols * sizeof(float));
+    }
+    return ret;
+}
+
+void cml_matrix_free_mem(matrix* m) {
+    for (cml_u32 r = 0; r < m->rows; r++) {
+        free(m->values[r]);
+    }
+    free(m->values);
+
+    m->values = NULL;
+    m->rows = 0;
+    m->cols = 0;
+}
+
 void cml_matrix_print(matrix m) {
     printf("\n");
     for (cml_u32 r = 0; r < m.rows; r++) {
@@ -144,78 +168,53 @@ matrix cml_matrix_to_col_vec(vector* v) {
 matrix cml_matrix_scaler_addition(matrix m, float scaler) {
     matrix ret = cml_matrix_allocate(m.rows, m.cols);
 
-    for (cml_u32 r = 0; r < ret.rows; r++) {
-        for (cml_u32 c = 0; c < ret.cols; c++) {
-            ret.values[r][c] = m.values[r][c] + scaler;
-        }
-    }
-
+    cml_elementwise_rows(ret.values, m.values, NULL, scaler,
+                         CML_OP_ADD_SCALER, ret.rows, ret.cols);
     return ret;
 }
 
 void cml_matrix_add_scaler(matrix* m, float scaler) {
-    for (cml_u32 r = 0; r < m->rows; r++) {
-        for (cml_u32 c = 0; c < m->cols; c++) {
-            m->values[r][c] += scaler;
-        }
-    }
+    cml_elementwise_rows(m->values, m->values, NULL, scaler,
+                         CML_OP_ADD_SCALER, m->rows, m->cols);
 }
 
 matrix cml_matrix_scaler_subst(matrix m, float scaler) {
     matrix ret = cml_matrix_allocate(m.rows, m.cols);
 
-    for (cml_u32 r = 0; r < ret.rows; r++) {
-        for (cml_u32 c = 0; c < ret.cols; c++) {
-            ret.values[r][c] = m.values[r][c] - scaler;
-        }
-    }
+    cml_elementwise_rows(ret.values, m.values, NULL, scaler,
+                         CML_OP_SUBST_SCALER, ret.rows, ret.cols);
     return ret;
 }
 
 void cml_matrix_subst_scaler(matrix* m, float scaler) {
-    for (cml_u32 r = 0; r < m->rows; r++) {
-        for (cml_u32 c = 0; c < m->cols; c++) {
-            m->values[r][c] -= scaler;
-        }
-    }
+    cml_elementwise_rows(m->values, m->values, NULL, scaler,
+                         CML_OP_SUBST_SCALER, m->rows, m->cols);
 }
 
 matrix cml_matrix_scaler_mult(matrix m, float scaler) {
     matrix ret = cml_matrix_allocate(m.rows, m.cols);
 
-    for (cml_u32 r = 0; r < ret.rows; r++) {
-        for (cml_u32 c = 0; c < ret.cols; c++) {
-            ret.values[r][c] = m.values[r][c] * scaler;
-        }
-    }
+    cml_elementwise_rows(ret.values, m.values, NULL, scaler,
+                         CML_OP_MULT_SCALER, ret.rows, ret.cols);
     return ret;
 }
 
 void cml_matrix_mult_by_scaler(matrix* m, float scaler) {
-    for (cml_u32 r = 0; r < m->rows; r++) {
-        for (cml_u32 c = 0; c < m->cols; c++) {
-            m->values[r][c] *= scaler;
-        }
-    }
+    cml_elementwise_rows(m->values, m->values, NULL, scaler,
+                         CML_OP_MULT_SCALER, m->rows, m->cols);
 }
 
 matrix cml_matrix_scaler_div(matrix m, float scaler) {
     matrix ret = cml_matrix_allocate(m.rows, m.cols);
 
-    for (cml_u32 r = 0; r < ret.rows; r++) {
-        for (cml_u32 c = 0; c < ret.cols; c++) {
-            ret.values[r][c] = m.values[r][c] / scaler;
-        }
-    }
+    cml_elementwise_rows(ret.values, m.values, NULL, scaler,
+                         CML_OP_DIV_SCALER, ret.rows, ret.cols);
     return ret;
 }
 
 void cml_matrix_div_by_scaler(matrix* m, float scaler) {
-    for (cml_u32 r = 0; r < m->rows; r++) {
-        for (cml_u32 c = 0; c < m->cols; c++) {
-            m->values[r][c] /= scaler;
-        }
-    }
+    cml_elementwise_rows(m->values, m->values, NULL, scaler,
+                         CML_OP_DIV_SCALER, m->rows, m->cols);
 }
 
 matrix cml_mat_mat_addition(matrix m1, matrix m2) {
@@ -223,22 +222,16 @@ matrix cml_mat_mat_addition(matrix m1, matrix m2) {
 
     matrix ret = cml_matrix_allocate(m1.rows, m1.cols);
 
-    for (cml_u32 r = 0; r < m1.rows; r++) {
-        for (cml_u32 c = 0; c < m1.cols; c++) {
-            ret.values[r][c] = m1.values[r][c] + m2.values[r][c];
-        }
-    }
+    cml_elementwise_rows(ret.values, m1.values, m2.values, 0.0f, CML_OP_ADD,
+                         m1.rows, m1.cols);
     return ret;
 }
 
 void cml_add_mat_to_mat(matrix* m1, matrix m2) {
     assert(!(m1->rows != m2.rows || m1->cols != m2.cols));
 
-    for (cml_u32 r = 0; r < m1->rows; r++) {
-        for (cml_u32 c = 0; c < m1->cols; c++) {
-            m1->values[r][c] += m2.values[r][c];
-        }
-    }
+    cml_elementwise_rows(m1->values, m1->values, m2.values, 0.0f, CML_OP_ADD,
+                         m1->rows, m1->cols);
 }
 
 matrix cml_mat_mat_subst(matrix m1, matrix m2) {
@@ -246,22 +239,16 @@ matrix cml_mat_mat_subst(matrix m1, matrix m2) {
 
     matrix ret = cml_matrix_allocate(m1.rows, m1.cols);
 
-    for (cml_u32 r = 0; r < m1.rows; r++) {
-        for (cml_u32 c = 0; c < m1.cols; c++) {
-            ret.values[r][c] = m1.values[r][c] - m2.values[r][c];
-        }
-    }
+    cml_elementwise_rows(ret.values, m1.values, m2.values, 0.0f, CML_OP_SUBST,
+                         m1.rows, m1.cols);
     return ret;
 }
 
 void cml_subst_mat_from_mat(matrix* m1, matrix m2) {
     assert(!(m1->rows != m2.rows || m1->cols != m2.cols));
 
-    for (cml_u32 r = 0; r < m1->rows; r++) {
-        for (cml_u32 c = 0; c < m1->cols; c++) {
-            m1->values[r][c] -= m2.values[r][c];
-        }
-    }
+    cml_elementwise_rows(m1->values, m1->values, m2.values, 0.0f, CML_OP_SUBST,
+                         m1->rows, m1->cols);
 }
 
 matrix cml_mat_mat_mult(matrix m1, matrix m2) {
@@ -309,17 +296,161 @@ vector cml_matrix_vec_mult(matrix m, vector v) {
     return ret;
 }
 
+/*
+    Edge length of the square blocks a transpose works on.
+    A block of source and destination rows stays in L1.
+*/
+#define CML_TRANSPOSE_BLOCK 32
+
+/*
+    dst[c..c+4][r..r+4] = transposed src[r..r+4][c..c+4]
+*/
+static void cml_transpose_tile4(float** dst, float** src, cml_u32 r,
+                                cml_u32 c) {
+#ifdef CML_SIMD_SSE
+    __m128 r0 = _mm_loadu_ps(src[r] + c);
+    __m128 r1 = _mm_loadu_ps(src[r + 1] + c);
+    __m128 r2 = _mm_loadu_ps(src[r + 2] + c);
+    __m128 r3 = _mm_loadu_ps(src[r + 3] + c);
+
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    _mm_storeu_ps(dst[c] + r, r0);
+    _mm_storeu_ps(dst[c + 1] + r, r1);
+    _mm_storeu_ps(dst[c + 2] + r, r2);
+    _mm_storeu_ps(dst[c + 3] + r, r3);
+#else
+    for (cml_u32 i = 0; i < 4; i++) {
+        for (cml_u32 j = 0; j < 4; j++) {
+            dst[c + j][r + i] = src[r + i][c + j];
+        }
+    }
+#endif
+}
+
+/*
+    Exchanges the 4x4 tiles at (i, j) and (j, i) of a square
+    matrix and transposes both. i == j transposes the tile.
+*/
+static void cml_transpose_swap_tile4(float** m, cml_u32 i, cml_u32 j) {
+#ifdef CML_SIMD_SSE
+    __m128 a0 = _mm_loadu_ps(m[i] + j);
+    __m128 a1 = _mm_loadu_ps(m[i + 1] + j);
+    __m128 a2 = _mm_loadu_ps(m[i + 2] + j);
+    __m128 a3 = _mm_loadu_ps(m[i + 3] + j);
+    __m128 b0 = _mm_loadu_ps(m[j] + i);
+    __m128 b1 = _mm_loadu_ps(m[j + 1] + i);
+    __m128 b2 = _mm_loadu_ps(m[j + 2] + i);
+    __m128 b3 = _mm_loadu_ps(m[j + 3] + i);
+
+    _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+    _MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+
+    _mm_storeu_ps(m[j] + i, a0);
+    _mm_storeu_ps(m[j + 1] + i, a1);
+    _mm_storeu_ps(m[j + 2] + i, a2);
+    _mm_storeu_ps(m[j + 3] + i, a3);
+    _mm_storeu_ps(m[i] + j, b0);
+    _mm_storeu_ps(m[i + 1] + j, b1);
+    _mm_storeu_ps(m[i + 2] + j, b2);
+    _mm_storeu_ps(m[i + 3] + j, b3);
+#else
+    for (cml_u32 r = 0; r < 4; r++) {
+        for (cml_u32 c = (i == j) ? r + 1 : 0; c < 4; c++) {
+            swap_float(&m[i + r][j + c], &m[j + c][i + r]);
+        }
+    }
+#endif
+}
+
+typedef struct {
+    float** dst;
+    float** src;
+    cml_u32 rows, cols;
+} cml_transpose_job;
+
+static void cml_transpose_block_rows(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_transpose_job* job = arg;
+
+    for (cml_u32 block = begin; block < end; block++) {
+        cml_u32 r0 = block * CML_TRANSPOSE_BLOCK;
+        cml_u32 r1 = r0 + CML_TRANSPOSE_BLOCK < job->rows
+                         ? r0 + CML_TRANSPOSE_BLOCK
+                         : job->rows;
+
+        for (cml_u32 c0 = 0; c0 < job->cols; c0 += CML_TRANSPOSE_BLOCK) {
+            cml_u32 c1 = c0 + CML_TRANSPOSE_BLOCK < job->cols
+                             ? c0 + CML_TRANSPOSE_BLOCK
+                             : job->cols;
+
+            cml_u32 r = r0;
+            for (; r + 4 <= r1; r += 4) {
+                cml_u32 c = c0;
+                for (; c + 4 <= c1; c += 4) {
+                    cml_transpose_tile4(job->dst, job->src, r, c);
+                }
+                for (; c < c1; c++) {
+                    for (cml_u32 i = 0; i < 4; i++) {
+                        job->dst[c][r + i] = job->src[r + i][c];
+                    }
+                }
+            }
+            for (; r < r1; r++) {
+                for (cml_u32 c = c0; c < c1; c++) {
+                    job->dst[c][r] = job->src[r][c];
+                }
+            }
+        }
+    }
+}
+
 matrix cml_matrix_transpose(matrix* m) {
     matrix ret = cml_matrix_allocate(m->cols, m->rows);
 
-    for (cml_u32 r = 0; r < ret.rows; r++) {
-        for (cml_u32 c = 0; c < ret.cols; c++) {
-            ret.values[r][c] = m->values[c][r];
-        }
+    cml_transpose_job job = {ret.values, m->values, m->rows, m->cols};
+    cml_u32 blocks = (m->rows + CML_TRANSPOSE_BLOCK - 1) / CML_TRANSPOSE_BLOCK;
+
+    if ((cml_u64)m->rows * m->cols < CML_PARALLEL_THRESHOLD) {
+        cml_transpose_block_rows(0, blocks, &job);
+    } else {
+        cml_parallel_for(0, blocks, 1, cml_transpose_block_rows, &job);
     }
     return ret;
 }
 
+void cml_matrix_transpose_in_place(matrix* m) {
+    assert(m->rows == m->cols);
+
+    const cml_u32 n = m->rows;
+    const cml_u32 n4 = n & ~3u;
+
+    // pairs of blocks above and below the diagonal, tile by tile
+    for (cml_u32 bi = 0; bi < n4; bi += CML_TRANSPOSE_BLOCK) {
+        cml_u32 bi_end = bi + CML_TRANSPOSE_BLOCK < n4
+                             ? bi + CML_TRANSPOSE_BLOCK
+                             : n4;
+
+        for (cml_u32 bj = bi; bj < n4; bj += CML_TRANSPOSE_BLOCK) {
+            cml_u32 bj_end = bj + CML_TRANSPOSE_BLOCK < n4
+                                 ? bj + CML_TRANSPOSE_BLOCK
+                                 : n4;
+
+            for (cml_u32 i = bi; i < bi_end; i += 4) {
+                for (cml_u32 j = (bi == bj) ? i : bj; j < bj_end; j += 4) {
+                    cml_transpose_swap_tile4(m->values, i, j);
+                }
+            }
+        }
+    }
+
+    // columns that do not fill a whole tile
+    for (cml_u32 r = 0; r < n; r++) {
+        for (cml_u32 c = (r + 1 > n4) ? r + 1 : n4; c < n; c++) {
+            swap_float(&m->values[r][c], &m->values[c][r]);
+        }
+    }
+}
+
 void cml_matrix_swap_rows(matrix* m, cml_u32 row_1, cml_u32 row_2) {
     row_1--;
     row_2--;
@@ -363,6 +494,48 @@ void cml_matrix_add_mulitple_rows(matrix* m, cml_u32 row_1, cml_u32 row_2,
     }
 }
 
+typedef struct {
+    matrix* m;
+    cml_u32 pivot_row, pivot_col;
+} cml_matrix_eliminate_job;
+
+static void cml_matrix_eliminate_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_matrix_eliminate_job* job = arg;
+
+    const float* pivot = job->m->values[job->pivot_row];
+
+    for (cml_u32 r = begin; r < end; r++) {
+        float* row = job->m->values[r];
+        float factor = row[job->pivot_col];
+
+        if (r == job->pivot_row || factor == 0.0f) {
+            continue;
+        }
+
+        // the pivot row is zero left of the pivot column
+        for (cml_u32 c = job->pivot_col; c < job->m->cols; c++) {
+            row[c] -= factor * pivot[c];
+        }
+    }
+}
+
+/*
+    Eliminates the pivot column from all rows starting at
+    "first_row" (except the pivot row itself). Large matrices
+    distribute the rows over the thread pool.
+*/
+static void cml_matrix_eliminate(matrix* m, cml_u32 pivot_row,
+                                 cml_u32 pivot_col, cml_u32 first_row) {
+    cml_matrix_eliminate_job job = {m, pivot_row, pivot_col};
+
+    if ((cml_u64)(m->rows - first_row) * m->cols < CML_PARALLEL_THRESHOLD) {
+        cml_matrix_eliminate_range(first_row, m->rows, &job);
+        return;
+    }
+
+    cml_parallel_for(first_row, m->rows, 0, cml_matrix_eliminate_range, &job);
+}
+
 void cml_matrix_row_echelon_form(matrix* m) {
     cml_u32 crnt_row = 0;
     for (cml_u32 c = 0; c < m->cols; c++) {
@@ -387,10 +560,7 @@ void cml_matrix_row_echelon_form(matrix* m) {
             m->values[crnt_row][col] *= factor;
         }
 
-        for (r = crnt_row + 1; r < m->rows; r++) {
-            cml_matrix_add_mulitple_rows(m, r + 1, crnt_row + 1,
-                                         -1 * m->values[r][c]);
-        }
+        cml_matrix_eliminate(m, crnt_row, c, crnt_row + 1);
 
         crnt_row++;
     }
@@ -421,13 +591,7 @@ void cml_matrix_reduced_row_echelon_form(matrix* m) {
             m->values[crnt_row][col] *= factor;
         }
 
-        for (r = 0; r < m->rows; r++) {
-            if (r == crnt_row) {
-                continue;
-            }
-            cml_matrix_add_mulitple_rows(m, r + 1, crnt_row + 1,
-                                         -1 * m->values[r][c]);
-        }
+        cml_matrix_eliminate(m, crnt_row, c, 0);
 
         crnt_row++;
     }
@@ -50,6 +50,17 @@ matrix cml_matrix_construct(cml_u32 rows, cml_u32 cols, cml_u32 num_values, ...)
 */
 matrix cml_matrix_copy_mem(matrix* m);
 
+/*
+    Returns a deep copy of the given matrix "m" with its
+    own value storage.
+*/
+matrix cml_matrix_clone(matrix m);
+
+/*
+    Frees the values of the given matrix "m".
+*/
+void cml_matrix_free_mem(matrix* m);
+
 /*
     Prints all values of a given matrix "m" to the
     console in a specific layout.
@@ -200,6 +211,14 @@ vector cml_matrix_vec_mult(matrix m, vector v);
 */
 matrix cml_matrix_transpose(matrix* m);
 
+/*
+    NOTE: The given matrix "m" has to be square.
+
+    Transposes the given matrix "m" without allocating
+    any memory.
+*/
+void cml_matrix_transpose_in_place(matrix* m);
+
 /*
     Swaps the two given rows "row_1" and "row_2" in the given
     matrix "m".
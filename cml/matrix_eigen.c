@@ -0,0 +1,518 @@
+#include "matrix_eigen.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "internal/cml_eigen3.h"
+#include "parallel.h"
+
+#define CML_EIGEN_PI 3.14159265358979323846
+
+/*
+    The 3x3 solver follows D. Eberly, "A Robust Eigensolver
+    for 3 x 3 Symmetric Matrices". It works in double
+    precision on the matrix scaled to max |a| = 1.
+*/
+
+static double cml_eig3_dot(const double* a, const double* b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void cml_eig3_cross(const double* a, const double* b, double* out) {
+    double x = a[1] * b[2] - a[2] * b[1];
+    double y = a[2] * b[0] - a[0] * b[2];
+    double z = a[0] * b[1] - a[1] * b[0];
+
+    out[0] = x;
+    out[1] = y;
+    out[2] = z;
+}
+
+// a * v for the symmetric a = {a00, a01, a02, a11, a12, a22}
+static void cml_eig3_mult(const double* a, const double* v, double* out) {
+    out[0] = a[0] * v[0] + a[1] * v[1] + a[2] * v[2];
+    out[1] = a[1] * v[0] + a[3] * v[1] + a[4] * v[2];
+    out[2] = a[2] * v[0] + a[4] * v[1] + a[5] * v[2];
+}
+
+/*
+    Returns unit vectors u, v so that w, u, v are orthonormal.
+*/
+static void cml_eig3_complement(const double* w, double* u, double* v) {
+    if (fabs(w[0]) > fabs(w[1])) {
+        double inv = 1.0 / sqrt(w[0] * w[0] + w[2] * w[2]);
+        u[0] = -w[2] * inv;
+        u[1] = 0.0;
+        u[2] = w[0] * inv;
+    } else {
+        double inv = 1.0 / sqrt(w[1] * w[1] + w[2] * w[2]);
+        u[0] = 0.0;
+        u[1] = w[2] * inv;
+        u[2] = -w[1] * inv;
+    }
+    cml_eig3_cross(w, u, v);
+}
+
+/*
+    Eigenvector of a simple eigenvalue: the rows of a - value * I
+    span a plane, their largest cross product is its normal.
+*/
+static void cml_eig3_vector0(const double* a, double value, double* out) {
+    double r0[3] = {a[0] - value, a[1], a[2]};
+    double r1[3] = {a[1], a[3] - value, a[4]};
+    double r2[3] = {a[2], a[4], a[5] - value};
+    double c[3][3];
+
+    cml_eig3_cross(r0, r1, c[0]);
+    cml_eig3_cross(r0, r2, c[1]);
+    cml_eig3_cross(r1, r2, c[2]);
+
+    double d0 = cml_eig3_dot(c[0], c[0]);
+    double d1 = cml_eig3_dot(c[1], c[1]);
+    double d2 = cml_eig3_dot(c[2], c[2]);
+
+    cml_u32 best = d0 >= d1 ? (d0 >= d2 ? 0 : 2) : (d1 >= d2 ? 1 : 2);
+    double d = best == 0 ? d0 : (best == 1 ? d1 : d2);
+    double inv = 1.0 / sqrt(d);
+
+    out[0] = c[best][0] * inv;
+    out[1] = c[best][1] * inv;
+    out[2] = c[best][2] * inv;
+}
+
+/*
+    Eigenvector of "value" in the plane orthogonal to the
+    known eigenvector "evec0", from the 2x2 restriction of
+    a - value * I to that plane.
+*/
+static void cml_eig3_vector1(const double* a, const double* evec0,
+                             double value, double* out) {
+    double u[3], v[3], au[3], av[3];
+    cml_eig3_complement(evec0, u, v);
+    cml_eig3_mult(a, u, au);
+    cml_eig3_mult(a, v, av);
+
+    double m00 = cml_eig3_dot(u, au) - value;
+    double m01 = cml_eig3_dot(u, av);
+    double m11 = cml_eig3_dot(v, av) - value;
+
+    double abs00 = fabs(m00), abs01 = fabs(m01), abs11 = fabs(m11);
+    double s = 1.0, t = 0.0;
+
+    if (abs00 >= abs11) {
+        double max = abs00 > abs01 ? abs00 : abs01;
+        if (max > 0.0) {
+            if (abs00 >= abs01) {
+                m01 /= m00;
+                m00 = 1.0 / sqrt(1.0 + m01 * m01);
+                m01 *= m00;
+            } else {
+                m00 /= m01;
+                m01 = 1.0 / sqrt(1.0 + m00 * m00);
+                m00 *= m01;
+            }
+            s = m01;
+            t = -m00;
+        }
+    } else {
+        double max = abs11 > abs01 ? abs11 : abs01;
+        if (max > 0.0) {
+            if (abs11 >= abs01) {
+                m01 /= m11;
+                m11 = 1.0 / sqrt(1.0 + m01 * m01);
+                m01 *= m11;
+            } else {
+                m11 /= m01;
+                m01 = 1.0 / sqrt(1.0 + m11 * m11);
+                m11 *= m01;
+            }
+            s = m11;
+            t = -m01;
+        }
+    }
+
+    for (cml_u32 i = 0; i < 3; i++) {
+        out[i] = s * u[i] + t * v[i];
+    }
+}
+
+void cml_eigen3_symmetric_double(const double* a, double eval[3],
+                                 double evec[3][3]) {
+    double max = 0.0;
+    for (cml_u32 i = 0; i < 6; i++) {
+        max = fmax(max, fabs(a[i]));
+    }
+
+    for (cml_u32 i = 0; i < 3; i++) {
+        eval[i] = 0.0;
+        for (cml_u32 k = 0; k < 3; k++) {
+            evec[i][k] = i == k ? 1.0 : 0.0;
+        }
+    }
+
+    if (max > 0.0) {
+        double b[6];
+        for (cml_u32 i = 0; i < 6; i++) {
+            b[i] = a[i] / max;
+        }
+
+        double q = (b[0] + b[3] + b[5]) / 3.0;
+        double off = b[1] * b[1] + b[2] * b[2] + b[4] * b[4];
+        double d0 = b[0] - q, d1 = b[3] - q, d2 = b[5] - q;
+        double p = sqrt((d0 * d0 + d1 * d1 + d2 * d2 + 2.0 * off) / 6.0);
+
+        if (off == 0.0 || p == 0.0) {
+            // already diagonal, sort the diagonal with its axes
+            eval[0] = b[0];
+            eval[1] = b[3];
+            eval[2] = b[5];
+            for (cml_u32 i = 0; i < 2; i++) {
+                for (cml_u32 j = 0; j < 2 - i; j++) {
+                    if (eval[j] > eval[j + 1]) {
+                        double tmp = eval[j];
+                        eval[j] = eval[j + 1];
+                        eval[j + 1] = tmp;
+                        for (cml_u32 k = 0; k < 3; k++) {
+                            tmp = evec[j][k];
+                            evec[j][k] = evec[j + 1][k];
+                            evec[j + 1][k] = tmp;
+                        }
+                    }
+                }
+            }
+            // keep the basis right handed after the swaps
+            cml_eig3_cross(evec[0], evec[1], evec[2]);
+        } else {
+            // c = (b - q * I) / p, its eigenvalues are 2 * cos(...)
+            double c00 = d0 / p, c11 = d1 / p, c22 = d2 / p;
+            double c01 = b[1] / p, c02 = b[2] / p, c12 = b[4] / p;
+            double half_det = 0.5 * (c00 * (c11 * c22 - c12 * c12) -
+                                     c01 * (c01 * c22 - c12 * c02) +
+                                     c02 * (c01 * c12 - c11 * c02));
+            half_det = fmin(fmax(half_det, -1.0), 1.0);
+
+            double angle = acos(half_det) / 3.0;
+            double beta2 = 2.0 * cos(angle);
+            double beta0 = 2.0 * cos(angle + 2.0 * CML_EIGEN_PI / 3.0);
+            double beta1 = -(beta0 + beta2);
+
+            eval[0] = q + p * beta0;
+            eval[1] = q + p * beta1;
+            eval[2] = q + p * beta2;
+            // beta1 can round past its neighbours for double roots
+            eval[1] = fmin(fmax(eval[1], eval[0]), eval[2]);
+
+            // start with the eigenvalue that is furthest from the others
+            if (half_det >= 0.0) {
+                cml_eig3_vector0(b, eval[2], evec[2]);
+                cml_eig3_vector1(b, evec[2], eval[1], evec[1]);
+                cml_eig3_cross(evec[1], evec[2], evec[0]);
+            } else {
+                cml_eig3_vector0(b, eval[0], evec[0]);
+                cml_eig3_vector1(b, evec[0], eval[1], evec[1]);
+                cml_eig3_cross(evec[0], evec[1], evec[2]);
+            }
+        }
+
+        for (cml_u32 i = 0; i < 3; i++) {
+            eval[i] *= max;
+        }
+    }
+}
+
+void cml_eigen3_symmetric(const float* a, cml_eigen3* out) {
+    double b[6];
+    for (cml_u32 i = 0; i < 6; i++) {
+        b[i] = a[i];
+    }
+
+    double eval[3], evec[3][3];
+    cml_eigen3_symmetric_double(b, eval, evec);
+
+    for (cml_u32 i = 0; i < 3; i++) {
+        out->values[i] = (float)eval[i];
+        for (cml_u32 k = 0; k < 3; k++) {
+            out->vectors[i][k] = (float)evec[i][k];
+        }
+    }
+}
+
+typedef struct {
+    const float* a;
+    cml_eigen3* out;
+} cml_eigen3_job;
+
+static void cml_eigen3_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_eigen3_job* job = arg;
+
+    for (cml_u32 i = begin; i < end; i++) {
+        cml_eigen3_symmetric(job->a + 6 * i, job->out + i);
+    }
+}
+
+void cml_eigen3_symmetric_batch(const float* a, cml_u32 count,
+                                cml_eigen3* out) {
+    cml_eigen3_job job;
+    job.a = a;
+    job.out = out;
+
+    // one decomposition costs a few hundred flops
+    if ((cml_u64)count * 64 < CML_PARALLEL_THRESHOLD) {
+        cml_eigen3_range(0, count, &job);
+        return;
+    }
+    cml_parallel_for(0, count, 256, cml_eigen3_range, &job);
+}
+
+/*
+    Householder reduction of the symmetric matrix in "v" to
+    tridiagonal form (diagonal "d", subdiagonal "e"). "v" is
+    replaced by the accumulated orthogonal transformation.
+*/
+static void cml_eigen_tridiagonalize(double** v, double* d, double* e,
+                                     cml_u32 n) {
+    for (cml_u32 j = 0; j < n; j++) {
+        d[j] = v[n - 1][j];
+    }
+
+    for (cml_u32 i = n - 1; i > 0; i--) {
+        double scale = 0.0;
+        double h = 0.0;
+
+        for (cml_u32 k = 0; k < i; k++) {
+            scale += fabs(d[k]);
+        }
+
+        if (scale == 0.0) {
+            e[i] = d[i - 1];
+            for (cml_u32 j = 0; j < i; j++) {
+                d[j] = v[i - 1][j];
+                v[i][j] = 0.0;
+                v[j][i] = 0.0;
+            }
+        } else {
+            for (cml_u32 k = 0; k < i; k++) {
+                d[k] /= scale;
+                h += d[k] * d[k];
+            }
+
+            double f = d[i - 1];
+            double g = f > 0.0 ? -sqrt(h) : sqrt(h);
+            e[i] = scale * g;
+            h -= f * g;
+            d[i - 1] = f - g;
+
+            for (cml_u32 j = 0; j < i; j++) {
+                e[j] = 0.0;
+            }
+
+            // e = a * u for the current reflector u = d
+            for (cml_u32 j = 0; j < i; j++) {
+                f = d[j];
+                v[j][i] = f;
+                g = e[j] + v[j][j] * f;
+                for (cml_u32 k = j + 1; k < i; k++) {
+                    g += v[k][j] * d[k];
+                    e[k] += v[k][j] * f;
+                }
+                e[j] = g;
+            }
+
+            f = 0.0;
+            for (cml_u32 j = 0; j < i; j++) {
+                e[j] /= h;
+                f += e[j] * d[j];
+            }
+
+            double hh = f / (h + h);
+            for (cml_u32 j = 0; j < i; j++) {
+                e[j] -= hh * d[j];
+            }
+
+            for (cml_u32 j = 0; j < i; j++) {
+                f = d[j];
+                g = e[j];
+                for (cml_u32 k = j; k < i; k++) {
+                    v[k][j] -= f * e[k] + g * d[k];
+                }
+                d[j] = v[i - 1][j];
+                v[i][j] = 0.0;
+            }
+        }
+        d[i] = h;
+    }
+
+    // accumulate the transformations
+    for (cml_u32 i = 0; i + 1 < n; i++) {
+        v[n - 1][i] = v[i][i];
+        v[i][i] = 1.0;
+
+        double h = d[i + 1];
+        if (h != 0.0) {
+            for (cml_u32 k = 0; k <= i; k++) {
+                d[k] = v[k][i + 1] / h;
+            }
+            for (cml_u32 j = 0; j <= i; j++) {
+                double g = 0.0;
+                for (cml_u32 k = 0; k <= i; k++) {
+                    g += v[k][i + 1] * v[k][j];
+                }
+                for (cml_u32 k = 0; k <= i; k++) {
+                    v[k][j] -= g * d[k];
+                }
+            }
+        }
+        for (cml_u32 k = 0; k <= i; k++) {
+            v[k][i + 1] = 0.0;
+        }
+    }
+
+    for (cml_u32 j = 0; j < n; j++) {
+        d[j] = v[n - 1][j];
+        v[n - 1][j] = 0.0;
+    }
+    v[n - 1][n - 1] = 1.0;
+    e[0] = 0.0;
+}
+
+/*
+    Implicit QL iteration on the tridiagonal matrix d / e.
+    The rotations are applied to the columns of "v".
+*/
+static BOOL cml_eigen_tridiagonal_ql(double** v, double* d, double* e,
+                                     cml_u32 n) {
+    for (cml_u32 i = 1; i < n; i++) {
+        e[i - 1] = e[i];
+    }
+    e[n - 1] = 0.0;
+
+    double f = 0.0;
+    double tst1 = 0.0;
+    const double eps = 2.220446049250313e-16;
+
+    for (cml_u32 l = 0; l < n; l++) {
+        tst1 = fmax(tst1, fabs(d[l]) + fabs(e[l]));
+
+        cml_u32 m = l;
+        while (m < n - 1 && fabs(e[m]) > eps * tst1) {
+            m++;
+        }
+
+        if (m > l) {
+            cml_u32 iterations = 0;
+            do {
+                if (++iterations > 64) {
+                    return FALSE;
+                }
+
+                // Wilkinson shift from the leading 2x2 block
+                double g = d[l];
+                double p = (d[l + 1] - g) / (2.0 * e[l]);
+                double r = hypot(p, 1.0);
+                if (p < 0.0) {
+                    r = -r;
+                }
+                d[l] = e[l] / (p + r);
+                d[l + 1] = e[l] * (p + r);
+                double dl1 = d[l + 1];
+                double h = g - d[l];
+                for (cml_u32 i = l + 2; i < n; i++) {
+                    d[i] -= h;
+                }
+                f += h;
+
+                p = d[m];
+                double c = 1.0, c2 = 1.0, c3 = 1.0;
+                double el1 = e[l + 1];
+                double s = 0.0, s2 = 0.0;
+
+                for (cml_u32 i = m; i-- > l;) {
+                    c3 = c2;
+                    c2 = c;
+                    s2 = s;
+                    g = c * e[i];
+                    h = c * p;
+                    r = hypot(p, e[i]);
+                    e[i + 1] = s * r;
+                    s = e[i] / r;
+                    c = p / r;
+                    p = c * d[i] - s * g;
+                    d[i + 1] = h + s * (c * g + s * d[i]);
+
+                    for (cml_u32 k = 0; k < n; k++) {
+                        h = v[k][i + 1];
+                        v[k][i + 1] = s * v[k][i] + c * h;
+                        v[k][i] = c * v[k][i] - s * h;
+                    }
+                }
+                p = -s * s2 * c3 * el1 * e[l] / dl1;
+                e[l] = s * p;
+                d[l] = c * p;
+            } while (fabs(e[l]) > eps * tst1);
+        }
+        d[l] += f;
+        e[l] = 0.0;
+    }
+    return TRUE;
+}
+
+BOOL cml_eigen_symmetric(matrix a, vector* values, matrix* vectors) {
+    assert(a.rows == a.cols && a.rows > 0);
+
+    cml_u32 n = a.rows;
+    double* storage = malloc(((size_t)n * n + 2 * n) * sizeof(double));
+    double** v = malloc(n * sizeof(double*));
+    double* d = storage + (size_t)n * n;
+    double* e = d + n;
+
+    for (cml_u32 r = 0; r < n; r++) {
+        v[r] = storage + (size_t)r * n;
+        for (cml_u32 c = 0; c < n; c++) {
+            v[r][c] = a.values[r][c];
+        }
+    }
+
+    cml_eigen_tridiagonalize(v, d, e, n);
+    BOOL ret = cml_eigen_tridiagonal_ql(v, d, e, n);
+
+    if (ret) {
+        // selection sort keeps the column swaps at n
+        for (cml_u32 i = 0; i + 1 < n; i++) {
+            cml_u32 k = i;
+            for (cml_u32 j = i + 1; j < n; j++) {
+                if (d[j] < d[k]) {
+                    k = j;
+                }
+            }
+            if (k != i) {
+                double tmp = d[i];
+                d[i] = d[k];
+                d[k] = tmp;
+                for (cml_u32 r = 0; r < n; r++) {
+                    tmp = v[r][i];
+                    v[r][i] = v[r][k];
+                    v[r][k] = tmp;
+                }
+            }
+        }
+
+        *values = cml_vector_allocate(n);
+        for (cml_u32 i = 0; i < n; i++) {
+            values->values[i] = (float)d[i];
+        }
+
+        if (vectors) {
+            *vectors = cml_matrix_allocate(n, n);
+            for (cml_u32 r = 0; r < n; r++) {
+                for (cml_u32 c = 0; c < n; c++) {
+                    vectors->values[r][c] = (float)v[r][c];
+                }
+            }
+        }
+    }
+
+    free(v);
+    free(storage);
+    return ret;
+}
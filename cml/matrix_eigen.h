@@ -0,0 +1,59 @@
+#ifndef CML_MATRIX_EIGEN_INCLUDED
+#define CML_MATRIX_EIGEN_INCLUDED
+
+#include "internal/cml_core.h"
+#include "matrix.h"
+#include "vector.h"
+
+/*
+    Eigen decomposition of a symmetric 3x3 matrix. values
+    are in ascending order and vectors[i] is the unit length
+    eigenvector of values[i]. The vectors form a right handed
+    orthonormal basis.
+*/
+typedef struct {
+    float values[3];
+    float vectors[3][3];
+} cml_eigen3;
+
+/*
+    Computes the eigen decomposition of the symmetric 3x3
+    matrix given by its upper triangle
+    a = {a00, a01, a02, a11, a12, a22} (the layout of a
+    covariance matrix xx xy xz yy yz zz).
+
+    The eigenvalues are computed in closed form (trigonometric
+    solution of the characteristic polynomial), the vectors
+    from cross products of the rows of a - value * I and the
+    orthogonal complement of the first vector, which keeps
+    them orthonormal for repeated eigenvalues. The function
+    does not allocate and has no iterations.
+*/
+void cml_eigen3_symmetric(const float* a, cml_eigen3* out);
+
+/*
+    Decomposes "count" matrices stored as 6 floats each
+    (see cml_eigen3_symmetric()). Large batches run on the
+    thread pool.
+*/
+void cml_eigen3_symmetric_batch(const float* a, cml_u32 count,
+                                cml_eigen3* out);
+
+/*
+    NOTE: "a" has to be square and symmetric.
+
+    Computes the eigenvalues and eigenvectors of the given
+    symmetric matrix "a". "values" receives the eigenvalues
+    in ascending order and column i of "vectors" the unit
+    eigenvector of values.values[i]; both are allocated by
+    this function (pass NULL for "vectors" to skip them).
+
+    The matrix is reduced to tridiagonal form by Householder
+    reflections, which is then diagonalized by the implicit
+    QL algorithm, both in double precision. Returns FALSE
+    (and allocates nothing) if the QL iteration does not
+    converge.
+*/
+BOOL cml_eigen_symmetric(matrix a, vector* values, matrix* vectors);
+
+#endif  // CML_MATRIX_EIGEN_INCLUDED
@@ -0,0 +1,375 @@
+#include "matrix_factor.h"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+#include "reduce.h"
+
+/*
+    Number of columns of the right-hand sides / trailing
+    matrix one task of the thread pool works on.
+*/
+#define CML_FACTOR_COLUMN_GRAIN 256
+
+static float cml_factor_dot(const float* a, const float* b, cml_u32 count) {
+    return cml_reduce_dot(a, b, count, CML_REDUCE_PAIRWISE);
+}
+
+// y += a * x
+static void cml_factor_axpy(float* y, const float* x, float a, cml_u32 count) {
+    for (cml_u32 i = 0; i < count; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+static void cml_factor_scale(float* y, float a, cml_u32 count) {
+    for (cml_u32 i = 0; i < count; i++) {
+        y[i] *= a;
+    }
+}
+
+typedef struct {
+    matrix t;
+    matrix* b;
+    cml_triangle triangle;
+    BOOL transpose;
+} cml_triangular_job;
+
+static void cml_triangular_solve_range(cml_u32 begin, cml_u32 end,
+                                       void* arg) {
+    cml_triangular_job* job = arg;
+    float** t = job->t.values;
+    float** b = job->b->values;
+    cml_u32 n = job->t.rows;
+    cml_u32 k = end - begin;
+
+    // row updates are forward for L and transpose(U), backward otherwise
+    BOOL forward = (job->triangle == CML_LOWER) != job->transpose;
+
+    for (cml_u32 step = 0; step < n; step++) {
+        cml_u32 i = forward ? step : n - 1 - step;
+
+        if (!job->transpose) {
+            // x_i = (b_i - sum t[i][j] * x_j) / t[i][i] over solved j
+            cml_u32 j0 = job->triangle == CML_LOWER ? 0 : i + 1;
+            cml_u32 j1 = job->triangle == CML_LOWER ? i : n;
+
+            for (cml_u32 j = j0; j < j1; j++) {
+                cml_factor_axpy(b[i] + begin, b[j] + begin, -t[i][j], k);
+            }
+            cml_factor_scale(b[i] + begin, 1.0f / t[i][i], k);
+        } else {
+            // x_i is final, remove it from the rows that follow
+            cml_factor_scale(b[i] + begin, 1.0f / t[i][i], k);
+
+            cml_u32 j0 = job->triangle == CML_LOWER ? 0 : i + 1;
+            cml_u32 j1 = job->triangle == CML_LOWER ? i : n;
+
+            for (cml_u32 j = j0; j < j1; j++) {
+                cml_factor_axpy(b[j] + begin, b[i] + begin, -t[i][j], k);
+            }
+        }
+    }
+}
+
+void cml_triangular_solve(matrix t, matrix* b, cml_triangle triangle,
+                          BOOL transpose) {
+    assert(t.rows == t.cols && t.rows == b->rows);
+
+    cml_triangular_job job;
+    job.t = t;
+    job.b = b;
+    job.triangle = triangle;
+    job.transpose = transpose;
+
+    if ((cml_u64)t.rows * t.rows * b->cols < CML_PARALLEL_THRESHOLD * 16ull) {
+        cml_triangular_solve_range(0, b->cols, &job);
+        return;
+    }
+    cml_parallel_for(0, b->cols, CML_FACTOR_COLUMN_GRAIN,
+                     cml_triangular_solve_range, &job);
+}
+
+/*
+    Unblocked Cholesky of the diagonal block [k0, k0 + kb).
+    The columns before k0 are already applied.
+*/
+static BOOL cml_cholesky_diagonal(float** l, cml_u32 k0, cml_u32 kb) {
+    for (cml_u32 j = k0; j < k0 + kb; j++) {
+        float d = l[j][j] - cml_factor_dot(l[j] + k0, l[j] + k0, j - k0);
+        if (!(d > 0.0f)) {
+            return FALSE;
+        }
+        l[j][j] = sqrtf(d);
+
+        for (cml_u32 i = j + 1; i < k0 + kb; i++) {
+            l[i][j] = (l[i][j] - cml_factor_dot(l[i] + k0, l[j] + k0, j - k0)) /
+                      l[j][j];
+        }
+    }
+    return TRUE;
+}
+
+typedef struct {
+    float** l;
+    cml_u32 k0, kb;
+} cml_cholesky_job;
+
+/*
+    Rows below the diagonal block: l21 = a21 * inverse(transpose(l11)).
+*/
+static void cml_cholesky_panel(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_cholesky_job* job = arg;
+    float** l = job->l;
+    cml_u32 k0 = job->k0;
+
+    for (cml_u32 i = begin; i < end; i++) {
+        for (cml_u32 j = k0; j < k0 + job->kb; j++) {
+            l[i][j] = (l[i][j] - cml_factor_dot(l[i] + k0, l[j] + k0, j - k0)) /
+                      l[j][j];
+        }
+    }
+}
+
+/*
+    Trailing lower triangle: a22 -= l21 * transpose(l21).
+*/
+static void cml_cholesky_update(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_cholesky_job* job = arg;
+    float** l = job->l;
+    cml_u32 k0 = job->k0;
+    cml_u32 first = k0 + job->kb;
+
+    for (cml_u32 i = begin; i < end; i++) {
+        for (cml_u32 j = first; j <= i; j++) {
+            l[i][j] -= cml_factor_dot(l[i] + k0, l[j] + k0, job->kb);
+        }
+    }
+}
+
+BOOL cml_cholesky(matrix a, matrix* l) {
+    assert(a.rows == a.cols);
+
+    cml_u32 n = a.rows;
+    matrix ret = cml_matrix_allocate(n, n);
+
+    for (cml_u32 r = 0; r < n; r++) {
+        memcpy(ret.values[r], a.values[r], (r + 1) * sizeof(float));
+        memset(ret.values[r] + r + 1, 0, (n - r - 1) * sizeof(float));
+    }
+
+    BOOL parallel = (cml_u64)n * n >= CML_PARALLEL_THRESHOLD;
+
+    for (cml_u32 k0 = 0; k0 < n; k0 += CML_CHOLESKY_BLOCK) {
+        cml_u32 kb = n - k0 < CML_CHOLESKY_BLOCK ? n - k0 : CML_CHOLESKY_BLOCK;
+
+        if (!cml_cholesky_diagonal(ret.values, k0, kb)) {
+            cml_matrix_free_mem(&ret);
+            return FALSE;
+        }
+
+        cml_cholesky_job job;
+        job.l = ret.values;
+        job.k0 = k0;
+        job.kb = kb;
+
+        // the update reads the panel of other rows, so it waits for it
+        if (parallel) {
+            cml_parallel_for(k0 + kb, n, 16, cml_cholesky_panel, &job);
+            cml_parallel_for(k0 + kb, n, 16, cml_cholesky_update, &job);
+        } else {
+            cml_cholesky_panel(k0 + kb, n, &job);
+            cml_cholesky_update(k0 + kb, n, &job);
+        }
+    }
+
+    *l = ret;
+    return TRUE;
+}
+
+void cml_cholesky_solve(matrix l, matrix* b) {
+    cml_triangular_solve(l, b, CML_LOWER, FALSE);
+    cml_triangular_solve(l, b, CML_LOWER, TRUE);
+}
+
+typedef struct {
+    const cml_qr* qr;
+    cml_u32 k;
+    float** rows;
+} cml_qr_reflect_job;
+
+/*
+    Applies H(k) to the columns [begin, end) of the rows
+    k..m-1 of "rows".
+*/
+static void cml_qr_reflect_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_qr_reflect_job* job = arg;
+    float** v = job->qr->qr.values;
+    float** rows = job->rows;
+    cml_u32 k = job->k;
+    cml_u32 m = job->qr->qr.rows;
+    float tau = job->qr->tau[k];
+    float w[CML_FACTOR_COLUMN_GRAIN];
+
+    if (tau == 0.0f) {
+        return;
+    }
+
+    for (cml_u32 c0 = begin; c0 < end; c0 += CML_FACTOR_COLUMN_GRAIN) {
+        cml_u32 count = end - c0;
+        if (count > CML_FACTOR_COLUMN_GRAIN) {
+            count = CML_FACTOR_COLUMN_GRAIN;
+        }
+
+        // w = transpose(v) * rows, v[k] = 1
+        memcpy(w, rows[k] + c0, count * sizeof(float));
+        for (cml_u32 i = k + 1; i < m; i++) {
+            cml_factor_axpy(w, rows[i] + c0, v[i][k], count);
+        }
+
+        cml_factor_axpy(rows[k] + c0, w, -tau, count);
+        for (cml_u32 i = k + 1; i < m; i++) {
+            cml_factor_axpy(rows[i] + c0, w, -tau * v[i][k], count);
+        }
+    }
+}
+
+static void cml_qr_reflect(const cml_qr* qr, cml_u32 k, float** rows,
+                           cml_u32 begin, cml_u32 end) {
+    cml_qr_reflect_job job;
+    job.qr = qr;
+    job.k = k;
+    job.rows = rows;
+
+    if ((cml_u64)(qr->qr.rows - k) * (end - begin) < CML_PARALLEL_THRESHOLD) {
+        cml_qr_reflect_range(begin, end, &job);
+        return;
+    }
+    cml_parallel_for(begin, end, CML_FACTOR_COLUMN_GRAIN, cml_qr_reflect_range,
+                     &job);
+}
+
+cml_qr cml_qr_decompose(matrix a) {
+    assert(a.rows >= a.cols);
+
+    cml_qr ret;
+    ret.qr = cml_matrix_clone(a);
+    ret.tau = malloc(a.cols * sizeof(float));
+
+    float** q = ret.qr.values;
+    cml_u32 m = a.rows;
+    cml_u32 n = a.cols;
+
+    for (cml_u32 k = 0; k < n; k++) {
+        double norm = 0.0;
+        for (cml_u32 i = k; i < m; i++) {
+            norm += (double)q[i][k] * q[i][k];
+        }
+        norm = sqrt(norm);
+
+        if (norm == 0.0) {
+            ret.tau[k] = 0.0f;
+            continue;
+        }
+
+        // reflect onto -sign(alpha) * |x| to avoid cancellation
+        double alpha = q[k][k];
+        double beta = alpha >= 0.0 ? -norm : norm;
+        float scale = (float)(1.0 / (alpha - beta));
+
+        for (cml_u32 i = k + 1; i < m; i++) {
+            q[i][k] *= scale;
+        }
+        ret.tau[k] = (float)((beta - alpha) / beta);
+        q[k][k] = (float)beta;
+
+        cml_qr_reflect(&ret, k, q, k + 1, n);
+    }
+    return ret;
+}
+
+void cml_qr_free(cml_qr* qr) {
+    cml_matrix_free_mem(&qr->qr);
+    free(qr->tau);
+    qr->tau = NULL;
+}
+
+matrix cml_qr_q(const cml_qr* qr) {
+    cml_u32 n = qr->qr.cols;
+    matrix ret = cml_matrix_empty(qr->qr.rows, n);
+
+    for (cml_u32 i = 0; i < n; i++) {
+        ret.values[i][i] = 1.0f;
+    }
+
+    // Q * I = H(0) * (H(1) * (... * I))
+    for (cml_u32 k = n; k-- > 0;) {
+        cml_qr_reflect(qr, k, ret.values, 0, n);
+    }
+    return ret;
+}
+
+matrix cml_qr_r(const cml_qr* qr) {
+    cml_u32 n = qr->qr.cols;
+    matrix ret = cml_matrix_empty(n, n);
+
+    for (cml_u32 r = 0; r < n; r++) {
+        memcpy(ret.values[r] + r, qr->qr.values[r] + r,
+               (n - r) * sizeof(float));
+    }
+    return ret;
+}
+
+void cml_qr_apply_qt(const cml_qr* qr, matrix* b) {
+    assert(b->rows == qr->qr.rows);
+
+    for (cml_u32 k = 0; k < qr->qr.cols; k++) {
+        cml_qr_reflect(qr, k, b->values, 0, b->cols);
+    }
+}
+
+BOOL cml_qr_solve(const cml_qr* qr, matrix b, matrix* x) {
+    assert(b.rows == qr->qr.rows);
+
+    cml_u32 n = qr->qr.cols;
+
+    float max_diag = 0.0f;
+    for (cml_u32 i = 0; i < n; i++) {
+        max_diag = fmaxf(max_diag, fabsf(qr->qr.values[i][i]));
+    }
+    for (cml_u32 i = 0; i < n; i++) {
+        if (fabsf(qr->qr.values[i][i]) <= n * FLT_EPSILON * max_diag ||
+            max_diag == 0.0f) {
+            return FALSE;
+        }
+    }
+
+    matrix y = cml_matrix_clone(b);
+    cml_qr_apply_qt(qr, &y);
+
+    // R is the upper triangle of the first n rows, the rest of
+    // transpose(Q) * b is the residual
+    matrix r;
+    r.rows = n;
+    r.cols = n;
+    r.values = qr->qr.values;
+
+    matrix top;
+    top.rows = n;
+    top.cols = y.cols;
+    top.values = y.values;
+
+    cml_triangular_solve(r, &top, CML_UPPER, FALSE);
+
+    *x = cml_matrix_allocate(n, b.cols);
+    for (cml_u32 i = 0; i < n; i++) {
+        memcpy(x->values[i], y.values[i], b.cols * sizeof(float));
+    }
+
+    cml_matrix_free_mem(&y);
+    return TRUE;
+}
@@ -0,0 +1,105 @@
+#ifndef CML_MATRIX_FACTOR_INCLUDED
+#define CML_MATRIX_FACTOR_INCLUDED
+
+#include "internal/cml_core.h"
+#include "matrix.h"
+
+/*
+    Matrix factorizations and triangular solves. Unlike the
+    transforms of matrix_transform.h these functions use
+    values[r][c] as row r, column c.
+*/
+
+/*
+    Selects the triangle of a triangular matrix. The other
+    triangle is never read.
+*/
+typedef enum {
+    CML_LOWER = 0,
+    CML_UPPER
+} cml_triangle;
+
+/*
+    NOTE: "t" has to be square with t.rows == b->rows.
+
+    Solves t * X = B (or transpose(t) * X = B if "transpose"
+    is TRUE) for the triangular matrix "t" and overwrites
+    "b" with X. Every column of "b" is a right-hand side, so
+    one call reuses the factor for all of them.
+*/
+void cml_triangular_solve(matrix t, matrix* b, cml_triangle triangle,
+                          BOOL transpose);
+
+/*
+    Block size of the blocked Cholesky factorization.
+*/
+#define CML_CHOLESKY_BLOCK 64
+
+/*
+    NOTE: "a" has to be square and symmetric, only its
+          lower triangle is read.
+
+    Computes the Cholesky factorization a = l * transpose(l)
+    with a lower triangular "l", which is allocated by this
+    function. Returns FALSE (and allocates nothing) if "a" is
+    not positive definite.
+
+    The factorization works on blocks of CML_CHOLESKY_BLOCK
+    columns, the updates of the rows below a block run on
+    the thread pool for large matrices. It takes n^3 / 3
+    flops, half of an LU factorization.
+*/
+BOOL cml_cholesky(matrix a, matrix* l);
+
+/*
+    Solves a * X = B with the Cholesky factor "l" of "a" and
+    overwrites "b" with X.
+*/
+void cml_cholesky_solve(matrix l, matrix* b);
+
+/*
+    Compact Householder QR factorization of an m x n matrix
+    with m >= n. The upper triangle of "qr" holds R, the
+    columns below the diagonal hold the Householder vectors
+    (with an implied leading 1) and "tau" their scales, so
+    that Q = H(0) * H(1) * ... * H(n - 1) with
+    H(k) = I - tau[k] * v(k) * transpose(v(k)).
+*/
+typedef struct {
+    matrix qr;
+    float* tau;
+} cml_qr;
+
+/*
+    NOTE: a.rows has to be at least a.cols.
+
+    Computes the QR factorization of the given matrix "a".
+    The reflections of large matrices are applied to the
+    remaining columns on the thread pool.
+*/
+cml_qr cml_qr_decompose(matrix a);
+
+void cml_qr_free(cml_qr* qr);
+
+/*
+    Returns the first n columns of Q (m x n) / R (n x n).
+*/
+matrix cml_qr_q(const cml_qr* qr);
+
+matrix cml_qr_r(const cml_qr* qr);
+
+/*
+    Overwrites the m x k matrix "b" with transpose(Q) * b.
+*/
+void cml_qr_apply_qt(const cml_qr* qr, matrix* b);
+
+/*
+    Solves the least squares problem min |a * X - B| for
+    every column of the m x k matrix "b" and writes the
+    n x k solution to "x", which is allocated by this
+    function. Returns FALSE if "a" does not have full
+    column rank.
+*/
+BOOL cml_qr_solve(const cml_qr* qr, matrix b, matrix* x);
+
+#endif  // CML_MATRIX_FACTOR_INCLUDED
@@ -0,0 +1,277 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "matrix_io.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "internal/cml_file.h"
+
+typedef char cml_matrix_file_header_size_check
+    [sizeof(cml_matrix_file_header) == 64 ? 1 : -1];
+
+static BOOL cml_matrix_header_valid(cml_matrix_file_header* header) {
+    if (memcmp(header->magic, CML_MATRIX_FILE_MAGIC, 4) != 0 ||
+        header->version != CML_MATRIX_FILE_VERSION ||
+        header->byte_order != CML_MATRIX_FILE_BYTE_ORDER) {
+        return FALSE;
+    }
+    if (header->dtype != CML_DTYPE_F32 ||
+        header->layout != CML_LAYOUT_ROW_MAJOR) {
+        return FALSE;
+    }
+    if (header->alignment == 0 || header->alignment % sizeof(float) != 0 ||
+        header->row_stride < header->cols ||
+        header->data_offset < sizeof(cml_matrix_file_header) ||
+        header->data_offset % header->alignment != 0 ||
+        header->data_offset % sizeof(float) != 0) {
+        return FALSE;
+    }
+
+    // the end of the data, cml_matrix_file_size(), has to fit in 64 bits
+    cml_u64 max_elements = (~(cml_u64)0 - header->data_offset) / sizeof(float);
+    if (header->cols > max_elements ||
+        (header->rows > 0 &&
+         header->row_stride > (max_elements - header->cols) / header->rows)) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static cml_u64 cml_matrix_file_size(cml_matrix_file_header* header) {
+    if (header->rows == 0) {
+        return header->data_offset;
+    }
+    return header->data_offset +
+           ((cml_u64)(header->rows - 1) * header->row_stride + header->cols) *
+               sizeof(float);
+}
+
+BOOL cml_matrix_save(const char* path, matrix* m) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return FALSE;
+    }
+
+    cml_matrix_file_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CML_MATRIX_FILE_MAGIC, 4);
+    header.version = CML_MATRIX_FILE_VERSION;
+    header.byte_order = CML_MATRIX_FILE_BYTE_ORDER;
+    header.dtype = CML_DTYPE_F32;
+    header.layout = CML_LAYOUT_ROW_MAJOR;
+    header.alignment = CML_MATRIX_FILE_ALIGNMENT;
+    header.rows = m->rows;
+    header.cols = m->cols;
+    header.row_stride = m->cols;
+    header.data_offset = CML_MATRIX_FILE_ALIGNMENT;
+
+    static const cml_u8 padding[CML_MATRIX_FILE_ALIGNMENT] = {0};
+
+    BOOL ret = fwrite(&header, sizeof(header), 1, file) == 1;
+    ret = ret && fwrite(padding, 1, header.data_offset - sizeof(header),
+                        file) == header.data_offset - sizeof(header);
+
+    for (cml_u32 r = 0; ret && r < m->rows; r++) {
+        ret = fwrite(m->values[r], sizeof(float), m->cols, file) == m->cols;
+    }
+
+    if (fclose(file) != 0) {
+        ret = FALSE;
+    }
+    return ret;
+}
+
+BOOL cml_matrix_read_header(const char* path,
+                            cml_matrix_file_header* header) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return FALSE;
+    }
+
+    BOOL ret = fread(header, sizeof(*header), 1, file) == 1 &&
+               cml_matrix_header_valid(header);
+
+    fclose(file);
+    return ret;
+}
+
+#ifdef _WIN32
+
+static void* cml_matrix_map_region(const char* path, cml_u64* size,
+                                   void** handle) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) {
+        return NULL;
+    }
+
+    void* ret = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!ret) {
+        CloseHandle(mapping);
+        return NULL;
+    }
+
+    *size = (cml_u64)file_size.QuadPart;
+    *handle = mapping;
+    return ret;
+}
+
+static void cml_matrix_unmap_region(void* region, cml_u64 size,
+                                    void* handle) {
+    (void)size;
+    UnmapViewOfFile(region);
+    CloseHandle((HANDLE)handle);
+}
+
+#else
+
+static void* cml_matrix_map_region(const char* path, cml_u64* size,
+                                   void** handle) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void* ret = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if (ret == MAP_FAILED) {
+        return NULL;
+    }
+
+    *size = (cml_u64)st.st_size;
+    *handle = NULL;
+    return ret;
+}
+
+static void cml_matrix_unmap_region(void* region, cml_u64 size,
+                                    void* handle) {
+    (void)handle;
+    munmap(region, (size_t)size);
+}
+
+#endif
+
+BOOL cml_matrix_map_file(const char* path, cml_matrix_map* map) {
+    memset(map, 0, sizeof(*map));
+
+    map->mapping =
+        cml_matrix_map_region(path, &map->mapping_size, &map->handle);
+    if (!map->mapping) {
+        return FALSE;
+    }
+
+    if (map->mapping_size < sizeof(cml_matrix_file_header)) {
+        cml_matrix_unmap(map);
+        return FALSE;
+    }
+
+    memcpy(&map->header, map->mapping, sizeof(cml_matrix_file_header));
+    if (!cml_matrix_header_valid(&map->header) ||
+        map->mapping_size < cml_matrix_file_size(&map->header)) {
+        cml_matrix_unmap(map);
+        return FALSE;
+    }
+
+    float* data = (float*)((cml_u8*)map->mapping + map->header.data_offset);
+
+    map->m.rows = map->header.rows;
+    map->m.cols = map->header.cols;
+    map->m.values = malloc(map->m.rows * sizeof(float*));
+
+    for (cml_u32 r = 0; r < map->m.rows; r++) {
+        map->m.values[r] = data + r * map->header.row_stride;
+    }
+    return TRUE;
+}
+
+void cml_matrix_unmap(cml_matrix_map* map) {
+    if (map->mapping) {
+        cml_matrix_unmap_region(map->mapping, map->mapping_size, map->handle);
+    }
+    free(map->m.values);
+
+    memset(map, 0, sizeof(*map));
+}
+
+matrix cml_matrix_load(const char* path) {
+    matrix ret;
+    ret.rows = 0;
+    ret.cols = 0;
+    ret.values = NULL;
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return ret;
+    }
+
+    // the values and the row pointers (counted as at most
+    // sizeof(float*) floats per row) have to fit in size_t
+    cml_matrix_file_header header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        !cml_matrix_header_valid(&header) ||
+        (cml_u64)header.rows * (header.cols + sizeof(float*)) >
+            SIZE_MAX / sizeof(float)) {
+        fclose(file);
+        return ret;
+    }
+
+    ret = cml_matrix_allocate(header.rows, header.cols);
+
+    BOOL ok = TRUE;
+    for (cml_u32 r = 0; ok && r < ret.rows; r++) {
+        // rows are contiguous unless the stride pads them
+        if (r == 0 || header.row_stride > header.cols) {
+            cml_u64 offset = header.data_offset +
+                             (cml_u64)r * header.row_stride * sizeof(float);
+            ok = cml_file_seek(file, offset) == 0;
+        }
+        ok = ok &&
+             fread(ret.values[r], sizeof(float), ret.cols, file) == ret.cols;
+    }
+    fclose(file);
+
+    if (!ok) {
+        for (cml_u32 r = 0; r < ret.rows; r++) {
+            free(ret.values[r]);
+        }
+        free(ret.values);
+
+        ret.rows = 0;
+        ret.cols = 0;
+        ret.values = NULL;
+    }
+    return ret;
+}
@@ -0,0 +1,98 @@
+#ifndef CML_MATRIX_IO_INCLUDED
+#define CML_MATRIX_IO_INCLUDED
+
+#include "internal/cml_core.h"
+#include "matrix.h"
+
+/*
+    Binary matrix file format (version 1).
+
+    A file starts with a 64 byte header followed by the
+    matrix values. The values begin at "data_offset", which
+    is a multiple of "alignment" (itself a multiple of 4
+    bytes), and are stored row by row
+    with "row_stride" elements between the starts of two
+    consecutive rows. All fields are stored in the byte order
+    of the machine that wrote the file, "byte_order" is used
+    to detect a mismatch.
+*/
+#define CML_MATRIX_FILE_MAGIC "CMLM"
+#define CML_MATRIX_FILE_VERSION 1
+#define CML_MATRIX_FILE_BYTE_ORDER 0x01020304u
+#define CML_MATRIX_FILE_ALIGNMENT 64
+
+typedef enum {
+    CML_DTYPE_F32 = 1
+} cml_dtype;
+
+typedef enum {
+    CML_LAYOUT_ROW_MAJOR = 1
+} cml_layout;
+
+typedef struct {
+    char magic[4];
+    cml_u32 version;
+    cml_u32 byte_order;
+    cml_u32 dtype;
+    cml_u32 layout;
+    cml_u32 alignment;
+    cml_u32 rows, cols;
+    cml_u64 row_stride;
+    cml_u64 data_offset;
+    cml_u8 reserved[16];
+} cml_matrix_file_header;
+
+/*
+    Defines a matrix that is mapped from a file.
+    "m" is a read-only view into the mapped memory,
+    writing to its values is undefined behaviour.
+*/
+typedef struct {
+    matrix m;
+    cml_matrix_file_header header;
+    void* mapping;
+    cml_u64 mapping_size;
+    void* handle;
+} cml_matrix_map;
+
+/*
+    Writes the given matrix "m" to the file at the given
+    path. The values are streamed row by row, no copy of
+    the matrix is made. Returns FALSE if the file could
+    not be written.
+*/
+BOOL cml_matrix_save(const char* path, matrix* m);
+
+/*
+    Reads and validates the header of the file at the
+    given path. Returns FALSE if the file is not a valid
+    matrix file of a supported version.
+*/
+BOOL cml_matrix_read_header(const char* path,
+                            cml_matrix_file_header* header);
+
+/*
+    Maps the matrix file at the given path into memory and
+    exposes it through "map->m" without copying the values.
+    Pages are loaded on demand by the operating system when
+    they are first accessed. Only the row pointers of the
+    matrix are allocated.
+
+    Returns FALSE if the file could not be mapped.
+*/
+BOOL cml_matrix_map_file(const char* path, cml_matrix_map* map);
+
+/*
+    Unmaps a matrix that was mapped with cml_matrix_map_file().
+    The view "map->m" is invalid afterwards.
+*/
+void cml_matrix_unmap(cml_matrix_map* map);
+
+/*
+    Loads the matrix file at the given path into a newly
+    allocated matrix. Returns a matrix with zero rows and
+    columns if the file could not be read.
+*/
+matrix cml_matrix_load(const char* path);
+
+#endif  // CML_MATRIX_IO_INCLUDED
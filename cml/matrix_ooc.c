@@ -0,0 +1,237 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "matrix_ooc.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal/cml_file.h"
+#include "internal/cml_thread.h"
+#include "matrix_io.h"
+
+typedef struct {
+    FILE* file1;
+    FILE* file2;
+    cml_ooc_file* m1;
+    cml_ooc_file* m2;
+
+    // destination buffers of the tile pair
+    float* a;
+    float* b;
+
+    // tile origin and extent: a = m1[row.., k..], b = m2[k.., col..]
+    cml_u32 row, col, k;
+    cml_u32 tile_rows, tile_cols, tile_k;
+
+    BOOL ok;
+} cml_ooc_load_job;
+
+static BOOL cml_ooc_read_tile(FILE* file, cml_ooc_file* desc, float* dst,
+                              cml_u32 row, cml_u32 col, cml_u32 rows,
+                              cml_u32 cols) {
+    cml_u64 start =
+        desc->offset + ((cml_u64)row * desc->cols + col) * sizeof(float);
+
+    // full width tiles are one contiguous block in the file
+    if (cols == desc->cols) {
+        return cml_file_seek(file, start) == 0 &&
+               fread(dst, sizeof(float), (size_t)rows * cols, file) ==
+                   (size_t)rows * cols;
+    }
+
+    for (cml_u32 r = 0; r < rows; r++) {
+        cml_u64 offset = start + (cml_u64)r * desc->cols * sizeof(float);
+
+        if (cml_file_seek(file, offset) != 0 ||
+            fread(dst + (size_t)r * cols, sizeof(float), cols, file) != cols) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static BOOL cml_ooc_write_tile(FILE* file, cml_ooc_file* desc,
+                               const float* src, cml_u32 row, cml_u32 col,
+                               cml_u32 rows, cml_u32 cols) {
+    for (cml_u32 r = 0; r < rows; r++) {
+        cml_u64 element = (cml_u64)(row + r) * desc->cols + col;
+        cml_u64 offset = desc->offset + element * sizeof(float);
+
+        if (cml_file_seek(file, offset) != 0 ||
+            fwrite(src + (size_t)r * cols, sizeof(float), cols, file) != cols) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static void cml_ooc_load(void* arg) {
+    cml_ooc_load_job* job = arg;
+
+    job->ok = cml_ooc_read_tile(job->file1, job->m1, job->a, job->row, job->k,
+                                job->tile_rows, job->tile_k) &&
+              cml_ooc_read_tile(job->file2, job->m2, job->b, job->k, job->col,
+                                job->tile_k, job->tile_cols);
+}
+
+static void cml_ooc_multiply_tile(float* c, const float* a, const float* b,
+                                  cml_u32 rows, cml_u32 cols, cml_u32 depth) {
+    for (cml_u32 i = 0; i < rows; i++) {
+        float* c_row = c + (size_t)i * cols;
+
+        for (cml_u32 p = 0; p < depth; p++) {
+            const float a_ip = a[(size_t)i * depth + p];
+            const float* b_row = b + (size_t)p * cols;
+
+            for (cml_u32 j = 0; j < cols; j++) {
+                c_row[j] += a_ip * b_row[j];
+            }
+        }
+    }
+}
+
+static cml_u32 cml_ooc_min(cml_u64 a, cml_u64 b) {
+    return (cml_u32)(a < b ? a : b);
+}
+
+BOOL cml_ooc_file_from_matrix_file(const char* path, cml_ooc_file* file) {
+    cml_matrix_file_header header;
+    if (!cml_matrix_read_header(path, &header) ||
+        header.row_stride != header.cols) {
+        return FALSE;
+    }
+
+    file->path = path;
+    file->offset = header.data_offset;
+    file->rows = header.rows;
+    file->cols = header.cols;
+    return TRUE;
+}
+
+BOOL cml_ooc_mat_mat_mult(cml_ooc_file m1, cml_ooc_file m2, cml_ooc_file out,
+                          cml_u64 memory_budget) {
+    assert(m1.cols == m2.rows);
+    assert(out.rows == m1.rows && out.cols == m2.cols);
+    assert(m1.cols > 0);
+
+    // one result tile plus two (double buffered) operand tile pairs
+    cml_u64 budget = memory_budget / sizeof(float);
+    assert(budget >= 5);
+
+    cml_u64 side = (cml_u64)sqrt((double)budget / 5.0);
+    cml_u32 tile_rows = cml_ooc_min(side, m1.rows);
+    cml_u32 tile_cols = cml_ooc_min(side, m2.cols);
+
+    // spend what the clamped tiles left over on a deeper k
+    cml_u64 depth = (budget - (cml_u64)tile_rows * tile_cols) /
+                    (2 * ((cml_u64)tile_rows + tile_cols));
+    cml_u32 tile_k = cml_ooc_min(depth, m1.cols);
+
+    if (tile_rows == 0 || tile_cols == 0) {
+        return TRUE;
+    }
+
+    FILE* file1 = fopen(m1.path, "rb");
+    FILE* file2 = fopen(m2.path, "rb");
+    FILE* file_out = fopen(out.path, "r+b");
+    if (!file_out) {
+        file_out = fopen(out.path, "w+b");
+    }
+
+    float* c = malloc((size_t)tile_rows * tile_cols * sizeof(float));
+    float* a[2];
+    float* b[2];
+    for (cml_u32 i = 0; i < 2; i++) {
+        a[i] = malloc((size_t)tile_rows * tile_k * sizeof(float));
+        b[i] = malloc((size_t)tile_k * tile_cols * sizeof(float));
+    }
+
+    BOOL ret = file1 && file2 && file_out;
+
+    cml_u32 num_i = (m1.rows + tile_rows - 1) / tile_rows;
+    cml_u32 num_j = (m2.cols + tile_cols - 1) / tile_cols;
+    cml_u32 num_k = (m1.cols + tile_k - 1) / tile_k;
+    cml_u64 num_steps = (cml_u64)num_i * num_j * num_k;
+
+    cml_ooc_load_job jobs[2];
+    for (cml_u32 i = 0; i < 2; i++) {
+        jobs[i].file1 = file1;
+        jobs[i].file2 = file2;
+        jobs[i].m1 = &m1;
+        jobs[i].m2 = &m2;
+        jobs[i].a = a[i];
+        jobs[i].b = b[i];
+    }
+
+    for (cml_u64 step = 0; ret && step <= num_steps; step++) {
+        // step s prepares the load of tile pair s and computes pair s - 1
+        cml_ooc_load_job* next = NULL;
+        cml_thread loader;
+        BOOL threaded = FALSE;
+
+        if (step < num_steps) {
+            next = &jobs[step & 1];
+
+            next->row = (cml_u32)(step / ((cml_u64)num_j * num_k)) * tile_rows;
+            next->col = (cml_u32)((step / num_k) % num_j) * tile_cols;
+            next->k = (cml_u32)(step % num_k) * tile_k;
+            next->tile_rows = cml_ooc_min(tile_rows, m1.rows - next->row);
+            next->tile_cols = cml_ooc_min(tile_cols, m2.cols - next->col);
+            next->tile_k = cml_ooc_min(tile_k, m1.cols - next->k);
+
+            // the first load has nothing to overlap with
+            threaded =
+                step > 0 && cml_thread_create(&loader, cml_ooc_load, next);
+            if (!threaded) {
+                cml_ooc_load(next);
+            }
+        }
+
+        if (step > 0) {
+            cml_ooc_load_job* crnt = &jobs[(step - 1) & 1];
+
+            if (crnt->k == 0) {
+                size_t tile = (size_t)crnt->tile_rows * crnt->tile_cols;
+                memset(c, 0, tile * sizeof(float));
+            }
+
+            cml_ooc_multiply_tile(c, crnt->a, crnt->b, crnt->tile_rows,
+                                  crnt->tile_cols, crnt->tile_k);
+
+            if (crnt->k + crnt->tile_k == m1.cols) {
+                ret = cml_ooc_write_tile(file_out, &out, c, crnt->row,
+                                         crnt->col, crnt->tile_rows,
+                                         crnt->tile_cols);
+            }
+        }
+
+        if (threaded) {
+            cml_thread_join(&loader);
+        }
+        if (next) {
+            ret = ret && next->ok;
+        }
+    }
+
+    for (cml_u32 i = 0; i < 2; i++) {
+        free(a[i]);
+        free(b[i]);
+    }
+    free(c);
+
+    if (file1) {
+        fclose(file1);
+    }
+    if (file2) {
+        fclose(file2);
+    }
+    if (file_out && fclose(file_out) != 0) {
+        ret = FALSE;
+    }
+    return ret;
+}
@@ -0,0 +1,44 @@
+#ifndef CML_MATRIX_OOC_INCLUDED
+#define CML_MATRIX_OOC_INCLUDED
+
+#include "internal/cml_core.h"
+
+/*
+    Describes a matrix that lives in a file as raw float32
+    values in row-major order, starting at the byte "offset".
+*/
+typedef struct {
+    const char* path;
+    cml_u64 offset;
+    cml_u32 rows, cols;
+} cml_ooc_file;
+
+/*
+    Fills "file" with the description of a file written
+    by cml_matrix_save() (see matrix_io.h). Returns FALSE if
+    the file is invalid or its rows are padded.
+*/
+BOOL cml_ooc_file_from_matrix_file(const char* path, cml_ooc_file* file);
+
+/*
+    NOTE: m1.cols has to be equal to m2.rows and "out" has
+    to have m1.rows rows and m2.cols columns.
+
+    Multiplies the matrices stored in the files m1 and m2 and
+    writes the result into the file "out" without loading
+    the operands into memory. "out" is created if it does not
+    exist, bytes before "out.offset" are left untouched.
+
+    The operands are streamed in tiles. The next pair of tiles
+    is read on a second thread while the current pair is
+    multiplied, and every result tile is written once it is
+    complete. The memory used for the tiles never exceeds the
+    given "memory_budget" (in bytes), regardless of the size
+    of the matrices.
+
+    Returns FALSE if a file could not be read or written.
+*/
+BOOL cml_ooc_mat_mat_mult(cml_ooc_file m1, cml_ooc_file m2, cml_ooc_file out,
+                          cml_u64 memory_budget);
+
+#endif  // CML_MATRIX_OOC_INCLUDED
@@ -0,0 +1,267 @@
+#include "matrix_strassen.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal/cml_simd.h"
+
+/*
+    Depth of the slices the leaf kernel accumulates in one
+    pass, a slice of a CML_LANE_PANEL wide column panel
+    stays in the L1 cache.
+*/
+#define CML_STRASSEN_DEPTH_BLOCK 256
+
+/*
+    Rows of a the leaf kernel sweeps per packed column panel,
+    the slice of a (64 KB) stays in the L2 cache.
+*/
+#define CML_STRASSEN_ROW_BLOCK 64
+
+/*
+    Standard blocked kernel c = a * b on strided storage.
+*/
+static void cml_strassen_leaf(float* c, cml_u32 ldc, const float* a,
+                              cml_u32 lda, const float* b, cml_u32 ldb,
+                              cml_u32 m, cml_u32 k, cml_u32 n) {
+    const cml_u32 panel = CML_LANE_PANEL;
+    float packed[CML_STRASSEN_DEPTH_BLOCK * CML_LANE_PANEL];
+
+    if (k == 0) {
+        for (cml_u32 i = 0; i < m; i++) {
+            memset(c + (size_t)i * ldc, 0, n * sizeof(float));
+        }
+        return;
+    }
+
+    for (cml_u32 p0 = 0; p0 < k; p0 += CML_STRASSEN_DEPTH_BLOCK) {
+        cml_u32 depth = k - p0 < CML_STRASSEN_DEPTH_BLOCK
+                            ? k - p0
+                            : CML_STRASSEN_DEPTH_BLOCK;
+        BOOL accumulate = p0 > 0;
+        const float* a0 = a + p0;
+        const float* b0 = b + (size_t)p0 * ldb;
+
+        cml_u32 panels = n / panel * panel;
+
+        for (cml_u32 i0 = 0; i0 < m; i0 += CML_STRASSEN_ROW_BLOCK) {
+            cml_u32 i1 = m - i0 < CML_STRASSEN_ROW_BLOCK
+                             ? m
+                             : i0 + CML_STRASSEN_ROW_BLOCK;
+
+            for (cml_u32 j = 0; j < panels; j += panel) {
+                // contiguous copy, power of two strides thrash the L1 sets
+                for (cml_u32 p = 0; p < depth; p++) {
+                    memcpy(packed + p * panel, b0 + (size_t)p * ldb + j,
+                           panel * sizeof(float));
+                }
+
+                cml_u32 i = i0;
+                for (; i + 4 <= i1; i += 4) {
+                    cml_lane_micro(c + (size_t)i * ldc + j, ldc,
+                                   a0 + (size_t)i * lda, lda, packed, panel,
+                                   4, depth, accumulate);
+                }
+                for (; i < i1; i++) {
+                    cml_lane_micro(c + (size_t)i * ldc + j, ldc,
+                                   a0 + (size_t)i * lda, lda, packed, panel,
+                                   1, depth, accumulate);
+                }
+            }
+        }
+
+        // remaining columns
+        for (cml_u32 i = 0; i < m; i++) {
+            for (cml_u32 jj = panels; jj < n; jj++) {
+                float sum = accumulate ? c[(size_t)i * ldc + jj] : 0.0f;
+                for (cml_u32 p = 0; p < depth; p++) {
+                    sum += a0[(size_t)i * lda + p] * b0[(size_t)p * ldb + jj];
+                }
+                c[(size_t)i * ldc + jj] = sum;
+            }
+        }
+    }
+}
+
+// dst = x + sign * y
+static void cml_strassen_combine(float* dst, cml_u32 ldd, const float* x,
+                                 cml_u32 ldx, const float* y, cml_u32 ldy,
+                                 float sign, cml_u32 rows, cml_u32 cols) {
+    for (cml_u32 r = 0; r < rows; r++) {
+        float* d = dst + (size_t)r * ldd;
+        const float* xr = x + (size_t)r * ldx;
+        const float* yr = y + (size_t)r * ldy;
+
+        for (cml_u32 c = 0; c < cols; c++) {
+            d[c] = xr[c] + sign * yr[c];
+        }
+    }
+}
+
+static cml_u32 cml_strassen_levels(cml_u32 m, cml_u32 k, cml_u32 n,
+                                   cml_u32 cutoff) {
+    cml_u32 size = m < k ? m : k;
+    size = size < n ? size : n;
+
+    // 64 bit so that large cutoffs (UINT32_MAX) disable the recursion
+    cml_u32 levels = 0;
+    while ((cml_u64)(size >> levels) >= 2ull * cutoff) {
+        levels++;
+    }
+    return levels;
+}
+
+static cml_u32 cml_strassen_pad(cml_u32 size, cml_u32 levels) {
+    cml_u32 step = 1u << levels;
+    return (size + step - 1) / step * step;
+}
+
+/*
+    c = a * b for padded dimensions that are divisible by
+    2^levels. "work" holds the temporaries of all levels.
+*/
+static void cml_strassen_recurse(float* c, cml_u32 ldc, const float* a,
+                                 cml_u32 lda, const float* b, cml_u32 ldb,
+                                 cml_u32 m, cml_u32 k, cml_u32 n,
+                                 cml_u32 levels, float* work) {
+    if (levels == 0) {
+        cml_strassen_leaf(c, ldc, a, lda, b, ldb, m, k, n);
+        return;
+    }
+
+    cml_u32 hm = m / 2, hk = k / 2, hn = n / 2;
+    cml_u32 next = levels - 1;
+
+    const float* a11 = a;
+    const float* a12 = a + hk;
+    const float* a21 = a + (size_t)hm * lda;
+    const float* a22 = a21 + hk;
+    const float* b11 = b;
+    const float* b12 = b + hn;
+    const float* b21 = b + (size_t)hk * ldb;
+    const float* b22 = b21 + hn;
+    float* c11 = c;
+    float* c12 = c + hn;
+    float* c21 = c + (size_t)hm * ldc;
+    float* c22 = c21 + hn;
+
+    float* x = work;
+    float* y = x + (size_t)hm * hk;
+    float* z = y + (size_t)hk * hn;
+    float* rest = z + (size_t)hm * hn;
+
+    // c11 = p1 = a11 * b11
+    cml_strassen_recurse(c11, ldc, a11, lda, b11, ldb, hm, hk, hn, next, rest);
+
+    // c21 = p7 = (a11 - a21) * (b22 - b12)
+    cml_strassen_combine(x, hk, a11, lda, a21, lda, -1.0f, hm, hk);
+    cml_strassen_combine(y, hn, b22, ldb, b12, ldb, -1.0f, hk, hn);
+    cml_strassen_recurse(c21, ldc, x, hk, y, hn, hm, hk, hn, next, rest);
+
+    // c22 = p5 = s1 * t1 with s1 = a21 + a22, t1 = b12 - b11
+    cml_strassen_combine(x, hk, a21, lda, a22, lda, 1.0f, hm, hk);
+    cml_strassen_combine(y, hn, b12, ldb, b11, ldb, -1.0f, hk, hn);
+    cml_strassen_recurse(c22, ldc, x, hk, y, hn, hm, hk, hn, next, rest);
+
+    // z = p6 = s2 * t2 with s2 = s1 - a11, t2 = b22 - t1
+    cml_strassen_combine(x, hk, x, hk, a11, lda, -1.0f, hm, hk);
+    cml_strassen_combine(y, hn, b22, ldb, y, hn, -1.0f, hk, hn);
+    cml_strassen_recurse(z, hn, x, hk, y, hn, hm, hk, hn, next, rest);
+
+    // u2 = p1 + p6, u3 = u2 + p7, u4 = u2 + p5, c22 = u3 + p5
+    cml_strassen_combine(z, hn, z, hn, c11, ldc, 1.0f, hm, hn);
+    cml_strassen_combine(c21, ldc, c21, ldc, z, hn, 1.0f, hm, hn);
+    cml_strassen_combine(z, hn, z, hn, c22, ldc, 1.0f, hm, hn);
+    cml_strassen_combine(c22, ldc, c22, ldc, c21, ldc, 1.0f, hm, hn);
+
+    // c12 = u4 + p3 with p3 = (a12 - s2) * b22
+    cml_strassen_combine(x, hk, a12, lda, x, hk, -1.0f, hm, hk);
+    cml_strassen_recurse(c12, ldc, x, hk, b22, ldb, hm, hk, hn, next, rest);
+    cml_strassen_combine(c12, ldc, c12, ldc, z, hn, 1.0f, hm, hn);
+
+    // c21 = u3 - p4 with p4 = a22 * (t2 - b21)
+    cml_strassen_combine(y, hn, y, hn, b21, ldb, -1.0f, hk, hn);
+    cml_strassen_recurse(z, hn, a22, lda, y, hn, hm, hk, hn, next, rest);
+    cml_strassen_combine(c21, ldc, c21, ldc, z, hn, -1.0f, hm, hn);
+
+    // c11 = p1 + p2 with p2 = a12 * b21
+    cml_strassen_recurse(z, hn, a12, lda, b21, ldb, hm, hk, hn, next, rest);
+    cml_strassen_combine(c11, ldc, c11, ldc, z, hn, 1.0f, hm, hn);
+}
+
+cml_u64 cml_strassen_workspace_size(cml_u32 rows, cml_u32 depth,
+                                    cml_u32 cols, cml_u32 cutoff) {
+    if (cutoff == 0) {
+        cutoff = CML_STRASSEN_CUTOFF;
+    }
+
+    cml_u32 levels = cml_strassen_levels(rows, depth, cols, cutoff);
+    cml_u64 m = cml_strassen_pad(rows, levels);
+    cml_u64 k = cml_strassen_pad(depth, levels);
+    cml_u64 n = cml_strassen_pad(cols, levels);
+
+    cml_u64 ret = m * k + k * n + m * n;
+    for (cml_u32 l = 0; l < levels; l++) {
+        m /= 2;
+        k /= 2;
+        n /= 2;
+        ret += m * k + k * n + m * n;
+    }
+    return ret;
+}
+
+matrix cml_mat_mat_mult_strassen(matrix m1, matrix m2, cml_u32 cutoff,
+                                 float* workspace) {
+    assert(m1.cols == m2.rows);
+
+    if (cutoff == 0) {
+        cutoff = CML_STRASSEN_CUTOFF;
+    }
+
+    cml_u32 levels = cml_strassen_levels(m1.rows, m1.cols, m2.cols, cutoff);
+    cml_u32 m = cml_strassen_pad(m1.rows, levels);
+    cml_u32 k = cml_strassen_pad(m1.cols, levels);
+    cml_u32 n = cml_strassen_pad(m2.cols, levels);
+
+    float* owned = NULL;
+    if (!workspace) {
+        owned = malloc(cml_strassen_workspace_size(m1.rows, m1.cols, m2.cols,
+                                                   cutoff) *
+                       sizeof(float));
+        workspace = owned;
+    }
+
+    float* a = workspace;
+    float* b = a + (size_t)m * k;
+    float* c = b + (size_t)k * n;
+    float* work = c + (size_t)m * n;
+
+    // contiguous zero padded copies of the operands
+    for (cml_u32 r = 0; r < m; r++) {
+        float* row = a + (size_t)r * k;
+        cml_u32 copied = r < m1.rows ? m1.cols : 0;
+        if (copied) {
+            memcpy(row, m1.values[r], copied * sizeof(float));
+        }
+        memset(row + copied, 0, (k - copied) * sizeof(float));
+    }
+    for (cml_u32 r = 0; r < k; r++) {
+        float* row = b + (size_t)r * n;
+        cml_u32 copied = r < m2.rows ? m2.cols : 0;
+        if (copied) {
+            memcpy(row, m2.values[r], copied * sizeof(float));
+        }
+        memset(row + copied, 0, (n - copied) * sizeof(float));
+    }
+
+    cml_strassen_recurse(c, n, a, k, b, n, m, k, n, levels, work);
+
+    matrix ret = cml_matrix_allocate(m1.rows, m2.cols);
+    for (cml_u32 r = 0; r < ret.rows; r++) {
+        memcpy(ret.values[r], c + (size_t)r * n, ret.cols * sizeof(float));
+    }
+
+    free(owned);
+    return ret;
+}
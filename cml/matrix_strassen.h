@@ -0,0 +1,54 @@
+#ifndef CML_MATRIX_STRASSEN_INCLUDED
+#define CML_MATRIX_STRASSEN_INCLUDED
+
+#include "internal/cml_core.h"
+#include "matrix.h"
+
+/*
+    Default size below which cml_mat_mat_mult_strassen()
+    stops recursing and uses the blocked standard kernel.
+    Below it the saved multiplications no longer pay for the
+    extra additions and memory traffic.
+*/
+#define CML_STRASSEN_CUTOFF 128
+
+/*
+    Returns the number of floats of workspace that
+    cml_mat_mat_mult_strassen() needs for a (rows x depth)
+    times (depth x cols) product: padded copies of both
+    operands and the result plus three temporaries per
+    recursion level, about 4/3 * (rows * depth + depth * cols
+    + rows * cols) in total. A cutoff of 0 selects
+    CML_STRASSEN_CUTOFF.
+*/
+cml_u64 cml_strassen_workspace_size(cml_u32 rows, cml_u32 depth,
+                                    cml_u32 cols, cml_u32 cutoff);
+
+/*
+    NOTE: m1.cols has to be equal to m2.rows.
+
+    Multiplies m1 by m2 with the Strassen-Winograd algorithm
+    (7 multiplications and 15 additions of half size blocks
+    per level) and returns the product. The recursion stops
+    once the smallest dimension drops below 2 * cutoff, the
+    dimensions are zero padded to a multiple of 2^levels.
+    Matrices too small to recurse get the standard kernel.
+
+    "workspace" has to hold cml_strassen_workspace_size()
+    floats for the same dimensions and cutoff, so repeated
+    products do not allocate; pass NULL to let the function
+    allocate it (once, not per level).
+
+    The error bound is normwise instead of elementwise:
+    max |C - C'| <= f(n) * eps * max |m1| * max |m2| where
+    f grows by up to a factor of 6 per recursion level
+    (about 3 measured, a 2048 x 2048 product with the default
+    cutoff loses about 2 digits against the standard kernel),
+    so entries much smaller than |m1| * |m2| lose relative
+    accuracy. Use it for throughput bound jobs where that is
+    acceptable.
+*/
+matrix cml_mat_mat_mult_strassen(matrix m1, matrix m2, cml_u32 cutoff,
+                                 float* workspace);
+
+#endif  // CML_MATRIX_STRASSEN_INCLUDED
@@ -0,0 +1,419 @@
+#include "matrix_svd.h"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "internal/cml_eigen3.h"
+
+static double cml_svd_dot(const double* a, const double* b, cml_u32 count) {
+    double ret = 0.0;
+    for (cml_u32 i = 0; i < count; i++) {
+        ret += a[i] * b[i];
+    }
+    return ret;
+}
+
+/*
+    One-sided Jacobi: rotates pairs of columns of "w" until
+    all of them are orthogonal, accumulating the rotations in
+    the columns of "v". Columns are stored contiguously.
+*/
+static BOOL cml_svd_jacobi(double** w, double** v, cml_u32 m, cml_u32 n) {
+    for (cml_u32 sweep = 0; sweep < CML_SVD_MAX_SWEEPS; sweep++) {
+        BOOL rotated = FALSE;
+
+        for (cml_u32 p = 0; p + 1 < n; p++) {
+            for (cml_u32 q = p + 1; q < n; q++) {
+                double alpha = cml_svd_dot(w[p], w[p], m);
+                double beta = cml_svd_dot(w[q], w[q], m);
+                double gamma = cml_svd_dot(w[p], w[q], m);
+
+                if (alpha == 0.0 || beta == 0.0 ||
+                    fabs(gamma) <= DBL_EPSILON * sqrt(alpha * beta)) {
+                    continue;
+                }
+                rotated = TRUE;
+
+                // smaller root of t^2 + 2 * zeta * t - 1 = 0
+                double zeta = (beta - alpha) / (2.0 * gamma);
+                double t = (zeta >= 0.0 ? 1.0 : -1.0) /
+                           (fabs(zeta) + sqrt(1.0 + zeta * zeta));
+                double c = 1.0 / sqrt(1.0 + t * t);
+                double s = c * t;
+
+                for (cml_u32 i = 0; i < m; i++) {
+                    double wp = w[p][i];
+                    double wq = w[q][i];
+                    w[p][i] = c * wp - s * wq;
+                    w[q][i] = s * wp + c * wq;
+                }
+                for (cml_u32 i = 0; i < n; i++) {
+                    double vp = v[p][i];
+                    double vq = v[q][i];
+                    v[p][i] = c * vp - s * vq;
+                    v[q][i] = s * vp + c * vq;
+                }
+            }
+        }
+
+        if (!rotated) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+    Fills the columns [have, want) of "cols" (length m) with
+    unit vectors orthogonal to all previous columns. Each one
+    starts from the axis least covered by the basis so far,
+    whose residual is at least (m - have) / m.
+*/
+static void cml_svd_complete(double** cols, cml_u32 m, cml_u32 have,
+                             cml_u32 want) {
+    double* covered = calloc(m, sizeof(double));
+
+    for (cml_u32 j = 0; j < have; j++) {
+        for (cml_u32 i = 0; i < m; i++) {
+            covered[i] += cols[j][i] * cols[j][i];
+        }
+    }
+
+    for (cml_u32 j = have; j < want; j++) {
+        cml_u32 axis = 0;
+        for (cml_u32 i = 1; i < m; i++) {
+            if (covered[i] < covered[axis]) {
+                axis = i;
+            }
+        }
+
+        double* col = cols[j];
+        for (cml_u32 i = 0; i < m; i++) {
+            col[i] = i == axis ? 1.0 : 0.0;
+        }
+
+        // Gram-Schmidt twice is enough for orthogonality
+        for (cml_u32 pass = 0; pass < 2; pass++) {
+            for (cml_u32 k = 0; k < j; k++) {
+                double d = cml_svd_dot(cols[k], col, m);
+                for (cml_u32 i = 0; i < m; i++) {
+                    col[i] -= d * cols[k][i];
+                }
+            }
+        }
+
+        double inv = 1.0 / sqrt(cml_svd_dot(col, col, m));
+        for (cml_u32 i = 0; i < m; i++) {
+            col[i] *= inv;
+            covered[i] += col[i] * col[i];
+        }
+    }
+    free(covered);
+}
+
+static matrix cml_svd_to_matrix(double** cols, cml_u32 rows, cml_u32 count) {
+    matrix ret = cml_matrix_allocate(rows, count);
+
+    for (cml_u32 r = 0; r < rows; r++) {
+        for (cml_u32 c = 0; c < count; c++) {
+            ret.values[r][c] = (float)cols[c][r];
+        }
+    }
+    return ret;
+}
+
+BOOL cml_svd_decompose(matrix a, cml_svd_mode mode, cml_svd* out) {
+    // work on transpose(a) for wide matrices so that m >= n
+    BOOL transposed = a.rows < a.cols;
+    cml_u32 m = transposed ? a.cols : a.rows;
+    cml_u32 n = transposed ? a.rows : a.cols;
+    cml_u32 ucount = mode == CML_SVD_FULL ? m : n;
+
+    double* storage =
+        malloc(((size_t)ucount * m + (size_t)n * n + n) * sizeof(double));
+    double** w = malloc(ucount * sizeof(double*));
+    double** v = malloc(n * sizeof(double*));
+    double* s = storage + (size_t)ucount * m + (size_t)n * n;
+
+    for (cml_u32 j = 0; j < ucount; j++) {
+        w[j] = storage + (size_t)j * m;
+    }
+    for (cml_u32 j = 0; j < n; j++) {
+        v[j] = storage + (size_t)ucount * m + (size_t)j * n;
+
+        for (cml_u32 i = 0; i < m; i++) {
+            w[j][i] = transposed ? a.values[j][i] : a.values[i][j];
+        }
+        for (cml_u32 i = 0; i < n; i++) {
+            v[j][i] = i == j ? 1.0 : 0.0;
+        }
+    }
+
+    if (!cml_svd_jacobi(w, v, m, n)) {
+        free(w);
+        free(v);
+        free(storage);
+        return FALSE;
+    }
+
+    for (cml_u32 j = 0; j < n; j++) {
+        s[j] = sqrt(cml_svd_dot(w[j], w[j], m));
+    }
+
+    // sort descending, the columns move with their values
+    for (cml_u32 i = 0; i + 1 < n; i++) {
+        cml_u32 k = i;
+        for (cml_u32 j = i + 1; j < n; j++) {
+            if (s[j] > s[k]) {
+                k = j;
+            }
+        }
+        if (k != i) {
+            double tmp = s[i];
+            s[i] = s[k];
+            s[k] = tmp;
+
+            double* col = w[i];
+            w[i] = w[k];
+            w[k] = col;
+
+            col = v[i];
+            v[i] = v[k];
+            v[k] = col;
+        }
+    }
+
+    // columns of (numerically) zero singular values carry no direction
+    double threshold = n > 0 ? s[0] * m * DBL_EPSILON : 0.0;
+    cml_u32 rank = 0;
+    while (rank < n && s[rank] > threshold) {
+        double inv = 1.0 / s[rank];
+        for (cml_u32 i = 0; i < m; i++) {
+            w[rank][i] *= inv;
+        }
+        rank++;
+    }
+    cml_svd_complete(w, m, rank, ucount);
+
+    matrix left = cml_svd_to_matrix(w, m, ucount);
+    matrix right = cml_svd_to_matrix(v, n, n);
+
+    // a = v * s * transpose(u) if the transpose was decomposed
+    out->u = transposed ? right : left;
+    out->v = transposed ? left : right;
+    out->s = cml_vector_allocate(n);
+    for (cml_u32 j = 0; j < n; j++) {
+        out->s.values[j] = (float)s[j];
+    }
+
+    free(w);
+    free(v);
+    free(storage);
+    return TRUE;
+}
+
+void cml_svd_free(cml_svd* svd) {
+    cml_matrix_free_mem(&svd->u);
+    cml_matrix_free_mem(&svd->v);
+    cml_vector_free_mem(&svd->s);
+}
+
+static float cml_svd_tolerance(const cml_svd* svd, float tolerance) {
+    if (tolerance > 0.0f || svd->s.dimension == 0) {
+        return tolerance;
+    }
+    cml_u32 size = svd->u.rows > svd->v.rows ? svd->u.rows : svd->v.rows;
+    return size * FLT_EPSILON * svd->s.values[0];
+}
+
+cml_u32 cml_svd_rank(const cml_svd* svd, float tolerance) {
+    float tol = cml_svd_tolerance(svd, tolerance);
+    cml_u32 ret = 0;
+
+    while (ret < svd->s.dimension && svd->s.values[ret] > tol) {
+        ret++;
+    }
+    return ret;
+}
+
+/*
+    Replaces 1 / s by the filter factors of the truncated /
+    regularized inverse. Returns the number of factors that
+    are not zero.
+*/
+static cml_u32 cml_svd_filter(const cml_svd* svd, float tolerance,
+                              float damping, double* f) {
+    cml_u32 rank = cml_svd_rank(svd, tolerance);
+    double d2 = (double)damping * damping;
+
+    for (cml_u32 i = 0; i < rank; i++) {
+        double s = svd->s.values[i];
+        f[i] = s / (s * s + d2);
+    }
+    return rank;
+}
+
+void cml_svd_solve(const cml_svd* svd, matrix b, float tolerance,
+                   float damping, matrix* x) {
+    assert(b.rows == svd->u.rows);
+
+    cml_u32 k = svd->s.dimension;
+    cml_u32 cols = b.cols;
+    double* f = malloc(k * sizeof(double));
+    cml_u32 rank = cml_svd_filter(svd, tolerance, damping, f);
+    double* t = calloc((size_t)rank * cols, sizeof(double));
+
+    // t = diag(f) * transpose(u) * b
+    for (cml_u32 r = 0; r < b.rows; r++) {
+        for (cml_u32 i = 0; i < rank; i++) {
+            double ui = svd->u.values[r][i];
+            for (cml_u32 c = 0; c < cols; c++) {
+                t[(size_t)i * cols + c] += ui * b.values[r][c];
+            }
+        }
+    }
+    for (cml_u32 i = 0; i < rank; i++) {
+        for (cml_u32 c = 0; c < cols; c++) {
+            t[(size_t)i * cols + c] *= f[i];
+        }
+    }
+
+    // x = v * t
+    *x = cml_matrix_allocate(svd->v.rows, cols);
+    for (cml_u32 r = 0; r < svd->v.rows; r++) {
+        for (cml_u32 c = 0; c < cols; c++) {
+            double sum = 0.0;
+            for (cml_u32 i = 0; i < rank; i++) {
+                sum += svd->v.values[r][i] * t[(size_t)i * cols + c];
+            }
+            x->values[r][c] = (float)sum;
+        }
+    }
+
+    free(t);
+    free(f);
+}
+
+BOOL cml_pseudo_inverse(matrix a, float tolerance, matrix* out) {
+    cml_svd svd;
+    if (!cml_svd_decompose(a, CML_SVD_THIN, &svd)) {
+        return FALSE;
+    }
+
+    double* f = malloc(svd.s.dimension * sizeof(double));
+    cml_u32 rank = cml_svd_filter(&svd, tolerance, 0.0f, f);
+
+    // out = v * diag(f) * transpose(u)
+    *out = cml_matrix_allocate(a.cols, a.rows);
+    for (cml_u32 r = 0; r < a.cols; r++) {
+        for (cml_u32 c = 0; c < a.rows; c++) {
+            double sum = 0.0;
+            for (cml_u32 i = 0; i < rank; i++) {
+                sum += svd.v.values[r][i] * f[i] * svd.u.values[c][i];
+            }
+            out->values[r][c] = (float)sum;
+        }
+    }
+
+    free(f);
+    cml_svd_free(&svd);
+    return TRUE;
+}
+
+static void cml_svd3_cross(const double* a, const double* b, double* out) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+void cml_svd3_decompose(const float a[3][3], cml_svd3* out) {
+    // transpose(a) * a as a00 a01 a02 a11 a12 a22, kept in double
+    // because it squares the condition number
+    double ata[6];
+    cml_u32 idx = 0;
+    for (cml_u32 i = 0; i < 3; i++) {
+        for (cml_u32 j = i; j < 3; j++) {
+            double sum = 0.0;
+            for (cml_u32 r = 0; r < 3; r++) {
+                sum += (double)a[r][i] * a[r][j];
+            }
+            ata[idx++] = sum;
+        }
+    }
+
+    double eval[3], evec[3][3];
+    cml_eigen3_symmetric_double(ata, eval, evec);
+
+    // descending order, negating the last column keeps det(v) = 1
+    double v[3][3], b[3][3], u[3][3];
+    for (cml_u32 i = 0; i < 3; i++) {
+        v[0][i] = evec[2][i];
+        v[1][i] = evec[1][i];
+        v[2][i] = -evec[0][i];
+    }
+
+    // columns of a * v
+    for (cml_u32 j = 0; j < 3; j++) {
+        for (cml_u32 r = 0; r < 3; r++) {
+            b[j][r] = a[r][0] * v[j][0] + a[r][1] * v[j][1] + a[r][2] * v[j][2];
+        }
+    }
+
+    // a * v = u * r with r close to diagonal, diag(r) = s
+    double s[3] = {0.0, 0.0, 0.0};
+    s[0] = sqrt(cml_svd_dot(b[0], b[0], 3));
+
+    if (s[0] == 0.0) {
+        for (cml_u32 r = 0; r < 3; r++) {
+            for (cml_u32 c = 0; c < 3; c++) {
+                u[c][r] = r == c ? 1.0 : 0.0;
+            }
+        }
+    } else {
+        for (cml_u32 i = 0; i < 3; i++) {
+            u[0][i] = b[0][i] / s[0];
+        }
+
+        double d = cml_svd_dot(u[0], b[1], 3);
+        for (cml_u32 i = 0; i < 3; i++) {
+            u[1][i] = b[1][i] - d * u[0][i];
+        }
+        s[1] = sqrt(cml_svd_dot(u[1], u[1], 3));
+
+        if (s[1] > s[0] * DBL_EPSILON) {
+            for (cml_u32 i = 0; i < 3; i++) {
+                u[1][i] /= s[1];
+            }
+        } else {
+            // rank 1: any unit vector orthogonal to u0
+            double axis[3] = {0.0, 0.0, 0.0};
+            cml_u32 smallest = 0;
+            for (cml_u32 i = 1; i < 3; i++) {
+                if (fabs(u[0][i]) < fabs(u[0][smallest])) {
+                    smallest = i;
+                }
+            }
+            axis[smallest] = 1.0;
+            cml_svd3_cross(u[0], axis, u[1]);
+
+            double inv = 1.0 / sqrt(cml_svd_dot(u[1], u[1], 3));
+            for (cml_u32 i = 0; i < 3; i++) {
+                u[1][i] *= inv;
+            }
+            s[1] = 0.0;
+        }
+
+        cml_svd3_cross(u[0], u[1], u[2]);
+        s[2] = cml_svd_dot(u[2], b[2], 3);
+    }
+
+    for (cml_u32 r = 0; r < 3; r++) {
+        out->s[r] = (float)s[r];
+        for (cml_u32 c = 0; c < 3; c++) {
+            out->u[r][c] = (float)u[c][r];
+            out->v[r][c] = (float)v[c][r];
+        }
+    }
+}
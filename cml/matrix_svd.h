@@ -0,0 +1,104 @@
+#ifndef CML_MATRIX_SVD_INCLUDED
+#define CML_MATRIX_SVD_INCLUDED
+
+#include "internal/cml_core.h"
+#include "matrix.h"
+#include "vector.h"
+
+/*
+    Singular value decomposition a = u * diag(s) * transpose(v)
+    of an m x n matrix, with values[r][c] as row r, column c
+    (like matrix_factor.h). With k = min(m, n), "s" holds the
+    k singular values in descending order and the columns of
+    "u" / "v" the matching left / right singular vectors.
+*/
+typedef struct {
+    matrix u;
+    vector s;
+    matrix v;
+} cml_svd;
+
+/*
+    CML_SVD_THIN:  u is m x k and v is n x k (economy size)
+    CML_SVD_FULL:  u is m x m and v is n x n, the columns past
+                   k complete orthonormal bases
+*/
+typedef enum {
+    CML_SVD_THIN = 0,
+    CML_SVD_FULL
+} cml_svd_mode;
+
+/*
+    Maximum number of Jacobi sweeps before
+    cml_svd_decompose() gives up. Well scaled matrices need
+    about 6 to 10.
+*/
+#define CML_SVD_MAX_SWEEPS 60
+
+/*
+    Computes the singular value decomposition of "a" with the
+    one-sided Jacobi method (Hestenes) in double precision,
+    which finds small singular values to high relative
+    accuracy and handles rank deficient matrices. Singular
+    vectors of zero singular values are completed to an
+    orthonormal set. "out" is allocated by this function,
+    free it with cml_svd_free().
+
+    Returns FALSE (and allocates nothing) if the iteration
+    does not converge within CML_SVD_MAX_SWEEPS.
+*/
+BOOL cml_svd_decompose(matrix a, cml_svd_mode mode, cml_svd* out);
+
+void cml_svd_free(cml_svd* svd);
+
+/*
+    Returns the number of singular values above "tolerance".
+    A tolerance <= 0 selects max(m, n) * FLT_EPSILON * s[0].
+*/
+cml_u32 cml_svd_rank(const cml_svd* svd, float tolerance);
+
+/*
+    Solves min |a * X - B| for every column of the m x k
+    matrix "b" and writes the minimum norm n x k solution to
+    "x", which is allocated by this function. Singular values
+    below "tolerance" (see cml_svd_rank()) are dropped and a
+    "damping" > 0 applies Tikhonov regularization, i.e.
+    s / (s^2 + damping^2) replaces 1 / s.
+*/
+void cml_svd_solve(const cml_svd* svd, matrix b, float tolerance,
+                   float damping, matrix* x);
+
+/*
+    Computes the Moore-Penrose pseudo-inverse (n x m) of the
+    m x n matrix "a" into "out", which is allocated by this
+    function. Singular values below "tolerance" (see
+    cml_svd_rank()) are treated as zero. Returns FALSE if the
+    decomposition fails.
+*/
+BOOL cml_pseudo_inverse(matrix a, float tolerance, matrix* out);
+
+/*
+    Signed SVD of a 3x3 matrix a = u * diag(s) * transpose(v)
+    where "u" and "v" are rotations (determinant +1). "s" is
+    sorted by decreasing magnitude and s[2] is negative if
+    det(a) < 0, so for Kabsch / Procrustes alignment the
+    optimal rotation is u * transpose(v) without a reflection
+    fix up. Matrices are row major, m[r][c].
+*/
+typedef struct {
+    float u[3][3];
+    float s[3];
+    float v[3][3];
+} cml_svd3;
+
+/*
+    Computes the signed SVD of the row major 3x3 matrix "a"
+    without allocating: "v" comes from the closed-form eigen
+    decomposition of transpose(a) * a (cml_eigen3_symmetric()),
+    formed and solved in double precision, and "u", "s" from a
+    QR factorization of a * v, which keeps the small singular
+    values accurate.
+*/
+void cml_svd3_decompose(const float a[3][3], cml_svd3* out);
+
+#endif  // CML_MATRIX_SVD_INCLUDED
@@ -3,6 +3,8 @@
 #include <assert.h>
 #include <math.h>
 
+#include "vmath.h"
+
 matrix cml_translate(matrix m, vector v) {
     assert(m.cols == 4 && m.rows == 4);
 
@@ -18,8 +20,8 @@ matrix cml_rotate(matrix m, float angle, vector v) {
     assert(m.cols == 4 && m.rows == 4);
 
     const float a = angle;
-    const float c = (float)cos(a);
-    const float s = (float)sin(a);
+    float c, s;
+    cml_sincos(a, &s, &c);
 
     vector axis = cml_vector_normalized(v);
 
@@ -115,15 +117,56 @@ matrix cml_look_at(vector eye, vector center, vector up) {
 
 matrix cml_perspective(float fov, float aspect_ratio, float near_plane,
                        float far_plane) {
-    const float tan_half_fov = (float)tan(fov / 2);
+    return cml_perspective_projection(fov, aspect_ratio, near_plane,
+                                      far_plane, CML_DEPTH_NEGATIVE_ONE_TO_ONE,
+                                      NULL);
+}
+
+matrix cml_perspective_projection(float fov, float aspect_ratio,
+                                  float near_plane, float far_plane,
+                                  cml_depth_mode depth, matrix* inverse) {
+    assert(near_plane > 0 && far_plane > near_plane);
+
+    const float tan_half_fov = cml_tan(fov / 2);
+    const BOOL infinite = isinf(far_plane);
+
+    // clip z = a * z + b, clip w = -z
+    float a, b;
+    switch (depth) {
+        case CML_DEPTH_NEGATIVE_ONE_TO_ONE:
+            a = infinite ? -1 : -(far_plane + near_plane) /
+                                    (far_plane - near_plane);
+            b = infinite ? -2 * near_plane
+                         : -(2 * far_plane * near_plane) /
+                               (far_plane - near_plane);
+            break;
+        case CML_DEPTH_ZERO_TO_ONE:
+            a = infinite ? -1 : -far_plane / (far_plane - near_plane);
+            b = infinite ? -near_plane
+                         : -(far_plane * near_plane) / (far_plane - near_plane);
+            break;
+        default:
+            a = infinite ? 0 : near_plane / (far_plane - near_plane);
+            b = infinite ? near_plane
+                         : (far_plane * near_plane) / (far_plane - near_plane);
+            break;
+    }
 
     matrix ret = cml_matrix_empty(4, 4);
     ret.values[0][0] = 1 / (aspect_ratio * tan_half_fov);
     ret.values[1][1] = 1 / tan_half_fov;
-    ret.values[2][2] = -(far_plane + near_plane) / (far_plane - near_plane);
+    ret.values[2][2] = a;
     ret.values[2][3] = -1;
-    ret.values[3][2] = -(2 * far_plane * near_plane) / (far_plane - near_plane);
-
+    ret.values[3][2] = b;
+
+    if (inverse) {
+        *inverse = cml_matrix_empty(4, 4);
+        inverse->values[0][0] = aspect_ratio * tan_half_fov;
+        inverse->values[1][1] = tan_half_fov;
+        inverse->values[3][2] = -1;
+        inverse->values[2][3] = 1 / b;
+        inverse->values[3][3] = a / b;
+    }
     return ret;
 }
 
@@ -135,5 +178,48 @@ matrix cml_ortho(float left, float right, float bottom, float top) {
     ret.values[3][0] = -(right + left) / (right - left);
     ret.values[3][1] = -(top + bottom) / (top - bottom);
 
+    return ret;
+}
+
+matrix cml_ortho_projection(float left, float right, float bottom, float top,
+                            float near_plane, float far_plane,
+                            cml_depth_mode depth, matrix* inverse) {
+    assert(isfinite(near_plane) && isfinite(far_plane) &&
+           far_plane != near_plane);
+
+    // clip z = c * z + d
+    float c, d;
+    switch (depth) {
+        case CML_DEPTH_NEGATIVE_ONE_TO_ONE:
+            c = -2 / (far_plane - near_plane);
+            d = -(far_plane + near_plane) / (far_plane - near_plane);
+            break;
+        case CML_DEPTH_ZERO_TO_ONE:
+            c = -1 / (far_plane - near_plane);
+            d = -near_plane / (far_plane - near_plane);
+            break;
+        default:
+            c = 1 / (far_plane - near_plane);
+            d = far_plane / (far_plane - near_plane);
+            break;
+    }
+
+    matrix ret = cml_matrix_identity(4);
+    ret.values[0][0] = 2 / (right - left);
+    ret.values[1][1] = 2 / (top - bottom);
+    ret.values[2][2] = c;
+    ret.values[3][0] = -(right + left) / (right - left);
+    ret.values[3][1] = -(top + bottom) / (top - bottom);
+    ret.values[3][2] = d;
+
+    if (inverse) {
+        *inverse = cml_matrix_identity(4);
+        inverse->values[0][0] = (right - left) / 2;
+        inverse->values[1][1] = (top - bottom) / 2;
+        inverse->values[2][2] = 1 / c;
+        inverse->values[3][0] = (right + left) / 2;
+        inverse->values[3][1] = (top + bottom) / 2;
+        inverse->values[3][2] = -d / c;
+    }
     return ret;
 }
\ No newline at end of file
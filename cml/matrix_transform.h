@@ -12,8 +12,54 @@ matrix cml_scale(matrix m, vector v);
 
 matrix cml_look_at(vector eye, vector center, vector up);
 
+/*
+    Selects the clip space depth range a projection maps the
+    near and far plane to.
+
+    CML_DEPTH_NEGATIVE_ONE_TO_ONE: near -> -1, far -> 1
+    (OpenGL default).
+
+    CML_DEPTH_ZERO_TO_ONE: near -> 0, far -> 1 (Direct3D,
+    Vulkan, glClipControl).
+
+    CML_DEPTH_REVERSE_Z: near -> 1, far -> 0. Combined with
+    a floating point depth buffer the precision is spread
+    almost evenly over the depth range. Requires a "greater"
+    depth test and clearing the depth to 0.
+*/
+typedef enum {
+    CML_DEPTH_NEGATIVE_ONE_TO_ONE = 0,
+    CML_DEPTH_ZERO_TO_ONE,
+    CML_DEPTH_REVERSE_Z
+} cml_depth_mode;
+
 matrix cml_perspective(float fov, float aspect_ratio, float near_plane, float far_plane);
 
+/*
+    NOTE: near_plane has to be positive.
+
+    Returns a perspective projection that maps the depth
+    range [near_plane, far_plane] as selected by "depth".
+    "far_plane" may be INFINITY for an infinite far plane.
+
+    If "inverse" is not NULL the analytic inverse of the
+    projection is written to it, which maps clip space
+    positions back to view space.
+*/
+matrix cml_perspective_projection(float fov, float aspect_ratio,
+                                  float near_plane, float far_plane,
+                                  cml_depth_mode depth, matrix* inverse);
+
 matrix cml_ortho(float left, float right, float bottom, float top);
 
+/*
+    Returns an orthographic projection with the given near
+    and far plane, depth is mapped as selected by "depth".
+    If "inverse" is not NULL the analytic inverse is
+    written to it.
+*/
+matrix cml_ortho_projection(float left, float right, float bottom, float top,
+                            float near_plane, float far_plane,
+                            cml_depth_mode depth, matrix* inverse);
+
 #endif  // CML_MATRIX_TRANSFORM_INCLUDED
\ No newline at end of file
@@ -0,0 +1,271 @@
+#include "packed.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+#include "reduce.h"
+
+static float cml_packed_dot(const float* a, const float* b, cml_u32 count) {
+    return cml_reduce_dot(a, b, count, CML_REDUCE_PAIRWISE);
+}
+
+// y += a * x
+static void cml_packed_axpy(float* y, const float* x, float a, cml_u32 count) {
+    for (cml_u32 i = 0; i < count; i++) {
+        y[i] += a * x[i];
+    }
+}
+
+static size_t cml_packed_lower_offset(cml_u32 r) {
+    return (size_t)r * (r + 1) / 2;
+}
+
+// rows 0 .. r - 1 of an upper triangle hold n, n - 1, ... elements
+static size_t cml_packed_upper_offset(cml_u32 n, cml_u32 r) {
+    return (size_t)r * n - (size_t)r * (r - 1) / 2;
+}
+
+cml_packed_sym cml_packed_sym_allocate(cml_u32 n) {
+    cml_packed_sym ret;
+    ret.n = n;
+    ret.values = calloc(CML_PACKED_SIZE(n), sizeof(float));
+    return ret;
+}
+
+void cml_packed_sym_free(cml_packed_sym* a) {
+    free(a->values);
+    a->values = NULL;
+    a->n = 0;
+}
+
+cml_packed_sym cml_packed_sym_from_matrix(matrix m) {
+    assert(m.rows == m.cols);
+
+    cml_packed_sym ret;
+    ret.n = m.rows;
+    ret.values = malloc(CML_PACKED_SIZE(m.rows) * sizeof(float));
+
+    for (cml_u32 r = 0; r < m.rows; r++) {
+        memcpy(ret.values + cml_packed_lower_offset(r), m.values[r],
+               (r + 1) * sizeof(float));
+    }
+    return ret;
+}
+
+matrix cml_packed_sym_to_matrix(const cml_packed_sym* a) {
+    matrix ret = cml_matrix_allocate(a->n, a->n);
+
+    for (cml_u32 r = 0; r < a->n; r++) {
+        const float* row = a->values + cml_packed_lower_offset(r);
+        for (cml_u32 c = 0; c <= r; c++) {
+            ret.values[r][c] = row[c];
+            ret.values[c][r] = row[c];
+        }
+    }
+    return ret;
+}
+
+float cml_packed_sym_get(const cml_packed_sym* a, cml_u32 r, cml_u32 c) {
+    assert(r < a->n && c < a->n);
+
+    if (c > r) {
+        cml_u32 tmp = r;
+        r = c;
+        c = tmp;
+    }
+    return a->values[cml_packed_lower_offset(r) + c];
+}
+
+void cml_packed_sym_set(cml_packed_sym* a, cml_u32 r, cml_u32 c,
+                        float value) {
+    assert(r < a->n && c < a->n);
+
+    if (c > r) {
+        cml_u32 tmp = r;
+        r = c;
+        c = tmp;
+    }
+    a->values[cml_packed_lower_offset(r) + c] = value;
+}
+
+void cml_packed_sym_mat_vec(const cml_packed_sym* a, const float* x,
+                            float* y) {
+    memset(y, 0, a->n * sizeof(float));
+
+    // row r holds (r, 0 .. r) and by symmetry (0 .. r - 1, r)
+    for (cml_u32 r = 0; r < a->n; r++) {
+        const float* row = a->values + cml_packed_lower_offset(r);
+
+        y[r] += cml_packed_dot(row, x, r + 1);
+        cml_packed_axpy(y, row, x[r], r);
+    }
+}
+
+typedef struct {
+    cml_packed_sym* a;
+    float alpha, beta;
+    matrix x;
+} cml_packed_rank_k_job;
+
+static void cml_packed_rank_k_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_packed_rank_k_job* job = arg;
+    cml_u32 k = job->x.cols;
+
+    for (cml_u32 r = begin; r < end; r++) {
+        float* row = job->a->values + cml_packed_lower_offset(r);
+
+        for (cml_u32 c = 0; c <= r; c++) {
+            float update = job->alpha * cml_packed_dot(job->x.values[r],
+                                                       job->x.values[c], k);
+            // beta == 0 overwrites, so uninitialized values never leak in
+            row[c] = job->beta == 0.0f ? update : job->beta * row[c] + update;
+        }
+    }
+}
+
+void cml_packed_sym_rank_k(cml_packed_sym* a, float alpha, matrix x,
+                           float beta) {
+    assert(x.rows == a->n);
+
+    cml_packed_rank_k_job job;
+    job.a = a;
+    job.alpha = alpha;
+    job.beta = beta;
+    job.x = x;
+
+    if (CML_PACKED_SIZE(a->n) * x.cols < CML_PARALLEL_THRESHOLD) {
+        cml_packed_rank_k_range(0, a->n, &job);
+        return;
+    }
+    cml_parallel_for(0, a->n, 16, cml_packed_rank_k_range, &job);
+}
+
+cml_packed_tri cml_packed_tri_allocate(cml_u32 n, cml_triangle triangle) {
+    cml_packed_tri ret;
+    ret.n = n;
+    ret.triangle = triangle;
+    ret.values = calloc(CML_PACKED_SIZE(n), sizeof(float));
+    return ret;
+}
+
+void cml_packed_tri_free(cml_packed_tri* t) {
+    free(t->values);
+    t->values = NULL;
+    t->n = 0;
+}
+
+/*
+    Returns the stored part of row r, which starts at column
+    "first" and has "count" elements.
+*/
+static float* cml_packed_tri_row(const cml_packed_tri* t, cml_u32 r,
+                                 cml_u32* first, cml_u32* count) {
+    if (t->triangle == CML_LOWER) {
+        *first = 0;
+        *count = r + 1;
+        return t->values + cml_packed_lower_offset(r);
+    }
+    *first = r;
+    *count = t->n - r;
+    return t->values + cml_packed_upper_offset(t->n, r);
+}
+
+cml_packed_tri cml_packed_tri_from_matrix(matrix m, cml_triangle triangle) {
+    assert(m.rows == m.cols);
+
+    cml_packed_tri ret;
+    ret.n = m.rows;
+    ret.triangle = triangle;
+    ret.values = malloc(CML_PACKED_SIZE(m.rows) * sizeof(float));
+
+    for (cml_u32 r = 0; r < m.rows; r++) {
+        cml_u32 first, count;
+        float* row = cml_packed_tri_row(&ret, r, &first, &count);
+        memcpy(row, m.values[r] + first, count * sizeof(float));
+    }
+    return ret;
+}
+
+matrix cml_packed_tri_to_matrix(const cml_packed_tri* t) {
+    matrix ret = cml_matrix_allocate(t->n, t->n);
+
+    for (cml_u32 r = 0; r < t->n; r++) {
+        cml_u32 first, count;
+        const float* row = cml_packed_tri_row(t, r, &first, &count);
+
+        memset(ret.values[r], 0, t->n * sizeof(float));
+        memcpy(ret.values[r] + first, row, count * sizeof(float));
+    }
+    return ret;
+}
+
+float cml_packed_tri_get(const cml_packed_tri* t, cml_u32 r, cml_u32 c) {
+    assert(r < t->n && c < t->n);
+
+    cml_u32 first, count;
+    const float* row = cml_packed_tri_row(t, r, &first, &count);
+
+    if (c < first || c >= first + count) {
+        return 0.0f;
+    }
+    return row[c - first];
+}
+
+void cml_packed_tri_set(cml_packed_tri* t, cml_u32 r, cml_u32 c,
+                        float value) {
+    assert(r < t->n && c < t->n);
+
+    cml_u32 first, count;
+    float* row = cml_packed_tri_row(t, r, &first, &count);
+
+    assert(c >= first && c < first + count);
+    row[c - first] = value;
+}
+
+void cml_packed_tri_mat_vec(const cml_packed_tri* t, const float* x,
+                            float* y, BOOL transpose) {
+    if (transpose) {
+        memset(y, 0, t->n * sizeof(float));
+    }
+
+    for (cml_u32 r = 0; r < t->n; r++) {
+        cml_u32 first, count;
+        const float* row = cml_packed_tri_row(t, r, &first, &count);
+
+        if (transpose) {
+            cml_packed_axpy(y + first, row, x[r], count);
+        } else {
+            y[r] = cml_packed_dot(row, x + first, count);
+        }
+    }
+}
+
+void cml_packed_tri_solve(const cml_packed_tri* t, float* b, BOOL transpose) {
+    cml_u32 n = t->n;
+    BOOL lower = t->triangle == CML_LOWER;
+
+    // L and transpose(U) are solved forward, the others backward
+    BOOL forward = lower != transpose;
+
+    for (cml_u32 step = 0; step < n; step++) {
+        cml_u32 r = forward ? step : n - 1 - step;
+        cml_u32 first, count;
+        const float* row = cml_packed_tri_row(t, r, &first, &count);
+
+        // the diagonal ends a lower row and starts an upper one
+        float diagonal = lower ? row[count - 1] : row[0];
+        const float* off = lower ? row : row + 1;
+        float* solved = lower ? b : b + r + 1;
+
+        if (!transpose) {
+            // x_r = (b_r - sum t[r][j] * x_j) / t[r][r] over solved j
+            b[r] = (b[r] - cml_packed_dot(off, solved, count - 1)) / diagonal;
+        } else {
+            // row r of t is column r of transpose(t): remove x_r from the rest
+            b[r] /= diagonal;
+            cml_packed_axpy(solved, off, -b[r], count - 1);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef CML_PACKED_INCLUDED
+#define CML_PACKED_INCLUDED
+
+#include "internal/cml_core.h"
+#include "matrix.h"
+#include "matrix_factor.h"
+
+/*
+    Packed storage of n x n symmetric and triangular matrices
+    that keeps only the n * (n + 1) / 2 elements of one
+    triangle in a single allocation, half the memory and
+    bandwidth of a dense matrix. Like matrix_factor.h, (r, c)
+    is row r, column c.
+*/
+
+/*
+    Returns the number of floats of a packed n x n triangle.
+*/
+#define CML_PACKED_SIZE(n) ((size_t)(n) * ((n) + 1) / 2)
+
+/*
+    Symmetric matrix, the lower triangle is stored row by
+    row: (r, c) with c <= r is values[r * (r + 1) / 2 + c].
+*/
+typedef struct {
+    cml_u32 n;
+    float* values;
+} cml_packed_sym;
+
+/*
+    Triangular matrix. A lower triangle is stored like
+    cml_packed_sym, an upper triangle row by row starting at
+    the diagonal. The other triangle is zero.
+*/
+typedef struct {
+    cml_u32 n;
+    cml_triangle triangle;
+    float* values;
+} cml_packed_tri;
+
+/*
+    Returns a zero initialized n x n packed matrix.
+*/
+cml_packed_sym cml_packed_sym_allocate(cml_u32 n);
+
+void cml_packed_sym_free(cml_packed_sym* a);
+
+/*
+    NOTE: "m" has to be square, only its lower triangle is
+          read.
+*/
+cml_packed_sym cml_packed_sym_from_matrix(matrix m);
+
+matrix cml_packed_sym_to_matrix(const cml_packed_sym* a);
+
+float cml_packed_sym_get(const cml_packed_sym* a, cml_u32 r, cml_u32 c);
+
+/*
+    Sets (r, c) and with it (c, r).
+*/
+void cml_packed_sym_set(cml_packed_sym* a, cml_u32 r, cml_u32 c,
+                        float value);
+
+/*
+    y = a * x, "x" and "y" have n elements.
+*/
+void cml_packed_sym_mat_vec(const cml_packed_sym* a, const float* x,
+                            float* y);
+
+/*
+    NOTE: x.rows has to be equal to a->n.
+
+    Symmetric rank-k update a = beta * a + alpha * x *
+    transpose(x) for the n x k matrix "x", e.g. accumulating
+    a covariance or Gram matrix. Only the stored triangle is
+    computed; large updates run on the thread pool.
+*/
+void cml_packed_sym_rank_k(cml_packed_sym* a, float alpha, matrix x,
+                           float beta);
+
+/*
+    Returns a zero initialized n x n packed triangle.
+*/
+cml_packed_tri cml_packed_tri_allocate(cml_u32 n, cml_triangle triangle);
+
+void cml_packed_tri_free(cml_packed_tri* t);
+
+/*
+    NOTE: "m" has to be square.
+
+    Packs the given triangle of "m", e.g. a Cholesky factor
+    from cml_cholesky().
+*/
+cml_packed_tri cml_packed_tri_from_matrix(matrix m, cml_triangle triangle);
+
+matrix cml_packed_tri_to_matrix(const cml_packed_tri* t);
+
+/*
+    Returns (r, c), 0 outside of the stored triangle.
+*/
+float cml_packed_tri_get(const cml_packed_tri* t, cml_u32 r, cml_u32 c);
+
+/*
+    NOTE: (r, c) has to lie in the stored triangle.
+*/
+void cml_packed_tri_set(cml_packed_tri* t, cml_u32 r, cml_u32 c,
+                        float value);
+
+/*
+    y = t * x (or transpose(t) * x if "transpose" is TRUE).
+*/
+void cml_packed_tri_mat_vec(const cml_packed_tri* t, const float* x,
+                            float* y, BOOL transpose);
+
+/*
+    Solves t * x = b (or transpose(t) * x = b) and overwrites
+    "b" with x.
+*/
+void cml_packed_tri_solve(const cml_packed_tri* t, float* b, BOOL transpose);
+
+#endif  // CML_PACKED_INCLUDED
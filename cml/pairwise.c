@@ -0,0 +1,281 @@
+#include "pairwise.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal/cml_simd.h"
+#include "parallel.h"
+#include "reduce.h"
+
+/*
+    Vectors of b whose packed panels stay in the cache while
+    every row group of a range is multiplied with them.
+*/
+#define CML_PAIRWISE_COL_BLOCK 256
+
+typedef struct {
+    cml_u32 dimension;
+    cml_u32 a_count, b_count;
+    float* a;
+    float* b;
+    float* a_norms;
+    float* b_norms;
+    cml_metric metric;
+    float** out;
+    cml_u32 k;
+    cml_u32* indices;
+    float* values;
+} cml_pairwise_job;
+
+/*
+    Packs a into rows padded to a multiple of 4 and b into
+    panels of CML_LANE_PANEL columns, panel q holds
+    b[q * panel + c][p] at [(q * dimension + p) * panel + c].
+*/
+static void cml_pairwise_pack(cml_pairwise_job* job, const vector* a,
+                              const vector* b) {
+    cml_u32 d = job->dimension;
+    cml_u32 rows = (job->a_count + 3) / 4 * 4;
+    cml_u32 panels = (job->b_count + CML_LANE_PANEL - 1) / CML_LANE_PANEL;
+
+    job->a = calloc((size_t)rows * d + 1, sizeof(float));
+    job->b = calloc((size_t)panels * d * CML_LANE_PANEL + 1,
+                    sizeof(float));
+    job->a_norms = malloc(job->a_count * sizeof(float));
+    job->b_norms = malloc(job->b_count * sizeof(float));
+
+    for (cml_u32 i = 0; i < job->a_count; i++) {
+        assert(a[i].dimension == d);
+        memcpy(job->a + (size_t)i * d, a[i].values, d * sizeof(float));
+        job->a_norms[i] =
+            cml_reduce_sum_squares(a[i].values, d, CML_REDUCE_PAIRWISE);
+    }
+
+    for (cml_u32 j = 0; j < job->b_count; j++) {
+        assert(b[j].dimension == d);
+        float* panel =
+            job->b + (size_t)(j / CML_LANE_PANEL) * d * CML_LANE_PANEL;
+        for (cml_u32 p = 0; p < d; p++) {
+            panel[(size_t)p * CML_LANE_PANEL + j % CML_LANE_PANEL] =
+                b[j].values[p];
+        }
+        job->b_norms[j] =
+            cml_reduce_sum_squares(b[j].values, d, CML_REDUCE_PAIRWISE);
+    }
+}
+
+static void cml_pairwise_free(cml_pairwise_job* job) {
+    free(job->a);
+    free(job->b);
+    free(job->a_norms);
+    free(job->b_norms);
+}
+
+static float cml_pairwise_value(cml_metric metric, float dot, float a_norm,
+                                float b_norm) {
+    float d2;
+    switch (metric) {
+        case CML_METRIC_SQUARED_EUCLIDEAN:
+        case CML_METRIC_EUCLIDEAN:
+            d2 = a_norm + b_norm - 2.0f * dot;
+            d2 = d2 > 0.0f ? d2 : 0.0f;
+            return metric == CML_METRIC_EUCLIDEAN ? sqrtf(d2) : d2;
+        case CML_METRIC_COSINE:
+            if (a_norm == 0.0f || b_norm == 0.0f) {
+                return 0.0f;
+            }
+            return dot / sqrtf(a_norm * b_norm);
+        default:
+            return dot;
+    }
+}
+
+static BOOL cml_pairwise_is_similarity(cml_metric metric) {
+    return metric == CML_METRIC_COSINE || metric == CML_METRIC_DOT;
+}
+
+/*
+    Restores the max heap property below "i", the root holds
+    the worst of the best k so far.
+*/
+static void cml_pairwise_sift_down(cml_u32* indices, float* keys,
+                                   cml_u32 count, cml_u32 i) {
+    for (;;) {
+        cml_u32 largest = i;
+        cml_u32 l = 2 * i + 1, r = 2 * i + 2;
+        if (l < count && keys[l] > keys[largest]) {
+            largest = l;
+        }
+        if (r < count && keys[r] > keys[largest]) {
+            largest = r;
+        }
+        if (largest == i) {
+            return;
+        }
+
+        float key = keys[i];
+        keys[i] = keys[largest];
+        keys[largest] = key;
+        cml_u32 t = indices[i];
+        indices[i] = indices[largest];
+        indices[largest] = t;
+        i = largest;
+    }
+}
+
+/*
+    Offers column j with "key" (smaller is better) to the heap
+    of a row. The columns arrive in order, so the heap holds
+    min(j, k) elements.
+*/
+static void cml_pairwise_offer(cml_u32* indices, float* keys, cml_u32 k,
+                               cml_u32 j, float key) {
+    if (j < k) {
+        cml_u32 c = j;
+        while (c > 0 && keys[(c - 1) / 2] < key) {
+            keys[c] = keys[(c - 1) / 2];
+            indices[c] = indices[(c - 1) / 2];
+            c = (c - 1) / 2;
+        }
+        keys[c] = key;
+        indices[c] = j;
+    } else if (key < keys[0]) {
+        keys[0] = key;
+        indices[0] = j;
+        cml_pairwise_sift_down(indices, keys, k, 0);
+    }
+}
+
+static void cml_pairwise_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_pairwise_job* job = arg;
+    cml_u32 d = job->dimension;
+    cml_u32 panels = (job->b_count + CML_LANE_PANEL - 1) / CML_LANE_PANEL;
+    const cml_u32 block = CML_PAIRWISE_COL_BLOCK / CML_LANE_PANEL;
+    BOOL similarity = cml_pairwise_is_similarity(job->metric);
+    float tile[4 * CML_LANE_PANEL];
+
+    // a block of b panels stays in the cache for all row groups
+    for (cml_u32 q0 = 0; q0 < panels; q0 += block) {
+        cml_u32 q1 = q0 + block < panels ? q0 + block : panels;
+
+        for (cml_u32 g = begin; g < end; g++) {
+            cml_u32 row = 4 * g;
+            cml_u32 rows = job->a_count - row < 4 ? job->a_count - row : 4;
+
+            for (cml_u32 q = q0; q < q1; q++) {
+                cml_u32 col = q * CML_LANE_PANEL;
+                cml_u32 cols = job->b_count - col < CML_LANE_PANEL
+                                   ? job->b_count - col
+                                   : CML_LANE_PANEL;
+
+                cml_lane_micro(tile, CML_LANE_PANEL,
+                               job->a + (size_t)row * d, d,
+                               job->b + (size_t)q * d * CML_LANE_PANEL,
+                               CML_LANE_PANEL, 4, d, FALSE);
+
+                for (cml_u32 r = 0; r < rows; r++) {
+                    cml_u32 i = row + r;
+                    for (cml_u32 c = 0; c < cols; c++) {
+                        cml_u32 j = col + c;
+                        float v = cml_pairwise_value(
+                            job->metric, tile[r * CML_LANE_PANEL + c],
+                            job->a_norms[i], job->b_norms[j]);
+
+                        if (job->out) {
+                            job->out[i][j] = v;
+                        } else {
+                            cml_pairwise_offer(
+                                job->indices + (size_t)i * job->k,
+                                job->values + (size_t)i * job->k, job->k, j,
+                                similarity ? -v : v);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void cml_pairwise_run(cml_pairwise_job* job) {
+    cml_u32 groups = (job->a_count + 3) / 4;
+
+    if ((cml_u64)job->a_count * job->b_count * job->dimension <
+        CML_PARALLEL_THRESHOLD) {
+        cml_pairwise_range(0, groups, job);
+        return;
+    }
+    cml_parallel_for(0, groups, 4, cml_pairwise_range, job);
+}
+
+matrix cml_pairwise_distances(const vector* a, cml_u32 a_count,
+                              const vector* b, cml_u32 b_count,
+                              cml_metric metric) {
+    matrix ret = cml_matrix_allocate(a_count, b_count);
+    if (a_count == 0 || b_count == 0) {
+        return ret;
+    }
+
+    cml_pairwise_job job;
+    job.dimension = a[0].dimension;
+    job.a_count = a_count;
+    job.b_count = b_count;
+    job.metric = metric;
+    job.out = ret.values;
+    job.k = 0;
+    job.indices = NULL;
+    job.values = NULL;
+
+    cml_pairwise_pack(&job, a, b);
+    cml_pairwise_run(&job);
+    cml_pairwise_free(&job);
+    return ret;
+}
+
+void cml_pairwise_top_k(const vector* a, cml_u32 a_count, const vector* b,
+                        cml_u32 b_count, cml_metric metric, cml_u32 k,
+                        cml_u32* indices, float* values) {
+    assert(k <= b_count);
+
+    if (a_count == 0 || k == 0) {
+        return;
+    }
+
+    cml_pairwise_job job;
+    job.dimension = a[0].dimension;
+    job.a_count = a_count;
+    job.b_count = b_count;
+    job.metric = metric;
+    job.out = NULL;
+    job.k = k;
+    job.indices = indices;
+    job.values = values;
+
+    cml_pairwise_pack(&job, a, b);
+    cml_pairwise_run(&job);
+    cml_pairwise_free(&job);
+
+    // heap sort every row best first and undo the negated similarities
+    BOOL similarity = cml_pairwise_is_similarity(metric);
+    for (cml_u32 i = 0; i < a_count; i++) {
+        cml_u32* row_indices = indices + (size_t)i * k;
+        float* row_values = values + (size_t)i * k;
+
+        for (cml_u32 end = k; end-- > 1;) {
+            float key = row_values[0];
+            row_values[0] = row_values[end];
+            row_values[end] = key;
+            cml_u32 t = row_indices[0];
+            row_indices[0] = row_indices[end];
+            row_indices[end] = t;
+            cml_pairwise_sift_down(row_indices, row_values, end, 0);
+        }
+
+        if (similarity) {
+            for (cml_u32 c = 0; c < k; c++) {
+                row_values[c] = -row_values[c];
+            }
+        }
+    }
+}
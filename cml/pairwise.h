@@ -0,0 +1,54 @@
+#ifndef CML_PAIRWISE_INCLUDED
+#define CML_PAIRWISE_INCLUDED
+
+#include "internal/cml_core.h"
+#include "matrix.h"
+#include "vector.h"
+
+/*
+    CML_METRIC_SQUARED_EUCLIDEAN:  |a - b|^2
+    CML_METRIC_EUCLIDEAN:          |a - b|
+    CML_METRIC_COSINE:             a . b / (|a| |b|), 0 if a
+                                   or b is zero (a similarity)
+    CML_METRIC_DOT:                a . b (a similarity)
+*/
+typedef enum {
+    CML_METRIC_SQUARED_EUCLIDEAN = 0,
+    CML_METRIC_EUCLIDEAN,
+    CML_METRIC_COSINE,
+    CML_METRIC_DOT
+} cml_metric;
+
+/*
+    NOTE: all vectors of "a" and "b" have to have the same
+          dimension.
+
+    Returns the a_count x b_count matrix of the metric
+    between a[r] and b[c] at values[r][c] (row r, column c
+    like matrix_factor.h).
+
+    All metrics are computed from the dot products of a
+    blocked matrix product a * transpose(b) and the squared
+    norms, |a - b|^2 = |a|^2 + |b|^2 - 2 a . b, so the
+    distances of (nearly) equal vectors lose the relative
+    precision of a direct difference and are clamped to 0.
+    Large problems run on the thread pool.
+*/
+matrix cml_pairwise_distances(const vector* a, cml_u32 a_count,
+                              const vector* b, cml_u32 b_count,
+                              cml_metric metric);
+
+/*
+    NOTE: k has to be at most b_count.
+
+    Finds the k best vectors of "b" for every a[r], the
+    smallest distances or the largest similarities, without
+    building the full matrix. The indices into "b" and the
+    metric values are written best first to
+    indices[r * k .. r * k + k - 1] and values[r * k ..].
+*/
+void cml_pairwise_top_k(const vector* a, cml_u32 a_count, const vector* b,
+                        cml_u32 b_count, cml_metric metric, cml_u32 k,
+                        cml_u32* indices, float* values);
+
+#endif  // CML_PAIRWISE_INCLUDED
@@ -0,0 +1,267 @@
+#include "parallel.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "internal/cml_thread.h"
+
+/*
+    Remaining index range of one thread. The owner takes
+    work from the front, thieves take it from the back.
+*/
+typedef struct {
+    cml_mutex lock;
+    cml_u32 begin, end;
+} cml_parallel_slot;
+
+typedef struct {
+    BOOL running;
+    BOOL quit;
+    BOOL busy;
+    cml_u32 num_threads;
+
+    cml_thread* workers;
+    cml_parallel_slot* slots;
+
+    cml_mutex lock;
+    cml_cond wake;
+    cml_cond done;
+
+    // the loop that is currently executed
+    cml_u64 generation;
+    cml_u32 active;
+    cml_parallel_fn fn;
+    void* arg;
+    cml_u32 grain;
+} cml_parallel_pool;
+
+typedef struct {
+    cml_u32 index;
+} cml_parallel_worker;
+
+static cml_parallel_pool cml_pool;
+
+static CML_THREAD_LOCAL BOOL cml_parallel_inside = FALSE;
+
+static BOOL cml_parallel_take(cml_parallel_slot* slot, cml_u32 grain,
+                              cml_u32* begin, cml_u32* end) {
+    cml_mutex_lock(&slot->lock);
+
+    BOOL ret = slot->begin < slot->end;
+    if (ret) {
+        *begin = slot->begin;
+        *end = slot->end - slot->begin > grain ? slot->begin + grain
+                                               : slot->end;
+        slot->begin = *end;
+    }
+
+    cml_mutex_unlock(&slot->lock);
+    return ret;
+}
+
+static BOOL cml_parallel_steal(cml_u32 self) {
+    cml_parallel_slot* own = &cml_pool.slots[self];
+
+    for (cml_u32 i = 1; i < cml_pool.num_threads; i++) {
+        cml_parallel_slot* victim =
+            &cml_pool.slots[(self + i) % cml_pool.num_threads];
+
+        cml_mutex_lock(&victim->lock);
+
+        cml_u32 remaining = victim->end - victim->begin;
+        if (remaining == 0) {
+            cml_mutex_unlock(&victim->lock);
+            continue;
+        }
+
+        // take the back half, or everything if it is a single grain
+        cml_u32 split = remaining > cml_pool.grain
+                            ? victim->end - remaining / 2
+                            : victim->begin;
+        cml_u32 end = victim->end;
+        victim->end = split;
+
+        cml_mutex_unlock(&victim->lock);
+
+        cml_mutex_lock(&own->lock);
+        own->begin = split;
+        own->end = end;
+        cml_mutex_unlock(&own->lock);
+
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static void cml_parallel_work(cml_u32 self) {
+    BOOL was_inside = cml_parallel_inside;
+    cml_parallel_inside = TRUE;
+
+    cml_u32 begin, end;
+    do {
+        while (cml_parallel_take(&cml_pool.slots[self], cml_pool.grain, &begin,
+                                 &end)) {
+            cml_pool.fn(begin, end, cml_pool.arg);
+        }
+    } while (cml_parallel_steal(self));
+
+    cml_parallel_inside = was_inside;
+}
+
+static void cml_parallel_worker_main(void* arg) {
+    cml_u32 index = ((cml_parallel_worker*)arg)->index;
+    free(arg);
+
+    cml_u64 seen = 0;
+
+    cml_mutex_lock(&cml_pool.lock);
+    while (TRUE) {
+        while (cml_pool.generation == seen && !cml_pool.quit) {
+            cml_cond_wait(&cml_pool.wake, &cml_pool.lock);
+        }
+        if (cml_pool.quit) {
+            break;
+        }
+        seen = cml_pool.generation;
+        cml_mutex_unlock(&cml_pool.lock);
+
+        cml_parallel_work(index);
+
+        cml_mutex_lock(&cml_pool.lock);
+        if (--cml_pool.active == 0) {
+            cml_cond_broadcast(&cml_pool.done);
+        }
+    }
+    cml_mutex_unlock(&cml_pool.lock);
+}
+
+void cml_parallel_init(cml_u32 num_threads) {
+    assert(!cml_pool.running);
+
+    if (num_threads == 0) {
+        num_threads = cml_thread_hardware_concurrency();
+    }
+
+    cml_pool.quit = FALSE;
+    cml_pool.busy = FALSE;
+    cml_pool.generation = 0;
+    cml_pool.num_threads = num_threads;
+
+    cml_mutex_init(&cml_pool.lock);
+    cml_cond_init(&cml_pool.wake);
+    cml_cond_init(&cml_pool.done);
+
+    cml_pool.slots = malloc(num_threads * sizeof(cml_parallel_slot));
+    for (cml_u32 i = 0; i < num_threads; i++) {
+        cml_mutex_init(&cml_pool.slots[i].lock);
+        cml_pool.slots[i].begin = 0;
+        cml_pool.slots[i].end = 0;
+    }
+
+    // slot 0 belongs to the thread that calls cml_parallel_for()
+    cml_pool.workers = malloc(num_threads * sizeof(cml_thread));
+    for (cml_u32 i = 1; i < num_threads; i++) {
+        cml_parallel_worker* worker = malloc(sizeof(cml_parallel_worker));
+        worker->index = i;
+
+        if (!cml_thread_create(&cml_pool.workers[i], cml_parallel_worker_main,
+                               worker)) {
+            free(worker);
+            cml_pool.num_threads = i;
+            break;
+        }
+    }
+
+    cml_pool.running = TRUE;
+}
+
+void cml_parallel_shutdown(void) {
+    if (!cml_pool.running) {
+        return;
+    }
+
+    cml_mutex_lock(&cml_pool.lock);
+    cml_pool.quit = TRUE;
+    cml_cond_broadcast(&cml_pool.wake);
+    cml_mutex_unlock(&cml_pool.lock);
+
+    for (cml_u32 i = 1; i < cml_pool.num_threads; i++) {
+        cml_thread_join(&cml_pool.workers[i]);
+    }
+
+    for (cml_u32 i = 0; i < cml_pool.num_threads; i++) {
+        cml_mutex_destroy(&cml_pool.slots[i].lock);
+    }
+    cml_cond_destroy(&cml_pool.done);
+    cml_cond_destroy(&cml_pool.wake);
+    cml_mutex_destroy(&cml_pool.lock);
+
+    free(cml_pool.slots);
+    free(cml_pool.workers);
+
+    cml_pool.running = FALSE;
+}
+
+cml_u32 cml_parallel_num_threads(void) {
+    return cml_pool.running ? cml_pool.num_threads : 1;
+}
+
+void cml_parallel_for(cml_u32 begin, cml_u32 end, cml_u32 grain,
+                      cml_parallel_fn fn, void* arg) {
+    if (begin >= end) {
+        return;
+    }
+
+    BOOL serial = !cml_pool.running || cml_pool.num_threads < 2 ||
+                  cml_parallel_inside;
+
+    if (!serial) {
+        cml_mutex_lock(&cml_pool.lock);
+        serial = cml_pool.busy;
+        cml_pool.busy = TRUE;
+        cml_mutex_unlock(&cml_pool.lock);
+    }
+
+    cml_u32 count = end - begin;
+    if (serial || count <= grain) {
+        if (!serial) {
+            cml_mutex_lock(&cml_pool.lock);
+            cml_pool.busy = FALSE;
+            cml_mutex_unlock(&cml_pool.lock);
+        }
+        fn(begin, end, arg);
+        return;
+    }
+
+    cml_u32 num_threads = cml_pool.num_threads;
+    if (grain == 0) {
+        grain = count / (num_threads * 8);
+        grain = grain > 0 ? grain : 1;
+    }
+
+    // workers are asleep, the slots can be filled without locking
+    for (cml_u32 i = 0; i < num_threads; i++) {
+        cml_pool.slots[i].begin =
+            begin + (cml_u32)((cml_u64)count * i / num_threads);
+        cml_pool.slots[i].end =
+            begin + (cml_u32)((cml_u64)count * (i + 1) / num_threads);
+    }
+
+    cml_mutex_lock(&cml_pool.lock);
+    cml_pool.fn = fn;
+    cml_pool.arg = arg;
+    cml_pool.grain = grain;
+    cml_pool.active = num_threads - 1;
+    cml_pool.generation++;
+    cml_cond_broadcast(&cml_pool.wake);
+    cml_mutex_unlock(&cml_pool.lock);
+
+    cml_parallel_work(0);
+
+    cml_mutex_lock(&cml_pool.lock);
+    while (cml_pool.active > 0) {
+        cml_cond_wait(&cml_pool.done, &cml_pool.lock);
+    }
+    cml_pool.busy = FALSE;
+    cml_mutex_unlock(&cml_pool.lock);
+}
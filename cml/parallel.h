@@ -0,0 +1,64 @@
+#ifndef CML_PARALLEL_INCLUDED
+#define CML_PARALLEL_INCLUDED
+
+#include "internal/cml_core.h"
+
+/*
+    Number of elements from which the library runs its
+    element-wise and row operations on the thread pool.
+    Can be overridden at compile time.
+*/
+#ifndef CML_PARALLEL_THRESHOLD
+#define CML_PARALLEL_THRESHOLD (1u << 16)
+#endif
+
+/*
+    Function that processes the indices [begin, end) of
+    a parallel loop. "arg" is passed through unchanged.
+*/
+typedef void (*cml_parallel_fn)(cml_u32 begin, cml_u32 end, void* arg);
+
+/*
+    Starts the thread pool with the given number of threads
+    (the calling thread included). Zero uses one thread per
+    hardware thread.
+
+    Until this function is called every parallel loop runs
+    on the calling thread, so the library never creates
+    threads on its own.
+*/
+void cml_parallel_init(cml_u32 num_threads);
+
+/*
+    Stops and joins all threads of the pool.
+*/
+void cml_parallel_shutdown(void);
+
+/*
+    Returns the number of threads that take part in a
+    parallel loop (1 if the pool is not running).
+*/
+cml_u32 cml_parallel_num_threads(void);
+
+/*
+    Calls "fn" for chunks of the index range [begin, end)
+    on all threads of the pool and returns when every index
+    has been processed. The calling thread takes part in
+    the work.
+
+    The range is split evenly between the threads. A thread
+    processes its part "grain" indices at a time and steals
+    half of the remaining work of another thread once its
+    own part is done. A grain of zero picks a size
+    automatically.
+
+    The loop runs on the calling thread alone if the pool
+    is not running, if it is called from inside another
+    parallel loop or if another thread is using the pool.
+    This keeps the number of threads bounded when the caller
+    is multithreaded itself.
+*/
+void cml_parallel_for(cml_u32 begin, cml_u32 end, cml_u32 grain,
+                      cml_parallel_fn fn, void* arg);
+
+#endif  // CML_PARALLEL_INCLUDED
@@ -0,0 +1,540 @@
+#include "quantized.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal/cml_simd.h"
+#include "parallel.h"
+
+/*
+    Columns of b per cache block of cml_f16_mult_range(), the
+    4 widened rows of a group sweep the whole block.
+*/
+#define CML_QUANTIZED_COL_BLOCK 256
+
+/*
+    Columns of an 8 bit dot product that are summed in 32 bit
+    integers before they are flushed to a float. The whole
+    chunk, all SIMD lanes and the tail together, stays below
+    2^31 for values in -127 .. 127: 2^17 * 127^2 < 2^31.
+*/
+#define CML_QUANTIZED_I8_CHUNK (1u << 17)
+
+static cml_u32 cml_float_bits(float value) {
+    cml_u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float cml_bits_float(cml_u32 bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+cml_half cml_float_to_half(float value) {
+    cml_u32 bits = cml_float_bits(value);
+    cml_u32 sign = (bits >> 16) & 0x8000u;
+    cml_u32 abs = bits & 0x7fffffffu;
+
+    if (abs >= 0x7f800000u) {
+        // infinity, or a quiet NaN with the top mantissa bits
+        cml_u32 nan = abs > 0x7f800000u ? 0x200u | ((abs >> 13) & 0x3ffu) : 0;
+        return (cml_half)(sign | 0x7c00u | nan);
+    }
+    if (abs >= 0x477ff000u) {
+        // 65520 and above round to infinity
+        return (cml_half)(sign | 0x7c00u);
+    }
+
+    if (abs < 0x38800000u) {
+        // below 2^-14 the result is a subnormal half, m * 2^-24
+        cml_u32 exponent = abs >> 23;
+        if (exponent < 102) {
+            return (cml_half)sign;
+        }
+        cml_u32 mantissa = (abs & 0x7fffffu) | 0x800000u;
+        cml_u32 shift = 126 - exponent;
+        cml_u32 m = mantissa >> shift;
+        cml_u32 rest = mantissa & ((1u << shift) - 1);
+        cml_u32 half = 1u << (shift - 1);
+        if (rest > half || (rest == half && (m & 1))) {
+            m++;
+        }
+        return (cml_half)(sign | m);
+    }
+
+    // rebias the exponent from 127 to 15, a carry of the rounding
+    // into the exponent is the correct result
+    cml_u32 h = (abs - 0x38000000u) >> 13;
+    cml_u32 rest = abs & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (h & 1))) {
+        h++;
+    }
+    return (cml_half)(sign | h);
+}
+
+float cml_half_to_float(cml_half value) {
+    cml_u32 bits = ((cml_u32)value & 0x7fffu) << 13;
+    cml_u32 exponent = bits & 0x0f800000u;
+
+    bits += (127 - 15) << 23;
+    if (exponent == 0x0f800000u) {
+        // infinity / NaN
+        bits += (128 - 16) << 23;
+    } else if (exponent == 0) {
+        // zero / subnormal, normalized by the float subtraction
+        bits += 1u << 23;
+        float normalized = cml_bits_float(bits) - cml_bits_float(113u << 23);
+        bits = cml_float_bits(normalized);
+    }
+    return cml_bits_float(bits | ((cml_u32)value & 0x8000u) << 16);
+}
+
+void cml_float_to_half_array(const float* values, cml_u32 count,
+                             cml_half* out) {
+    cml_u32 i = 0;
+#ifdef CML_SIMD_F16C
+    for (; i + 4 <= count; i += 4) {
+        __m128i h = _mm_cvtps_ph(_mm_loadu_ps(values + i),
+                                 _MM_FROUND_TO_NEAREST_INT);
+        _mm_storel_epi64((__m128i*)(out + i), h);
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = cml_float_to_half(values[i]);
+    }
+}
+
+#ifdef CML_SIMD_SSE
+
+/*
+    Widens 8 halves to two registers of 4 floats.
+*/
+static inline void cml_half8_load(const cml_half* p, __m128* lo, __m128* hi) {
+#ifdef CML_SIMD_F16C
+    *lo = _mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)p));
+    *hi = _mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)(p + 4)));
+#else
+    // scale the shifted bits by 2^112 and patch infinity / NaN and sign
+    const __m128i no_sign = _mm_set1_epi32(0x7fff);
+    const __m128i inf_nan = _mm_set1_epi32(0x7bff);
+    const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+    const __m128i inf_exponent = _mm_set1_epi32(255 << 23);
+
+    __m128i h = _mm_loadu_si128((const __m128i*)p);
+    __m128i zero = _mm_setzero_si128();
+    __m128i halves[2] = {_mm_unpacklo_epi16(h, zero),
+                         _mm_unpackhi_epi16(h, zero)};
+    __m128 out[2];
+
+    for (cml_u32 k = 0; k < 2; k++) {
+        __m128i em = _mm_and_si128(halves[k], no_sign);
+        __m128i sign = _mm_slli_epi32(_mm_xor_si128(halves[k], em), 16);
+        __m128 scaled =
+            _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(em, 13)), magic);
+        __m128i special = _mm_and_si128(_mm_cmpgt_epi32(em, inf_nan),
+                                        inf_exponent);
+        out[k] = _mm_or_ps(scaled,
+                           _mm_castsi128_ps(_mm_or_si128(sign, special)));
+    }
+    *lo = out[0];
+    *hi = out[1];
+#endif
+}
+
+static inline float cml_hsum(__m128 a) {
+    a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+    a = _mm_add_ss(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(a);
+}
+
+#endif
+
+void cml_half_to_float_array(const cml_half* values, cml_u32 count,
+                             float* out) {
+    cml_u32 i = 0;
+#ifdef CML_SIMD_SSE
+    for (; i + 8 <= count; i += 8) {
+        __m128 lo, hi;
+        cml_half8_load(values + i, &lo, &hi);
+        _mm_storeu_ps(out + i, lo);
+        _mm_storeu_ps(out + i + 4, hi);
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = cml_half_to_float(values[i]);
+    }
+}
+
+cml_matrix_f16 cml_matrix_f16_quantize(matrix m) {
+    cml_matrix_f16 ret;
+    ret.rows = m.rows;
+    ret.cols = m.cols;
+    ret.values = malloc((size_t)m.rows * m.cols * sizeof(cml_half));
+
+    for (cml_u32 r = 0; r < m.rows; r++) {
+        cml_float_to_half_array(m.values[r], m.cols,
+                                ret.values + (size_t)r * m.cols);
+    }
+    return ret;
+}
+
+matrix cml_matrix_f16_dequantize(const cml_matrix_f16* m) {
+    matrix ret = cml_matrix_allocate(m->rows, m->cols);
+
+    for (cml_u32 r = 0; r < m->rows; r++) {
+        cml_half_to_float_array(m->values + (size_t)r * m->cols, m->cols,
+                                ret.values[r]);
+    }
+    return ret;
+}
+
+void cml_matrix_f16_free(cml_matrix_f16* m) {
+    free(m->values);
+    m->values = NULL;
+    m->rows = 0;
+    m->cols = 0;
+}
+
+static float cml_f16_dot(const cml_half* a, const float* x, cml_u32 count) {
+    float sum = 0.0f;
+    cml_u32 i = 0;
+#ifdef CML_SIMD_SSE
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        __m128 lo, hi;
+        cml_half8_load(a + i, &lo, &hi);
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(lo, _mm_loadu_ps(x + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(hi, _mm_loadu_ps(x + i + 4)));
+    }
+    sum = cml_hsum(_mm_add_ps(acc0, acc1));
+#endif
+    for (; i < count; i++) {
+        sum += cml_half_to_float(a[i]) * x[i];
+    }
+    return sum;
+}
+
+typedef struct {
+    const void* m;
+    const float* x;
+    float* y;
+    const cml_i8* qx;
+    float x_scale;
+} cml_quantized_mat_vec_job;
+
+static void cml_f16_mat_vec_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_quantized_mat_vec_job* job = arg;
+    const cml_matrix_f16* m = job->m;
+
+    for (cml_u32 r = begin; r < end; r++) {
+        job->y[r] = cml_f16_dot(m->values + (size_t)r * m->cols, job->x,
+                                m->cols);
+    }
+}
+
+void cml_matrix_f16_mat_vec(const cml_matrix_f16* m, const float* x,
+                            float* y) {
+    cml_quantized_mat_vec_job job;
+    job.m = m;
+    job.x = x;
+    job.y = y;
+
+    if ((cml_u64)m->rows * m->cols < CML_PARALLEL_THRESHOLD) {
+        cml_f16_mat_vec_range(0, m->rows, &job);
+        return;
+    }
+    cml_parallel_for(0, m->rows, 64, cml_f16_mat_vec_range, &job);
+}
+
+typedef struct {
+    const cml_matrix_f16* a;
+    const float* b;
+    cml_u32 cols;
+    matrix out;
+} cml_f16_mult_job;
+
+static void cml_f16_mult_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_f16_mult_job* job = arg;
+    const cml_matrix_f16* a = job->a;
+    cml_u32 depth = a->cols;
+    cml_u32 panels = (job->cols + CML_LANE_PANEL - 1) / CML_LANE_PANEL;
+    const cml_u32 block = CML_QUANTIZED_COL_BLOCK / CML_LANE_PANEL;
+
+    float tile[4 * CML_LANE_PANEL];
+    float* rows = calloc(4 * (size_t)depth + 1, sizeof(float));
+
+    for (cml_u32 q0 = 0; q0 < panels; q0 += block) {
+        cml_u32 q1 = q0 + block < panels ? q0 + block : panels;
+
+        for (cml_u32 g = begin; g < end; g++) {
+            cml_u32 row = 4 * g;
+            cml_u32 count = a->rows - row < 4 ? a->rows - row : 4;
+
+            // widening is cheap next to the panel products of a block
+            for (cml_u32 r = 0; r < count; r++) {
+                cml_half_to_float_array(a->values + (size_t)(row + r) * depth,
+                                        depth, rows + (size_t)r * depth);
+            }
+
+            for (cml_u32 q = q0; q < q1; q++) {
+                cml_u32 col = q * CML_LANE_PANEL;
+                cml_u32 cols = job->cols - col < CML_LANE_PANEL
+                                   ? job->cols - col
+                                   : CML_LANE_PANEL;
+
+                cml_lane_micro(tile, CML_LANE_PANEL, rows, depth,
+                               job->b + (size_t)q * depth * CML_LANE_PANEL,
+                               CML_LANE_PANEL, 4, depth, FALSE);
+
+                for (cml_u32 r = 0; r < count; r++) {
+                    memcpy(job->out.values[row + r] + col,
+                           tile + r * CML_LANE_PANEL,
+                           cols * sizeof(float));
+                }
+            }
+        }
+    }
+
+    free(rows);
+}
+
+matrix cml_matrix_f16_mat_mult(const cml_matrix_f16* a, matrix b) {
+    assert(b.rows == a->cols);
+
+    matrix ret = cml_matrix_allocate(a->rows, b.cols);
+    if (a->rows == 0 || b.cols == 0) {
+        return ret;
+    }
+
+    // b in panels of CML_LANE_PANEL columns over the full depth
+    cml_u32 depth = a->cols;
+    cml_u32 panels = (b.cols + CML_LANE_PANEL - 1) / CML_LANE_PANEL;
+    float* packed =
+        calloc((size_t)panels * depth * CML_LANE_PANEL + 1, sizeof(float));
+
+    for (cml_u32 p = 0; p < depth; p++) {
+        for (cml_u32 j = 0; j < b.cols; j++) {
+            size_t panel = (size_t)(j / CML_LANE_PANEL) * depth + p;
+            packed[panel * CML_LANE_PANEL + j % CML_LANE_PANEL] =
+                b.values[p][j];
+        }
+    }
+
+    cml_f16_mult_job job;
+    job.a = a;
+    job.b = packed;
+    job.cols = b.cols;
+    job.out = ret;
+
+    cml_u32 groups = (a->rows + 3) / 4;
+    if ((cml_u64)a->rows * b.cols * depth < CML_PARALLEL_THRESHOLD) {
+        cml_f16_mult_range(0, groups, &job);
+    } else {
+        cml_parallel_for(0, groups, 4, cml_f16_mult_range, &job);
+    }
+
+    free(packed);
+    return ret;
+}
+
+/*
+    Quantizes "count" values symmetrically to -127 .. 127 and
+    returns the scale, max |value| / 127 (0 for all zeros).
+*/
+static float cml_quantize_i8(const float* values, cml_u32 count, cml_i8* out) {
+    float max = 0.0f;
+    for (cml_u32 i = 0; i < count; i++) {
+        float v = fabsf(values[i]);
+        max = v > max ? v : max;
+    }
+
+    if (max == 0.0f) {
+        memset(out, 0, count);
+        return 0.0f;
+    }
+
+    float scale = max / 127.0f;
+    float inv = 127.0f / max;
+    for (cml_u32 i = 0; i < count; i++) {
+        long q = lrintf(values[i] * inv);
+        out[i] = (cml_i8)(q > 127 ? 127 : q < -127 ? -127 : q);
+    }
+    return scale;
+}
+
+/*
+    Dot product of two 8 bit arrays, accumulated in 32 bit
+    integers.
+*/
+static float cml_i8_dot(const cml_i8* a, const cml_i8* b, cml_u32 count) {
+    float sum = 0.0f;
+
+    for (cml_u32 c0 = 0; c0 < count; c0 += CML_QUANTIZED_I8_CHUNK) {
+        cml_u32 c1 = count - c0 < CML_QUANTIZED_I8_CHUNK
+                         ? count
+                         : c0 + CML_QUANTIZED_I8_CHUNK;
+        cml_i32 total = 0;
+        cml_u32 i = c0;
+
+#ifdef CML_SIMD_SSE
+        // sign extend to 16 bits and multiply-add pairs into 32 bits
+        __m128i acc = _mm_setzero_si128();
+        for (; i + 16 <= c1; i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+            __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+            __m128i x_lo = _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8);
+            __m128i x_hi = _mm_srai_epi16(_mm_unpackhi_epi8(x, x), 8);
+            __m128i y_lo = _mm_srai_epi16(_mm_unpacklo_epi8(y, y), 8);
+            __m128i y_hi = _mm_srai_epi16(_mm_unpackhi_epi8(y, y), 8);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(x_lo, y_lo));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(x_hi, y_hi));
+        }
+        acc = _mm_add_epi32(acc,
+                            _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+        acc = _mm_add_epi32(acc,
+                            _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+        total = _mm_cvtsi128_si32(acc);
+#endif
+        for (; i < c1; i++) {
+            total += (cml_i32)a[i] * b[i];
+        }
+        sum += (float)total;
+    }
+    return sum;
+}
+
+cml_matrix_i8 cml_matrix_i8_quantize(matrix m) {
+    cml_matrix_i8 ret;
+    ret.rows = m.rows;
+    ret.cols = m.cols;
+    ret.values = malloc((size_t)m.rows * m.cols + 1);
+    ret.scales = malloc(m.rows * sizeof(float) + 1);
+
+    for (cml_u32 r = 0; r < m.rows; r++) {
+        ret.scales[r] = cml_quantize_i8(m.values[r], m.cols,
+                                        ret.values + (size_t)r * m.cols);
+    }
+    return ret;
+}
+
+matrix cml_matrix_i8_dequantize(const cml_matrix_i8* m) {
+    matrix ret = cml_matrix_allocate(m->rows, m->cols);
+
+    for (cml_u32 r = 0; r < m->rows; r++) {
+        const cml_i8* row = m->values + (size_t)r * m->cols;
+        for (cml_u32 c = 0; c < m->cols; c++) {
+            ret.values[r][c] = row[c] * m->scales[r];
+        }
+    }
+    return ret;
+}
+
+void cml_matrix_i8_free(cml_matrix_i8* m) {
+    free(m->values);
+    free(m->scales);
+    m->values = NULL;
+    m->scales = NULL;
+    m->rows = 0;
+    m->cols = 0;
+}
+
+static void cml_i8_mat_vec_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_quantized_mat_vec_job* job = arg;
+    const cml_matrix_i8* m = job->m;
+
+    for (cml_u32 r = begin; r < end; r++) {
+        job->y[r] = cml_i8_dot(m->values + (size_t)r * m->cols, job->qx,
+                               m->cols) *
+                    (m->scales[r] * job->x_scale);
+    }
+}
+
+void cml_matrix_i8_mat_vec(const cml_matrix_i8* m, const float* x, float* y) {
+    cml_i8* qx = malloc(m->cols + 1);
+
+    cml_quantized_mat_vec_job job;
+    job.m = m;
+    job.x = x;
+    job.y = y;
+    job.qx = qx;
+    job.x_scale = cml_quantize_i8(x, m->cols, qx);
+
+    if ((cml_u64)m->rows * m->cols < CML_PARALLEL_THRESHOLD) {
+        cml_i8_mat_vec_range(0, m->rows, &job);
+    } else {
+        cml_parallel_for(0, m->rows, 64, cml_i8_mat_vec_range, &job);
+    }
+
+    free(qx);
+}
+
+typedef struct {
+    const cml_matrix_i8* a;
+    const cml_i8* b;
+    const float* b_scales;
+    cml_u32 cols;
+    matrix out;
+} cml_i8_mult_job;
+
+static void cml_i8_mult_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_i8_mult_job* job = arg;
+    const cml_matrix_i8* a = job->a;
+    cml_u32 depth = a->cols;
+
+    // a block of quantized b columns stays in the cache for all rows
+    const cml_u32 block = 64;
+    for (cml_u32 j0 = 0; j0 < job->cols; j0 += block) {
+        cml_u32 j1 = j0 + block < job->cols ? j0 + block : job->cols;
+
+        for (cml_u32 r = begin; r < end; r++) {
+            const cml_i8* row = a->values + (size_t)r * depth;
+            for (cml_u32 j = j0; j < j1; j++) {
+                job->out.values[r][j] =
+                    cml_i8_dot(row, job->b + (size_t)j * depth, depth) *
+                    (a->scales[r] * job->b_scales[j]);
+            }
+        }
+    }
+}
+
+matrix cml_matrix_i8_mat_mult(const cml_matrix_i8* a, matrix b) {
+    assert(b.rows == a->cols);
+
+    cml_u32 depth = a->cols;
+    matrix ret = cml_matrix_allocate(a->rows, b.cols);
+
+    // the columns of b become contiguous 8 bit rows with own scales
+    cml_i8* quantized = malloc((size_t)b.cols * depth + 1);
+    float* scales = malloc(b.cols * sizeof(float) + 1);
+    float* column = malloc(depth * sizeof(float) + 1);
+
+    for (cml_u32 j = 0; j < b.cols; j++) {
+        for (cml_u32 p = 0; p < depth; p++) {
+            column[p] = b.values[p][j];
+        }
+        scales[j] = cml_quantize_i8(column, depth,
+                                    quantized + (size_t)j * depth);
+    }
+    free(column);
+
+    cml_i8_mult_job job;
+    job.a = a;
+    job.b = quantized;
+    job.b_scales = scales;
+    job.cols = b.cols;
+    job.out = ret;
+
+    if ((cml_u64)a->rows * b.cols * depth < CML_PARALLEL_THRESHOLD) {
+        cml_i8_mult_range(0, a->rows, &job);
+    } else {
+        cml_parallel_for(0, a->rows, 16, cml_i8_mult_range, &job);
+    }
+
+    free(quantized);
+    free(scales);
+    return ret;
+}
@@ -0,0 +1,107 @@
+#ifndef CML_QUANTIZED_INCLUDED
+#define CML_QUANTIZED_INCLUDED
+
+#include "internal/cml_core.h"
+#include "matrix.h"
+
+/*
+    Reduced precision storage for large read-mostly matrices
+    (embeddings, precomputed transfer data) whose products
+    are limited by memory bandwidth. Like matrix_factor.h,
+    (r, c) is row r, column c and the values are stored row
+    by row in one allocation.
+*/
+
+/*
+    IEEE 754 half precision (binary16) bits: 11 significant
+    bits, relative error below 2^-11, largest value 65504.
+*/
+typedef cml_u16 cml_half;
+
+/*
+    Rounds to the nearest half (ties to even). Values beyond
+    the half range become infinity, NaN stays NaN.
+*/
+cml_half cml_float_to_half(float value);
+
+float cml_half_to_float(cml_half value);
+
+void cml_float_to_half_array(const float* values, cml_u32 count,
+                             cml_half* out);
+
+/*
+    Converts 8 values at a time with F16C or SSE2.
+*/
+void cml_half_to_float_array(const cml_half* values, cml_u32 count,
+                             float* out);
+
+/*
+    Half precision matrix, half the memory of a matrix.
+*/
+typedef struct {
+    cml_u32 rows, cols;
+    cml_half* values;
+} cml_matrix_f16;
+
+/*
+    8 bit matrix, a quarter of the memory of a matrix. Row r
+    is values[r * cols + c] * scales[r] with the values in
+    -127 .. 127, so the absolute error of an element is at
+    most scales[r] / 2 = max |row r| / 254.
+*/
+typedef struct {
+    cml_u32 rows, cols;
+    cml_i8* values;
+    float* scales;
+} cml_matrix_i8;
+
+cml_matrix_f16 cml_matrix_f16_quantize(matrix m);
+
+matrix cml_matrix_f16_dequantize(const cml_matrix_f16* m);
+
+void cml_matrix_f16_free(cml_matrix_f16* m);
+
+/*
+    y = m * x with float accumulation, "x" has m->cols and
+    "y" m->rows elements. Large matrices run on the thread
+    pool.
+*/
+void cml_matrix_f16_mat_vec(const cml_matrix_f16* m, const float* x,
+                            float* y);
+
+/*
+    NOTE: b.rows has to be equal to a->cols.
+
+    Returns a * b with float accumulation. The rows of "a"
+    are widened 4 at a time next to a blocked kernel.
+*/
+matrix cml_matrix_f16_mat_mult(const cml_matrix_f16* a, matrix b);
+
+/*
+    Quantizes every row with its own scale, max |row| / 127.
+*/
+cml_matrix_i8 cml_matrix_i8_quantize(matrix m);
+
+matrix cml_matrix_i8_dequantize(const cml_matrix_i8* m);
+
+void cml_matrix_i8_free(cml_matrix_i8* m);
+
+/*
+    y = m * x. "x" is quantized to 8 bits with one scale,
+    max |x| / 127, and the products are accumulated in 32 bit
+    integers (16 at a time with SSE2). The result carries the
+    rounding of both operands, about max |x| / 254 *
+    sum |m[r][c]| + scales[r] / 2 * sum |x[c]| per element.
+*/
+void cml_matrix_i8_mat_vec(const cml_matrix_i8* m, const float* x, float* y);
+
+/*
+    NOTE: b.rows has to be equal to a->cols.
+
+    Returns a * b. Every column of "b" is quantized to 8 bits
+    with its own scale and the dot products are accumulated
+    in 32 bit integers like in cml_matrix_i8_mat_vec().
+*/
+matrix cml_matrix_i8_mat_mult(const cml_matrix_i8* a, matrix b);
+
+#endif  // CML_QUANTIZED_INCLUDED
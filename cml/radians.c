@@ -1,5 +1,5 @@
 #include "radians.h"
 
-float cml_radians(float degrees) {
-    return (float)(degrees * 0.01745329251994329576923690768489);
-}
\ No newline at end of file
+#ifndef CML_STATIC_INLINE
+#include "internal/cml_radians_inline.h"
+#endif
@@ -3,6 +3,10 @@
 
 #include "internal/cml_core.h"
 
-float cml_radians(float degrees);
+CML_INLINE float cml_radians(float degrees);
 
-#endif  // CML_RAD_INCLUDED
\ No newline at end of file
+#ifdef CML_STATIC_INLINE
+#include "internal/cml_radians_inline.h"
+#endif
+
+#endif  // CML_RADIANS_INCLUDED
@@ -0,0 +1,368 @@
+#include "reduce.h"
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+/*
+    Number of values that are summed directly in lanes
+    before the pairwise combination takes over. Must be
+    a multiple of CML_REDUCE_LANES.
+*/
+#define CML_REDUCE_BLOCK 256
+
+typedef float (*cml_reduce_kernel)(const float* v1, const float* v2,
+                                   cml_u32 count);
+
+static float cml_reduce_combine_lanes(float* acc) {
+    for (cml_u32 width = CML_REDUCE_LANES / 2; width > 0; width /= 2) {
+        for (cml_u32 l = 0; l < width; l++) {
+            acc[l] += acc[l + width];
+        }
+    }
+    return acc[0];
+}
+
+static float cml_reduce_combine_lanes_kahan(float* sum, float* comp) {
+    float ret = 0.0f;
+    float c = 0.0f;
+
+    for (cml_u32 l = 0; l < CML_REDUCE_LANES; l++) {
+        float y = (sum[l] - comp[l]) - c;
+        float t = ret + y;
+        c = (t - ret) - y;
+        ret = t;
+    }
+    return ret;
+}
+
+/*
+    Defines the lane kernels "cml_reduce_<name>_lanes" and
+    "cml_reduce_<name>_kahan" for a term "TERM(i)" that is
+    evaluated per index.
+*/
+#define CML_REDUCE_DEFINE_KERNELS(name, TERM)                                \
+    static float cml_reduce_##name##_lanes(const float* v1, const float* v2, \
+                                           cml_u32 count) {                  \
+        float acc[CML_REDUCE_LANES] = {0.0f};                                \
+        cml_u32 i = 0;                                                       \
+        (void)v2;                                                            \
+                                                                             \
+        for (; i + CML_REDUCE_LANES <= count; i += CML_REDUCE_LANES) {       \
+            for (cml_u32 l = 0; l < CML_REDUCE_LANES; l++) {                 \
+                acc[l] += TERM(i + l);                                       \
+            }                                                                \
+        }                                                                    \
+        for (cml_u32 l = 0; i < count; i++, l++) {                           \
+            acc[l] += TERM(i);                                               \
+        }                                                                    \
+        return cml_reduce_combine_lanes(acc);                                \
+    }                                                                        \
+                                                                             \
+    static float cml_reduce_##name##_kahan(const float* v1, const float* v2, \
+                                           cml_u32 count) {                  \
+        float sum[CML_REDUCE_LANES] = {0.0f};                                \
+        float comp[CML_REDUCE_LANES] = {0.0f};                               \
+        cml_u32 i = 0;                                                       \
+        (void)v2;                                                            \
+                                                                             \
+        for (; i + CML_REDUCE_LANES <= count; i += CML_REDUCE_LANES) {       \
+            for (cml_u32 l = 0; l < CML_REDUCE_LANES; l++) {                 \
+                float y = TERM(i + l) - comp[l];                             \
+                float t = sum[l] + y;                                        \
+                comp[l] = (t - sum[l]) - y;                                  \
+                sum[l] = t;                                                  \
+            }                                                                \
+        }                                                                    \
+        for (cml_u32 l = 0; i < count; i++, l++) {                           \
+            float y = TERM(i) - comp[l];                                     \
+            float t = sum[l] + y;                                            \
+            comp[l] = (t - sum[l]) - y;                                      \
+            sum[l] = t;                                                      \
+        }                                                                    \
+        return cml_reduce_combine_lanes_kahan(sum, comp);                    \
+    }
+
+#define CML_REDUCE_TERM_SUM(i) (v1[i])
+#define CML_REDUCE_TERM_SUM_ABS(i) (fabsf(v1[i]))
+#define CML_REDUCE_TERM_SUM_SQUARES(i) (v1[i] * v1[i])
+#define CML_REDUCE_TERM_DOT(i) (v1[i] * v2[i])
+#define CML_REDUCE_TERM_DISTANCE_SQUARED(i) \
+    ((v1[i] - v2[i]) * (v1[i] - v2[i]))
+
+CML_REDUCE_DEFINE_KERNELS(sum, CML_REDUCE_TERM_SUM)
+CML_REDUCE_DEFINE_KERNELS(sum_abs, CML_REDUCE_TERM_SUM_ABS)
+CML_REDUCE_DEFINE_KERNELS(sum_squares, CML_REDUCE_TERM_SUM_SQUARES)
+CML_REDUCE_DEFINE_KERNELS(dot, CML_REDUCE_TERM_DOT)
+CML_REDUCE_DEFINE_KERNELS(distance_squared, CML_REDUCE_TERM_DISTANCE_SQUARED)
+
+static float cml_reduce_pairwise(cml_reduce_kernel kernel, const float* v1,
+                                 const float* v2, cml_u32 count) {
+    if (count <= CML_REDUCE_BLOCK) {
+        return kernel(v1, v2, count);
+    }
+
+    // split at a block boundary so every leaf is a full lane kernel
+    cml_u32 half = (count / 2 + CML_REDUCE_BLOCK - 1) / CML_REDUCE_BLOCK *
+                   CML_REDUCE_BLOCK;
+
+    float left = cml_reduce_pairwise(kernel, v1, v2, half);
+    float right = cml_reduce_pairwise(kernel, v1 + half,
+                                      v2 ? v2 + half : v2, count - half);
+    return left + right;
+}
+
+float cml_reduce_sum(const float* values, cml_u32 count, cml_reduce_mode mode) {
+    if (mode == CML_REDUCE_KAHAN) {
+        return cml_reduce_sum_kahan(values, NULL, count);
+    }
+    return cml_reduce_pairwise(cml_reduce_sum_lanes, values, NULL, count);
+}
+
+float cml_reduce_sum_abs(const float* values, cml_u32 count,
+                         cml_reduce_mode mode) {
+    if (mode == CML_REDUCE_KAHAN) {
+        return cml_reduce_sum_abs_kahan(values, NULL, count);
+    }
+    return cml_reduce_pairwise(cml_reduce_sum_abs_lanes, values, NULL, count);
+}
+
+float cml_reduce_sum_squares(const float* values, cml_u32 count,
+                             cml_reduce_mode mode) {
+    if (mode == CML_REDUCE_KAHAN) {
+        return cml_reduce_sum_squares_kahan(values, NULL, count);
+    }
+    return cml_reduce_pairwise(cml_reduce_sum_squares_lanes, values, NULL,
+                               count);
+}
+
+float cml_reduce_dot(const float* v1, const float* v2, cml_u32 count,
+                     cml_reduce_mode mode) {
+    if (mode == CML_REDUCE_KAHAN) {
+        return cml_reduce_dot_kahan(v1, v2, count);
+    }
+    return cml_reduce_pairwise(cml_reduce_dot_lanes, v1, v2, count);
+}
+
+float cml_reduce_distance_squared(const float* v1, const float* v2,
+                                  cml_u32 count, cml_reduce_mode mode) {
+    if (mode == CML_REDUCE_KAHAN) {
+        return cml_reduce_distance_squared_kahan(v1, v2, count);
+    }
+    return cml_reduce_pairwise(cml_reduce_distance_squared_lanes, v1, v2,
+                               count);
+}
+
+float cml_reduce_min(const float* values, cml_u32 count) {
+    assert(count > 0);
+
+    float acc[CML_REDUCE_LANES];
+    for (cml_u32 l = 0; l < CML_REDUCE_LANES; l++) {
+        acc[l] = values[0];
+    }
+
+    cml_u32 i = 0;
+    for (; i + CML_REDUCE_LANES <= count; i += CML_REDUCE_LANES) {
+        for (cml_u32 l = 0; l < CML_REDUCE_LANES; l++) {
+            acc[l] = values[i + l] < acc[l] ? values[i + l] : acc[l];
+        }
+    }
+    for (cml_u32 l = 0; i < count; i++, l++) {
+        acc[l] = values[i] < acc[l] ? values[i] : acc[l];
+    }
+
+    float ret = acc[0];
+    for (cml_u32 l = 1; l < CML_REDUCE_LANES; l++) {
+        ret = acc[l] < ret ? acc[l] : ret;
+    }
+    return ret;
+}
+
+float cml_reduce_max(const float* values, cml_u32 count) {
+    assert(count > 0);
+
+    float acc[CML_REDUCE_LANES];
+    for (cml_u32 l = 0; l < CML_REDUCE_LANES; l++) {
+        acc[l] = values[0];
+    }
+
+    cml_u32 i = 0;
+    for (; i + CML_REDUCE_LANES <= count; i += CML_REDUCE_LANES) {
+        for (cml_u32 l = 0; l < CML_REDUCE_LANES; l++) {
+            acc[l] = values[i + l] > acc[l] ? values[i + l] : acc[l];
+        }
+    }
+    for (cml_u32 l = 0; i < count; i++, l++) {
+        acc[l] = values[i] > acc[l] ? values[i] : acc[l];
+    }
+
+    float ret = acc[0];
+    for (cml_u32 l = 1; l < CML_REDUCE_LANES; l++) {
+        ret = acc[l] > ret ? acc[l] : ret;
+    }
+    return ret;
+}
+
+float cml_reduce_max_abs(const float* values, cml_u32 count) {
+    assert(count > 0);
+
+    float acc[CML_REDUCE_LANES] = {0.0f};
+
+    cml_u32 i = 0;
+    for (; i + CML_REDUCE_LANES <= count; i += CML_REDUCE_LANES) {
+        for (cml_u32 l = 0; l < CML_REDUCE_LANES; l++) {
+            float a = fabsf(values[i + l]);
+            acc[l] = a > acc[l] ? a : acc[l];
+        }
+    }
+    for (cml_u32 l = 0; i < count; i++, l++) {
+        float a = fabsf(values[i]);
+        acc[l] = a > acc[l] ? a : acc[l];
+    }
+
+    float ret = acc[0];
+    for (cml_u32 l = 1; l < CML_REDUCE_LANES; l++) {
+        ret = acc[l] > ret ? acc[l] : ret;
+    }
+    return ret;
+}
+
+cml_u32 cml_reduce_argmin(const float* values, cml_u32 count) {
+    assert(count > 0);
+
+    float best[CML_REDUCE_LANES];
+    cml_u32 index[CML_REDUCE_LANES];
+    for (cml_u32 l = 0; l < CML_REDUCE_LANES; l++) {
+        best[l] = values[0];
+        index[l] = 0;
+    }
+
+    // indices grow within a lane, so a strict compare keeps the first one
+    cml_u32 i = 0;
+    for (; i + CML_REDUCE_LANES <= count; i += CML_REDUCE_LANES) {
+        for (cml_u32 l = 0; l < CML_REDUCE_LANES; l++) {
+            BOOL smaller = values[i + l] < best[l];
+            best[l] = smaller ? values[i + l] : best[l];
+            index[l] = smaller ? i + l : index[l];
+        }
+    }
+    for (cml_u32 l = 0; i < count; i++, l++) {
+        if (values[i] < best[l]) {
+            best[l] = values[i];
+            index[l] = i;
+        }
+    }
+
+    cml_u32 ret = 0;
+    for (cml_u32 l = 1; l < CML_REDUCE_LANES; l++) {
+        if (best[l] < best[ret] ||
+            (best[l] == best[ret] && index[l] < index[ret])) {
+            ret = l;
+        }
+    }
+    return index[ret];
+}
+
+cml_u32 cml_reduce_argmax(const float* values, cml_u32 count) {
+    assert(count > 0);
+
+    float best[CML_REDUCE_LANES];
+    cml_u32 index[CML_REDUCE_LANES];
+    for (cml_u32 l = 0; l < CML_REDUCE_LANES; l++) {
+        best[l] = values[0];
+        index[l] = 0;
+    }
+
+    cml_u32 i = 0;
+    for (; i + CML_REDUCE_LANES <= count; i += CML_REDUCE_LANES) {
+        for (cml_u32 l = 0; l < CML_REDUCE_LANES; l++) {
+            BOOL larger = values[i + l] > best[l];
+            best[l] = larger ? values[i + l] : best[l];
+            index[l] = larger ? i + l : index[l];
+        }
+    }
+    for (cml_u32 l = 0; i < count; i++, l++) {
+        if (values[i] > best[l]) {
+            best[l] = values[i];
+            index[l] = i;
+        }
+    }
+
+    cml_u32 ret = 0;
+    for (cml_u32 l = 1; l < CML_REDUCE_LANES; l++) {
+        if (best[l] > best[ret] ||
+            (best[l] == best[ret] && index[l] < index[ret])) {
+            ret = l;
+        }
+    }
+    return index[ret];
+}
+
+float cml_vector_sum(vector v) {
+    return cml_reduce_sum(v.values, v.dimension, CML_REDUCE_PAIRWISE);
+}
+
+float cml_vector_mean(vector v) {
+    assert(v.dimension > 0);
+
+    return cml_vector_sum(v) / (float)v.dimension;
+}
+
+float cml_vector_min(vector v) {
+    return cml_reduce_min(v.values, v.dimension);
+}
+
+float cml_vector_max(vector v) {
+    return cml_reduce_max(v.values, v.dimension);
+}
+
+cml_u32 cml_vector_argmin(vector v) {
+    return cml_reduce_argmin(v.values, v.dimension);
+}
+
+cml_u32 cml_vector_argmax(vector v) {
+    return cml_reduce_argmax(v.values, v.dimension);
+}
+
+float cml_vector_norm_l1(vector v) {
+    return cml_reduce_sum_abs(v.values, v.dimension, CML_REDUCE_PAIRWISE);
+}
+
+float cml_vector_norm_l2(vector v) {
+    float sum = cml_reduce_sum_squares(v.values, v.dimension,
+                                       CML_REDUCE_PAIRWISE);
+
+    if (sum >= FLT_MIN && sum <= FLT_MAX) {
+        return sqrtf(sum);
+    }
+
+    // squares left the float range, sum (x / max|x|)^2 instead
+    float scale = cml_vector_norm_linf(v);
+    if (scale == 0.0f || isinf(scale)) {
+        return scale;
+    }
+
+    float inv = 1.0f / scale;
+    float acc[CML_REDUCE_LANES] = {0.0f};
+
+    cml_u32 i = 0;
+    for (; i + CML_REDUCE_LANES <= v.dimension; i += CML_REDUCE_LANES) {
+        for (cml_u32 l = 0; l < CML_REDUCE_LANES; l++) {
+            float x = v.values[i + l] * inv;
+            acc[l] += x * x;
+        }
+    }
+    for (cml_u32 l = 0; i < v.dimension; i++, l++) {
+        float x = v.values[i] * inv;
+        acc[l] += x * x;
+    }
+
+    return scale * sqrtf(cml_reduce_combine_lanes(acc));
+}
+
+float cml_vector_norm_linf(vector v) {
+    if (v.dimension == 0) {
+        return 0.0f;
+    }
+    return cml_reduce_max_abs(v.values, v.dimension);
+}
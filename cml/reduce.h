@@ -0,0 +1,139 @@
+#ifndef CML_REDUCE_INCLUDED
+#define CML_REDUCE_INCLUDED
+
+#include "internal/cml_core.h"
+
+/*
+    Selects how the sum based reductions compensate
+    rounding errors.
+
+    CML_REDUCE_PAIRWISE: Blocks of the input are summed in
+    independent lanes and the block results are combined
+    pairwise. The error grows with O(log n) instead of O(n).
+
+    CML_REDUCE_KAHAN: Every lane carries a Kahan compensation
+    term. The error is practically independent of n, at the
+    cost of roughly four times the floating point operations.
+
+    NOTE: Compiling with -ffast-math (or /fp:fast) allows the
+          compiler to optimize the compensation away.
+*/
+typedef enum {
+    CML_REDUCE_PAIRWISE = 0,
+    CML_REDUCE_KAHAN
+} cml_reduce_mode;
+
+/*
+    Number of independent accumulators the reductions use.
+    The lanes break the dependency chain of a serial sum and
+    map onto the SIMD registers of the target.
+*/
+#define CML_REDUCE_LANES 8
+
+/*
+    Returns the sum of the first "count" values of the
+    given array.
+*/
+float cml_reduce_sum(const float* values, cml_u32 count, cml_reduce_mode mode);
+
+/*
+    Returns the sum of the absolute values of the first
+    "count" values of the given array.
+*/
+float cml_reduce_sum_abs(const float* values, cml_u32 count,
+                         cml_reduce_mode mode);
+
+/*
+    Returns the sum of the squares of the first "count"
+    values of the given array.
+*/
+float cml_reduce_sum_squares(const float* values, cml_u32 count,
+                             cml_reduce_mode mode);
+
+/*
+    Returns the dot product of the first "count" values
+    of the two given arrays.
+*/
+float cml_reduce_dot(const float* v1, const float* v2, cml_u32 count,
+                     cml_reduce_mode mode);
+
+/*
+    Returns the squared euclidean distance between the first
+    "count" values of the two given arrays.
+*/
+float cml_reduce_distance_squared(const float* v1, const float* v2,
+                                  cml_u32 count, cml_reduce_mode mode);
+
+/*
+    NOTE: The following functions require count > 0.
+
+    Returns the smallest / largest value of the given array.
+*/
+float cml_reduce_min(const float* values, cml_u32 count);
+
+float cml_reduce_max(const float* values, cml_u32 count);
+
+/*
+    Returns the largest absolute value of the given array.
+*/
+float cml_reduce_max_abs(const float* values, cml_u32 count);
+
+/*
+    Returns the index of the smallest / largest value of the
+    given array. If the value occurs more than once the first
+    index is returned.
+*/
+cml_u32 cml_reduce_argmin(const float* values, cml_u32 count);
+
+cml_u32 cml_reduce_argmax(const float* values, cml_u32 count);
+
+// below the array functions, which the CML_STATIC_INLINE
+// definitions of vector.h call
+#include "vector.h"
+
+/*
+    Returns the sum of all values of the given vector "v".
+*/
+float cml_vector_sum(vector v);
+
+/*
+    Returns the arithmetic mean of all values of the
+    given vector "v".
+*/
+float cml_vector_mean(vector v);
+
+/*
+    Returns the smallest / largest value of the given vector "v".
+*/
+float cml_vector_min(vector v);
+
+float cml_vector_max(vector v);
+
+/*
+    Returns the index of the smallest / largest value of
+    the given vector "v".
+*/
+cml_u32 cml_vector_argmin(vector v);
+
+cml_u32 cml_vector_argmax(vector v);
+
+/*
+    Returns the L1 norm (sum of absolute values) of the
+    given vector "v".
+*/
+float cml_vector_norm_l1(vector v);
+
+/*
+    Returns the L2 (euclidean) norm of the given vector "v".
+    Unlike cml_vector_magnitude() this function rescales the
+    values if the squared sum would overflow or underflow.
+*/
+float cml_vector_norm_l2(vector v);
+
+/*
+    Returns the infinity norm (largest absolute value) of
+    the given vector "v".
+*/
+float cml_vector_norm_linf(vector v);
+
+#endif  // CML_REDUCE_INCLUDED
@@ -0,0 +1,145 @@
+#include "skinning.h"
+
+#include <assert.h>
+
+#include "internal/cml_simd.h"
+#include "parallel.h"
+#include "vector.h"
+
+typedef struct {
+    const cml_affine* palette;
+    cml_u32 palette_size;
+    const float* positions;
+    const float* normals;
+    const cml_u16* indices;
+    const float* weights;
+    float* out_positions;
+    float* out_normals;
+} cml_skin_job;
+
+static void cml_skin_blend(const cml_skin_job* job, cml_u32 vertex,
+                           cml_affine* out) {
+    const cml_u16* indices = job->indices + vertex * CML_SKIN_MAX_INFLUENCES;
+    const float* weights = job->weights + vertex * CML_SKIN_MAX_INFLUENCES;
+
+#ifdef CML_SIMD_SSE
+    __m128 rows[3] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+
+    for (cml_u32 k = 0; k < CML_SKIN_MAX_INFLUENCES; k++) {
+        assert(indices[k] < job->palette_size);
+
+        const cml_affine* bone = job->palette + indices[k];
+        __m128 w = _mm_set1_ps(weights[k]);
+
+        for (cml_u32 r = 0; r < 3; r++) {
+            rows[r] =
+                _mm_add_ps(rows[r], _mm_mul_ps(w, _mm_loadu_ps(bone->m[r])));
+        }
+    }
+    for (cml_u32 r = 0; r < 3; r++) {
+        _mm_storeu_ps(out->m[r], rows[r]);
+    }
+#else
+    for (cml_u32 r = 0; r < 3; r++) {
+        for (cml_u32 c = 0; c < 4; c++) {
+            out->m[r][c] = 0.0f;
+        }
+    }
+
+    for (cml_u32 k = 0; k < CML_SKIN_MAX_INFLUENCES; k++) {
+        assert(indices[k] < job->palette_size);
+
+        const cml_affine* bone = job->palette + indices[k];
+        for (cml_u32 r = 0; r < 3; r++) {
+            for (cml_u32 c = 0; c < 4; c++) {
+                out->m[r][c] += weights[k] * bone->m[r][c];
+            }
+        }
+    }
+#endif
+}
+
+static void cml_skin_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_skin_job* job = arg;
+    BOOL normals = job->normals && job->out_normals;
+    cml_u32 i = begin;
+
+#ifdef CML_SIMD_SSE
+    for (; i + 4 <= end; i += 4) {
+        cml_affine blended[4];
+        for (cml_u32 v = 0; v < 4; v++) {
+            cml_skin_blend(job, i + v, blended + v);
+        }
+
+        // column c of row r for the 4 vertices
+        __m128 m[3][4];
+        for (cml_u32 r = 0; r < 3; r++) {
+            m[r][0] = _mm_loadu_ps(blended[0].m[r]);
+            m[r][1] = _mm_loadu_ps(blended[1].m[r]);
+            m[r][2] = _mm_loadu_ps(blended[2].m[r]);
+            m[r][3] = _mm_loadu_ps(blended[3].m[r]);
+            _MM_TRANSPOSE4_PS(m[r][0], m[r][1], m[r][2], m[r][3]);
+        }
+
+        __m128 x, y, z, out[3];
+        cml_simd_load_xyz4(job->positions + 3 * i, &x, &y, &z);
+        for (cml_u32 r = 0; r < 3; r++) {
+            out[r] = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(m[r][0], x), _mm_mul_ps(m[r][1], y)),
+                _mm_add_ps(_mm_mul_ps(m[r][2], z), m[r][3]));
+        }
+        cml_simd_store_xyz4(job->out_positions + 3 * i, out[0], out[1],
+                            out[2]);
+
+        if (normals) {
+            cml_simd_load_xyz4(job->normals + 3 * i, &x, &y, &z);
+            for (cml_u32 r = 0; r < 3; r++) {
+                out[r] = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(m[r][0], x), _mm_mul_ps(m[r][1], y)),
+                    _mm_mul_ps(m[r][2], z));
+            }
+            cml_simd_store_xyz4(job->out_normals + 3 * i, out[0], out[1],
+                                out[2]);
+        }
+    }
+#endif
+
+    for (; i < end; i++) {
+        cml_affine blended;
+        cml_skin_blend(job, i, &blended);
+
+        cml_affine_apply_point(&blended, job->positions + 3 * i,
+                               job->out_positions + 3 * i);
+        if (normals) {
+            cml_affine_apply_vector(&blended, job->normals + 3 * i,
+                                    job->out_normals + 3 * i);
+        }
+    }
+
+    if (normals) {
+        cml_vec3_normalize_batch(job->out_normals + 3 * begin, end - begin,
+                                 CML_NORMALIZE_FAST);
+    }
+}
+
+void cml_skin_vertices(const cml_affine* palette, cml_u32 palette_size,
+                       const float* positions, const float* normals,
+                       const cml_u16* indices, const float* weights,
+                       cml_u32 count, float* out_positions,
+                       float* out_normals) {
+    cml_skin_job job;
+    job.palette = palette;
+    job.palette_size = palette_size;
+    job.positions = positions;
+    job.normals = normals;
+    job.indices = indices;
+    job.weights = weights;
+    job.out_positions = out_positions;
+    job.out_normals = out_normals;
+
+    if (count < CML_SKIN_PARALLEL_VERTICES) {
+        cml_skin_range(0, count, &job);
+        return;
+    }
+    cml_parallel_for(0, count, 1024, cml_skin_range, &job);
+}
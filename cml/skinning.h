@@ -0,0 +1,50 @@
+#ifndef CML_SKINNING_INCLUDED
+#define CML_SKINNING_INCLUDED
+
+#include "affine.h"
+#include "internal/cml_core.h"
+
+/*
+    Number of bones that can influence one vertex.
+*/
+#define CML_SKIN_MAX_INFLUENCES 4
+
+/*
+    Linear blend skinning. Every vertex i is transformed by
+
+        sum(weights[4 * i + k] * palette[indices[4 * i + k]])
+
+    over k < CML_SKIN_MAX_INFLUENCES. Vertices with fewer
+    influences use a weight of zero for the unused slots,
+    the weights of a vertex should sum up to one.
+
+    The palette holds the skinning matrices (usually bone
+    transform * inverse bind pose) as 3x4 affine transforms,
+    4x4 matrices can be converted with cml_affine_from_matrix().
+
+    "positions" / "out_positions" and "normals" /
+    "out_normals" are interleaved xyz arrays. "normals" and
+    "out_normals" may be NULL to skip the normals. Normals
+    are transformed by the blended linear part and
+    renormalized, which is exact for bones without
+    non-uniform scale.
+
+    The blended matrices are applied to 4 vertices at a time
+    with SSE. Meshes from CML_SKIN_PARALLEL_VERTICES vertices
+    on are skinned in chunks on the thread pool.
+*/
+void cml_skin_vertices(const cml_affine* palette, cml_u32 palette_size,
+                       const float* positions, const float* normals,
+                       const cml_u16* indices, const float* weights,
+                       cml_u32 count, float* out_positions,
+                       float* out_normals);
+
+/*
+    Vertex count from which cml_skin_vertices() runs on the
+    thread pool. Can be overridden at compile time.
+*/
+#ifndef CML_SKIN_PARALLEL_VERTICES
+#define CML_SKIN_PARALLEL_VERTICES 4096
+#endif
+
+#endif  // CML_SKINNING_INCLUDED
@@ -0,0 +1,149 @@
+#include "sparse.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "parallel.h"
+
+typedef struct {
+    cml_u32 col;
+    float value;
+} cml_sparse_entry;
+
+static int cml_sparse_entry_compare(const void* a, const void* b) {
+    cml_u32 ca = ((const cml_sparse_entry*)a)->col;
+    cml_u32 cb = ((const cml_sparse_entry*)b)->col;
+    return (ca > cb) - (ca < cb);
+}
+
+cml_sparse cml_sparse_from_triplets(cml_u32 rows, cml_u32 cols,
+                                    cml_u32 count, const cml_u32* row_indices,
+                                    const cml_u32* col_indices,
+                                    const float* values) {
+    cml_sparse ret;
+    ret.rows = rows;
+    ret.cols = cols;
+    ret.row_offsets = calloc(rows + 1, sizeof(cml_u32));
+
+    // counting sort of the triplets by row
+    for (cml_u32 i = 0; i < count; i++) {
+        assert(row_indices[i] < rows && col_indices[i] < cols);
+        ret.row_offsets[row_indices[i] + 1]++;
+    }
+    for (cml_u32 r = 0; r < rows; r++) {
+        ret.row_offsets[r + 1] += ret.row_offsets[r];
+    }
+
+    cml_sparse_entry* entries = malloc(count * sizeof(cml_sparse_entry));
+    cml_u32* next = malloc(rows * sizeof(cml_u32));
+    for (cml_u32 r = 0; r < rows; r++) {
+        next[r] = ret.row_offsets[r];
+    }
+    for (cml_u32 i = 0; i < count; i++) {
+        cml_sparse_entry* e = entries + next[row_indices[i]]++;
+        e->col = col_indices[i];
+        e->value = values[i];
+    }
+    free(next);
+
+    // sort every row by column and merge duplicates
+    cml_u32 nnz = 0;
+    for (cml_u32 r = 0; r < rows; r++) {
+        cml_u32 begin = ret.row_offsets[r];
+        cml_u32 end = ret.row_offsets[r + 1];
+
+        qsort(entries + begin, end - begin, sizeof(cml_sparse_entry),
+              cml_sparse_entry_compare);
+
+        ret.row_offsets[r] = nnz;
+        for (cml_u32 i = begin; i < end; i++) {
+            if (nnz > ret.row_offsets[r] &&
+                entries[nnz - 1].col == entries[i].col) {
+                entries[nnz - 1].value += entries[i].value;
+            } else {
+                entries[nnz++] = entries[i];
+            }
+        }
+    }
+    ret.row_offsets[rows] = nnz;
+    ret.nnz = nnz;
+
+    ret.col_indices = malloc(nnz * sizeof(cml_u32));
+    ret.values = malloc(nnz * sizeof(float));
+    for (cml_u32 i = 0; i < nnz; i++) {
+        ret.col_indices[i] = entries[i].col;
+        ret.values[i] = entries[i].value;
+    }
+    free(entries);
+    return ret;
+}
+
+void cml_sparse_free(cml_sparse* a) {
+    free(a->row_offsets);
+    free(a->col_indices);
+    free(a->values);
+    a->row_offsets = NULL;
+    a->col_indices = NULL;
+    a->values = NULL;
+    a->nnz = 0;
+}
+
+float cml_sparse_get(const cml_sparse* a, cml_u32 row, cml_u32 col) {
+    assert(row < a->rows && col < a->cols);
+
+    // binary search in the sorted columns of the row
+    cml_u32 lo = a->row_offsets[row];
+    cml_u32 hi = a->row_offsets[row + 1];
+    while (lo < hi) {
+        cml_u32 mid = lo + (hi - lo) / 2;
+        if (a->col_indices[mid] < col) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < a->row_offsets[row + 1] && a->col_indices[lo] == col) {
+        return a->values[lo];
+    }
+    return 0.0f;
+}
+
+void cml_sparse_diagonal(const cml_sparse* a, float* out) {
+    cml_u32 n = a->rows < a->cols ? a->rows : a->cols;
+
+    for (cml_u32 i = 0; i < n; i++) {
+        out[i] = cml_sparse_get(a, i, i);
+    }
+}
+
+typedef struct {
+    const cml_sparse* a;
+    const float* x;
+    float* y;
+} cml_sparse_job;
+
+static void cml_sparse_mat_vec_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_sparse_job* job = arg;
+    const cml_sparse* a = job->a;
+
+    for (cml_u32 r = begin; r < end; r++) {
+        float sum = 0.0f;
+        for (cml_u32 i = a->row_offsets[r]; i < a->row_offsets[r + 1]; i++) {
+            sum += a->values[i] * job->x[a->col_indices[i]];
+        }
+        job->y[r] = sum;
+    }
+}
+
+void cml_sparse_mat_vec(const cml_sparse* a, const float* x, float* y) {
+    cml_sparse_job job;
+    job.a = a;
+    job.x = x;
+    job.y = y;
+
+    if (a->nnz < CML_PARALLEL_THRESHOLD) {
+        cml_sparse_mat_vec_range(0, a->rows, &job);
+        return;
+    }
+    cml_parallel_for(0, a->rows, 4096, cml_sparse_mat_vec_range, &job);
+}
@@ -0,0 +1,50 @@
+#ifndef CML_SPARSE_INCLUDED
+#define CML_SPARSE_INCLUDED
+
+#include "internal/cml_core.h"
+
+/*
+    Sparse matrix in compressed sparse row (CSR) format. The
+    entries of row r are values[row_offsets[r]] up to (not
+    including) values[row_offsets[r + 1]], sorted by their
+    column in col_indices. Memory is O(rows + nnz).
+*/
+typedef struct {
+    cml_u32 rows, cols;
+    cml_u32 nnz;
+    cml_u32* row_offsets;
+    cml_u32* col_indices;
+    float* values;
+} cml_sparse;
+
+/*
+    Builds a CSR matrix from "count" (row, column, value)
+    triplets in any order. Duplicate entries are summed,
+    which is how finite element / cloth stiffness matrices
+    are usually assembled.
+*/
+cml_sparse cml_sparse_from_triplets(cml_u32 rows, cml_u32 cols,
+                                    cml_u32 count, const cml_u32* row_indices,
+                                    const cml_u32* col_indices,
+                                    const float* values);
+
+void cml_sparse_free(cml_sparse* a);
+
+/*
+    Returns a[row][col], 0 if the entry is not stored.
+*/
+float cml_sparse_get(const cml_sparse* a, cml_u32 row, cml_u32 col);
+
+/*
+    Writes the min(rows, cols) diagonal entries to "out".
+*/
+void cml_sparse_diagonal(const cml_sparse* a, float* out);
+
+/*
+    y = a * x with x of a.cols and y of a.rows entries.
+    Large matrices are split over the rows on the thread
+    pool.
+*/
+void cml_sparse_mat_vec(const cml_sparse* a, const float* x, float* y);
+
+#endif  // CML_SPARSE_INCLUDED
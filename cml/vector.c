@@ -5,14 +5,15 @@
 #include <stdlib.h>
 #include <string.h>
 
-vector cml_vector_allocate(cml_u32 dimension) {
-    vector ret;
-
-    ret.dimension = dimension;
-    ret.values = malloc(dimension * sizeof(float));
+#include "internal/cml_elementwise.h"
+#include "internal/cml_simd.h"
+#include "parallel.h"
+#include "reduce.h"
+#include "vmath.h"
 
-    return ret;
-}
+#ifndef CML_STATIC_INLINE
+#include "internal/cml_vector_inline.h"
+#endif
 
 vector cml_vector_default(cml_u32 dimension, float value) {
     vector ret = cml_vector_allocate(dimension);
@@ -87,65 +88,57 @@ BOOL cml_vector_compare(vector v1, vector v2) {
 vector cml_vector_scaler_mult(vector v, float scaler) {
     vector ret = cml_vector_allocate(v.dimension);
 
-    for (cml_u32 i = 0; i < ret.dimension; i++) {
-        ret.values[i] = v.values[i] * scaler;
-    }
+    cml_elementwise(ret.values, v.values, NULL, scaler, CML_OP_MULT_SCALER,
+                    ret.dimension);
 
     return ret;
 }
 
 void cml_vector_mult_by_scaler(vector* v, float scaler) {
-    for (cml_u32 i = 0; i < v->dimension; i++) {
-        v->values[i] *= scaler;
-    }
+    cml_elementwise(v->values, v->values, NULL, scaler, CML_OP_MULT_SCALER,
+                    v->dimension);
 }
 
 vector cml_vector_scaler_div(vector v, float scaler) {
     vector ret = cml_vector_allocate(v.dimension);
 
-    for (cml_u32 i = 0; i < ret.dimension; i++) {
-        ret.values[i] = v.values[i] / scaler;
-    }
+    cml_elementwise(ret.values, v.values, NULL, scaler, CML_OP_DIV_SCALER,
+                    ret.dimension);
 
     return ret;
 }
 
 void cml_vector_div_by_scaler(vector* v, float scaler) {
-    for (cml_u32 i = 0; i < v->dimension; i++) {
-        v->values[i] *= scaler;
-    }
+    cml_elementwise(v->values, v->values, NULL, scaler, CML_OP_DIV_SCALER,
+                    v->dimension);
 }
 
 vector cml_vector_scaler_addition(vector v, float scaler) {
     vector ret = cml_vector_allocate(v.dimension);
 
-    for (cml_u32 i = 0; i < ret.dimension; i++) {
-        ret.values[i] = v.values[i] + scaler;
-    }
+    cml_elementwise(ret.values, v.values, NULL, scaler, CML_OP_ADD_SCALER,
+                    ret.dimension);
 
     return ret;
 }
 
 void cml_vector_add_scaler(vector* v, float scaler) {
-    for (cml_u32 i = 0; i < v->dimension; i++) {
-        v->values[i] += scaler;
-    }
+    cml_elementwise(v->values, v->values, NULL, scaler, CML_OP_ADD_SCALER,
+                    v->dimension);
 }
 
 vector cml_vector_scaler_subst(vector v, float scaler) {
     vector ret = cml_vector_allocate(v.dimension);
 
-    for (cml_u32 i = 0; i < ret.dimension; i++) {
-        ret.values[i] = v.values[i] - scaler;
-    }
+    cml_elementwise(ret.values, v.values, NULL, scaler, CML_OP_SUBST_SCALER,
+                    ret.dimension);
 
     return ret;
 }
 
 void cml_vector_subst_scaler(vector* v, float scaler) {
-    for (cml_u32 i = 0; i < v->dimension; i++) {
-        v->values[i] -= scaler;
-    }
+    cml_elementwise(v->values, v->values, NULL, scaler, CML_OP_SUBST_SCALER,
+                    v->dimension);
 }
 
 vector cml_vec_vec_mult(vector v1, vector v2) {
@@ -153,18 +146,16 @@ vector cml_vec_vec_mult(vector v1, vector v2) {
 
     vector ret = cml_vector_allocate(v1.dimension);
 
-    for (cml_u32 i = 0; i < v1.dimension; i++) {
-        ret.values[i] = v1.values[i] * v2.values[i];
-    }
+    cml_elementwise(ret.values, v1.values, v2.values, 0.0f, CML_OP_MULT,
+                    v1.dimension);
     return ret;
 }
 
 void cml_vec_mult_with_vec(vector* v1, vector v2) {
     assert(v1->dimension == v2.dimension);
 
-    for (cml_u32 i = 0; i < v1->dimension; i++) {
-        v1->values[i] *= v2.values[i];
-    }
+    cml_elementwise(v1->values, v1->values, v2.values, 0.0f, CML_OP_MULT,
+                    v1->dimension);
 }
 
 vector cml_vec_vec_div(vector v1, vector v2) {
@@ -172,139 +163,161 @@ vector cml_vec_vec_div(vector v1, vector v2) {
 
     vector ret = cml_vector_allocate(v1.dimension);
 
-    for (cml_u32 i = 0; i < v1.dimension; i++) {
-        ret.values[i] = v1.values[i] / v2.values[i];
-    }
+    cml_elementwise(ret.values, v1.values, v2.values, 0.0f, CML_OP_DIV,
+                    v1.dimension);
     return ret;
 }
 
 void cml_vec_div_by_vec(vector* v1, vector v2) {
     assert(v1->dimension == v2.dimension);
 
-    for (cml_u32 i = 0; i < v1->dimension; i++) {
-        v1->values[i] /= v2.values[i];
-    }
+    cml_elementwise(v1->values, v1->values, v2.values, 0.0f, CML_OP_DIV,
+                    v1->dimension);
 }
 
-vector cml_vec_vec_add(vector v1, vector v2) {
+BOOL cml_vector_perpendicular(vector v1, vector v2) {
+    return (v1.dimension == v2.dimension) ? (cml_dot(v1, v2) == 0.0f) : FALSE;
+}
+
+vector cml_cross(vector v1, vector v2) {
     assert(v1.dimension == v2.dimension);
 
     vector ret = cml_vector_allocate(v1.dimension);
 
-    for (cml_u32 i = 0; i < v1.dimension; i++) {
-        ret.values[i] = v1.values[i] + v2.values[i];
-    }
+    ret.values[0] =
+        (v1.values[1] * v2.values[2]) - (v1.values[2] * v2.values[1]);
+    ret.values[1] =
+        -1 * ((v1.values[0] * v2.values[2]) - (v1.values[2] * v2.values[0]));
+    ret.values[2] =
+        (v1.values[0] * v2.values[1]) - (v1.values[1] * v2.values[0]);
     return ret;
 }
 
-void cml_vec_add_to_vec(vector* v1, vector v2) {
-    assert(v1->dimension == v2.dimension);
-
-    for (cml_u32 i = 0; i < v1->dimension; i++) {
-        v1->values[i] += v2.values[i];
+/*
+    Returns 1 / sqrt(x) for x > 0 and 0 otherwise. The fast
+    mode refines the hardware estimate with one Newton step.
+*/
+static float cml_inverse_sqrt(float x, cml_normalize_mode mode) {
+    if (!(x > 0.0f)) {
+        return 0.0f;
+    }
+#ifdef CML_SIMD_SSE
+    if (mode == CML_NORMALIZE_FAST) {
+        float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+        return y * (1.5f - 0.5f * x * y * y);
     }
+#else
+    (void)mode;
+#endif
+    return (float)(1.0 / sqrt(x));
 }
 
-vector cml_vec_vec_subst(vector v1, vector v2) {
-    assert(v1.dimension == v2.dimension);
-
-    vector ret = cml_vector_allocate(v1.dimension);
-
-    for (cml_u32 i = 0; i < v1.dimension; i++) {
-        ret.values[i] = v1.values[i] - v2.values[i];
+static float cml_vector_inverse_magnitude(vector v, cml_normalize_mode mode) {
+    if (mode == CML_NORMALIZE_FAST) {
+        return cml_inverse_sqrt(cml_vector_magnitude_squared(v), mode);
     }
-    return ret;
+
+    // norm_l2 takes a single pass unless the squares leave the float range
+    float mag = cml_vector_norm_l2(v);
+    return mag > 0.0f ? 1.0f / mag : 0.0f;
 }
 
-void cml_subst_vec_from_vec(vector* v1, vector v2) {
-    assert(v1->dimension == v2.dimension);
+vector cml_vector_normalized(vector v) {
+    vector ret = cml_vector_allocate(v.dimension);
 
-    for (cml_u32 i = 0; i < v1->dimension; i++) {
-        v1->values[i] -= v2.values[i];
-    }
+    cml_elementwise(ret.values, v.values, NULL,
+                    cml_vector_inverse_magnitude(v, CML_NORMALIZE_EXACT),
+                    CML_OP_MULT_SCALER, v.dimension);
+    return ret;
 }
 
-float cml_dot(vector v1, vector v2) {
-    assert(v1.dimension == v2.dimension);
+void cml_vector_normalize(vector* v) {
+    cml_vector_normalize_mode(v, CML_NORMALIZE_EXACT);
+}
 
-    float ret = 0.0f;
+void cml_vector_normalize_mode(vector* v, cml_normalize_mode mode) {
+    float inv = cml_vector_inverse_magnitude(*v, mode);
 
-    for (cml_u32 i = 0; i < v1.dimension; i++) {
-        ret += v1.values[i] * v2.values[i];
+    if (inv > 0.0f) {
+        cml_elementwise(v->values, v->values, NULL, inv, CML_OP_MULT_SCALER,
+                        v->dimension);
     }
-    return ret;
 }
 
-BOOL cml_vector_perpendicular(vector v1, vector v2) {
-    return (v1.dimension == v2.dimension) ? (cml_dot(v1, v2) == 0.0f) : FALSE;
-}
+typedef struct {
+    float* xyz;
+    cml_normalize_mode mode;
+} cml_vec3_normalize_job;
 
-vector cml_cross(vector v1, vector v2) {
-    assert(v1.dimension == v2.dimension);
+static void cml_vec3_normalize_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_vec3_normalize_job* job = arg;
+    cml_u32 i = begin;
 
-    vector ret = cml_vector_allocate(v1.dimension);
-
-    ret.values[0] =
-        (v1.values[1] * v2.values[2]) - (v1.values[2] * v2.values[1]);
-    ret.values[1] =
-        -1 * ((v1.values[0] * v2.values[2]) - (v1.values[2] * v2.values[0]));
-    ret.values[2] =
-        (v1.values[0] * v2.values[1]) - (v1.values[1] * v2.values[0]);
-    return ret;
-}
+#ifdef CML_SIMD_SSE
+    for (; i + 4 <= end; i += 4) {
+        float* p = job->xyz + 3 * i;
+        __m128 x, y, z;
+        cml_simd_load_xyz4(p, &x, &y, &z);
 
-float cml_vector_magnitude(vector v) {
-    return (float)sqrt(cml_vector_magnitude_squared(v));
-}
+        __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                                 _mm_mul_ps(z, z));
 
-float cml_vector_magnitude_squared(vector v) {
-    float ret = 0.0f;
+        __m128 inv;
+        if (job->mode == CML_NORMALIZE_FAST) {
+            __m128 r = _mm_rsqrt_ps(len2);
+            __m128 rr = _mm_mul_ps(_mm_mul_ps(len2, r), r);
+            inv = _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(1.5f),
+                                           _mm_mul_ps(_mm_set1_ps(0.5f), rr)));
+        } else {
+            inv = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(len2));
+        }
+        // zero length vectors stay zero
+        inv = _mm_and_ps(inv, _mm_cmpgt_ps(len2, _mm_setzero_ps()));
 
-    for (cml_u32 i = 0; i < v.dimension; i++) {
-        ret += v.values[i] * v.values[i];
+        cml_simd_store_xyz4(p, _mm_mul_ps(x, inv), _mm_mul_ps(y, inv),
+                            _mm_mul_ps(z, inv));
     }
+#endif
 
-    return ret;
-}
-
-vector cml_vector_normalized(vector v) {
-    vector ret = cml_vector_allocate(v.dimension);
+    for (; i < end; i++) {
+        float* p = job->xyz + 3 * i;
+        float len2 = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+        float inv = cml_inverse_sqrt(len2, job->mode);
 
-    for (cml_u32 i = 0; i < ret.dimension; i++) {
-        ret.values[i] = v.values[i] / cml_vector_magnitude(v);
+        p[0] *= inv;
+        p[1] *= inv;
+        p[2] *= inv;
     }
-    return ret;
 }
 
-void cml_vector_normalize(vector* v) {
-    float mag = cml_vector_magnitude(*v);
+void cml_vec3_normalize_batch(float* xyz, cml_u32 count,
+                              cml_normalize_mode mode) {
+    cml_vec3_normalize_job job;
+    job.xyz = xyz;
+    job.mode = mode;
 
-    for (cml_u32 i = 0; i < v->dimension; i++) {
-        v->values[i] /= mag;
+    if ((cml_u64)count * 3 < CML_PARALLEL_THRESHOLD) {
+        cml_vec3_normalize_range(0, count, &job);
+        return;
     }
+    cml_parallel_for(0, count, 4096, cml_vec3_normalize_range, &job);
 }
 
 vector cml_vector_raised_by(vector v, float val) {
     vector ret = cml_vector_allocate(v.dimension);
 
-    for (cml_u32 i = 0; i < ret.dimension; i++) {
-        ret.values[i] = powf(v.values[i], val);
-    }
+    cml_vmath_pow(ret.values, v.values, val, ret.dimension);
     return ret;
 }
 
 void cml_vector_raise_by(vector* v, float val) {
-    for (cml_u32 i = 0; i < v->dimension; i++) {
-        v->values[i] = powf(v->values[i], val);
-    }
-}
-
-float cml_vector_get_value_at_index(vector v, cml_u32 index) {
-    return v.values[index];
+    cml_vmath_pow(v->values, v->values, val, v->dimension);
 }
 
 float cml_vector_distance(vector v1, vector v2) {
-    vector ret = cml_vec_vec_subst(v1, v2);
+    assert(v1.dimension == v2.dimension);
 
-    return cml_vector_magnitude(ret);
+    return (float)sqrt(cml_reduce_distance_squared(v1.values, v2.values,
+                                                   v1.dimension,
+                                                   CML_REDUCE_PAIRWISE));
 }
\ No newline at end of file
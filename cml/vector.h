@@ -20,7 +20,7 @@ typedef struct {
     a given dimension (allocates space for
     n values | n = dimension).
 */
-vector cml_vector_allocate(cml_u32 dimension);
+CML_INLINE vector cml_vector_allocate(cml_u32 dimension);
 
 /*
     Constructs and returns a vector with a given dimension.
@@ -143,28 +143,28 @@ void cml_vec_div_by_vec(vector* v1, vector v2);
     Returns a vector which corresponds to the input
     vector v2 added to the input vector v1.
 */
-vector cml_vec_vec_add(vector v1, vector v2);
+CML_INLINE vector cml_vec_vec_add(vector v1, vector v2);
 
 /*
     Adds the given vector v2 to the given vector v1
 */
-void cml_vec_add_to_vec(vector* v1, vector v2);
+CML_INLINE void cml_vec_add_to_vec(vector* v1, vector v2);
 
 /*
     Returns a vector which corresponds to the input
     vector v2 substracted from the input vector v1.
 */
-vector cml_vec_vec_subst(vector v1, vector v2);
+CML_INLINE vector cml_vec_vec_subst(vector v1, vector v2);
 
 /*
     Substracts the given vector v2 from the given vector v1,
 */
-void cml_subst_vec_from_vec(vector* v1, vector v2);
+CML_INLINE void cml_subst_vec_from_vec(vector* v1, vector v2);
 
 /*
     Returns the dot product of the two given vectors v1 and v2,
 */
-float cml_dot(vector v1, vector v2);
+CML_INLINE float cml_dot(vector v1, vector v2);
 
 /*
     Returns a vector that represents the cross product of
@@ -181,26 +181,54 @@ vector cml_cross(vector v1, vector v2);
 /*
     Returns the magnitude of the given vector v.
 */
-float cml_vector_magnitude(vector v);
+CML_INLINE float cml_vector_magnitude(vector v);
 
 /*
     Returns the squared magnitude of the given vector v.
 */
-float cml_vector_magnitude_squared(vector v);
+CML_INLINE float cml_vector_magnitude_squared(vector v);
 
 BOOL cml_vector_perpendicular(vector v1, vector v2);
 
+/*
+    Selects how normalization computes 1 / |v|.
+
+    CML_NORMALIZE_EXACT: 1 / sqrt(|v|^2) from the correctly
+    rounded square root, no reciprocal square root estimate.
+    Rounds twice, the error stays below 1.5 ULP.
+
+    CML_NORMALIZE_FAST: Hardware reciprocal square root
+    estimate refined by one Newton step, about 2^-22 relative
+    error. Without SSE this is the same as the exact mode.
+*/
+typedef enum {
+    CML_NORMALIZE_EXACT = 0,
+    CML_NORMALIZE_FAST
+} cml_normalize_mode;
+
 /*
     Returns a vector that is the normalized verison of
-    the given vector v.
+    the given vector v. A zero vector stays zero.
 */
 vector cml_vector_normalized(vector v);
 
 /*
-    Normalizes a given vector v.
+    Normalizes a given vector v. A zero vector stays zero.
 */
 void cml_vector_normalize(vector* v);
 
+/*
+    Normalizes a given vector v with the given mode.
+*/
+void cml_vector_normalize_mode(vector* v, cml_normalize_mode mode);
+
+/*
+    Normalizes "count" 3D vectors stored interleaved as
+    x0 y0 z0 x1 y1 z1 ... in place. Zero vectors stay zero.
+*/
+void cml_vec3_normalize_batch(float* xyz, cml_u32 count,
+                              cml_normalize_mode mode);
+
 /*
     Returns a vector that is the given vector v
     raised by the power of the given value "val".
@@ -217,7 +245,7 @@ void cml_vector_raise_by(vector* v, float val);
     Returns the value at the given index from
     the given vectors values array.
 */
-float cml_vector_get_value_at_index(vector v, cml_u32 index);
+CML_INLINE float cml_vector_get_value_at_index(vector v, cml_u32 index);
 
 /*
     Returns the distance between two vectors.
@@ -234,4 +262,8 @@ float cml_vector_distance(vector v1, vector v2);
 #define cml_vector(...) \
     clm_vector_construct(NUM_OF_ARGS(float, __VA_ARGS__), ##__VA_ARGS__)
 
-#endif
\ No newline at end of file
+#ifdef CML_STATIC_INLINE
+#include "internal/cml_vector_inline.h"
+#endif
+
+#endif
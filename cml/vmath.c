@@ -0,0 +1,714 @@
+#include "vmath.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include "internal/cml_simd.h"
+#include "parallel.h"
+
+/*
+    A small set of lane operations the kernels are written in.
+    With SSE2 a lane type holds 4 values, the scalar fallback
+    holds one. Masks are integer lanes with all bits set or
+    cleared.
+*/
+#ifdef CML_SIMD_SSE
+
+#define CML_VMATH_WIDTH 4
+
+typedef __m128 cml_vf;
+typedef __m128i cml_vi;
+
+static inline cml_vf vf_set(float x) { return _mm_set1_ps(x); }
+static inline cml_vf vf_load(const float* p) { return _mm_loadu_ps(p); }
+static inline void vf_store(float* p, cml_vf x) { _mm_storeu_ps(p, x); }
+static inline cml_vf vf_add(cml_vf a, cml_vf b) { return _mm_add_ps(a, b); }
+static inline cml_vf vf_sub(cml_vf a, cml_vf b) { return _mm_sub_ps(a, b); }
+static inline cml_vf vf_mul(cml_vf a, cml_vf b) { return _mm_mul_ps(a, b); }
+static inline cml_vf vf_div(cml_vf a, cml_vf b) { return _mm_div_ps(a, b); }
+static inline cml_vf vf_min(cml_vf a, cml_vf b) { return _mm_min_ps(a, b); }
+static inline cml_vf vf_max(cml_vf a, cml_vf b) { return _mm_max_ps(a, b); }
+static inline cml_vf vf_sqrt(cml_vf a) { return _mm_sqrt_ps(a); }
+static inline cml_vi vf_lt(cml_vf a, cml_vf b) {
+    return _mm_castps_si128(_mm_cmplt_ps(a, b));
+}
+static inline cml_vi vf_eq(cml_vf a, cml_vf b) {
+    return _mm_castps_si128(_mm_cmpeq_ps(a, b));
+}
+static inline cml_vi vf_round(cml_vf a) { return _mm_cvtps_epi32(a); }
+static inline cml_vi vf_trunc(cml_vf a) { return _mm_cvttps_epi32(a); }
+static inline cml_vf vi_to_vf(cml_vi a) { return _mm_cvtepi32_ps(a); }
+static inline cml_vi vf_bits(cml_vf a) { return _mm_castps_si128(a); }
+static inline cml_vf vi_bits(cml_vi a) { return _mm_castsi128_ps(a); }
+
+static inline cml_vi vi_set(cml_i32 x) { return _mm_set1_epi32(x); }
+static inline cml_vi vi_add(cml_vi a, cml_vi b) { return _mm_add_epi32(a, b); }
+static inline cml_vi vi_sub(cml_vi a, cml_vi b) { return _mm_sub_epi32(a, b); }
+static inline cml_vi vi_and(cml_vi a, cml_vi b) { return _mm_and_si128(a, b); }
+static inline cml_vi vi_andnot(cml_vi a, cml_vi b) {
+    return _mm_andnot_si128(a, b);
+}
+static inline cml_vi vi_or(cml_vi a, cml_vi b) { return _mm_or_si128(a, b); }
+static inline cml_vi vi_xor(cml_vi a, cml_vi b) { return _mm_xor_si128(a, b); }
+static inline cml_vi vi_eq(cml_vi a, cml_vi b) { return _mm_cmpeq_epi32(a, b); }
+#define vi_shl(a, n) _mm_slli_epi32(a, n)
+#define vi_shr(a, n) _mm_srli_epi32(a, n)
+
+static inline cml_vf vf_select(cml_vi mask, cml_vf a, cml_vf b) {
+    cml_vf m = _mm_castsi128_ps(mask);
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+
+/*
+    Double precision lanes hold 2 values, a float lane is
+    split into a low and a high half.
+*/
+typedef __m128d cml_vd;
+
+static inline cml_vd vd_set(double x) { return _mm_set1_pd(x); }
+static inline cml_vd vd_add(cml_vd a, cml_vd b) { return _mm_add_pd(a, b); }
+static inline cml_vd vd_sub(cml_vd a, cml_vd b) { return _mm_sub_pd(a, b); }
+static inline cml_vd vd_mul(cml_vd a, cml_vd b) { return _mm_mul_pd(a, b); }
+static inline cml_vd vd_div(cml_vd a, cml_vd b) { return _mm_div_pd(a, b); }
+static inline cml_vd vd_min(cml_vd a, cml_vd b) { return _mm_min_pd(a, b); }
+static inline cml_vd vd_max(cml_vd a, cml_vd b) { return _mm_max_pd(a, b); }
+static inline cml_vi vd_round(cml_vd a) { return _mm_cvtpd_epi32(a); }
+static inline cml_vd vi_to_vd(cml_vi a) { return _mm_cvtepi32_pd(a); }
+static inline cml_vd vf_lo(cml_vf a) { return _mm_cvtps_pd(a); }
+static inline cml_vd vf_hi(cml_vf a) {
+    return _mm_cvtps_pd(_mm_movehl_ps(a, a));
+}
+static inline cml_vf vd_join(cml_vd lo, cml_vd hi) {
+    return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+}
+static inline cml_vi vi_join(cml_vi lo, cml_vi hi) {
+    return _mm_unpacklo_epi64(lo, hi);
+}
+
+/*
+    Returns x - y * pi / 4 evaluated in double precision.
+*/
+static inline cml_vf vf_reduce_pio4(cml_vf x, cml_vf y) {
+    const __m128d pio4_1 = _mm_set1_pd(7.85398163367062807083e-01);
+    const __m128d pio4_1t = _mm_set1_pd(3.03855025325309612466e-11);
+
+    __m128d x_lo = _mm_cvtps_pd(x);
+    __m128d x_hi = _mm_cvtps_pd(_mm_movehl_ps(x, x));
+    __m128d y_lo = _mm_cvtps_pd(y);
+    __m128d y_hi = _mm_cvtps_pd(_mm_movehl_ps(y, y));
+
+    x_lo = _mm_sub_pd(_mm_sub_pd(x_lo, _mm_mul_pd(y_lo, pio4_1)),
+                      _mm_mul_pd(y_lo, pio4_1t));
+    x_hi = _mm_sub_pd(_mm_sub_pd(x_hi, _mm_mul_pd(y_hi, pio4_1)),
+                      _mm_mul_pd(y_hi, pio4_1t));
+
+    return _mm_movelh_ps(_mm_cvtpd_ps(x_lo), _mm_cvtpd_ps(x_hi));
+}
+
+#else
+
+#define CML_VMATH_WIDTH 1
+
+typedef float cml_vf;
+typedef cml_u32 cml_vi;
+
+static inline cml_vf vf_set(float x) { return x; }
+static inline cml_vf vf_load(const float* p) { return *p; }
+static inline void vf_store(float* p, cml_vf x) { *p = x; }
+static inline cml_vf vf_add(cml_vf a, cml_vf b) { return a + b; }
+static inline cml_vf vf_sub(cml_vf a, cml_vf b) { return a - b; }
+static inline cml_vf vf_mul(cml_vf a, cml_vf b) { return a * b; }
+static inline cml_vf vf_div(cml_vf a, cml_vf b) { return a / b; }
+static inline cml_vf vf_min(cml_vf a, cml_vf b) { return a < b ? a : b; }
+static inline cml_vf vf_max(cml_vf a, cml_vf b) { return a > b ? a : b; }
+static inline cml_vf vf_sqrt(cml_vf a) { return sqrtf(a); }
+static inline cml_vi vf_lt(cml_vf a, cml_vf b) { return a < b ? ~0u : 0u; }
+static inline cml_vi vf_eq(cml_vf a, cml_vf b) { return a == b ? ~0u : 0u; }
+static inline cml_vi vf_round(cml_vf a) { return (cml_vi)(cml_i32)lrintf(a); }
+static inline cml_vi vf_trunc(cml_vf a) { return (cml_vi)(cml_i32)a; }
+static inline cml_vf vi_to_vf(cml_vi a) { return (float)(cml_i32)a; }
+static inline cml_vi vf_bits(cml_vf a) {
+    cml_vi ret;
+    memcpy(&ret, &a, sizeof(ret));
+    return ret;
+}
+static inline cml_vf vi_bits(cml_vi a) {
+    cml_vf ret;
+    memcpy(&ret, &a, sizeof(ret));
+    return ret;
+}
+
+static inline cml_vi vi_set(cml_i32 x) { return (cml_vi)x; }
+static inline cml_vi vi_add(cml_vi a, cml_vi b) { return a + b; }
+static inline cml_vi vi_sub(cml_vi a, cml_vi b) { return a - b; }
+static inline cml_vi vi_and(cml_vi a, cml_vi b) { return a & b; }
+static inline cml_vi vi_andnot(cml_vi a, cml_vi b) { return ~a & b; }
+static inline cml_vi vi_or(cml_vi a, cml_vi b) { return a | b; }
+static inline cml_vi vi_xor(cml_vi a, cml_vi b) { return a ^ b; }
+static inline cml_vi vi_eq(cml_vi a, cml_vi b) { return a == b ? ~0u : 0u; }
+#define vi_shl(a, n) ((cml_vi)(a) << (n))
+#define vi_shr(a, n) ((cml_vi)(a) >> (n))
+
+static inline cml_vf vf_select(cml_vi mask, cml_vf a, cml_vf b) {
+    return mask ? a : b;
+}
+
+typedef double cml_vd;
+
+static inline cml_vd vd_set(double x) { return x; }
+static inline cml_vd vd_add(cml_vd a, cml_vd b) { return a + b; }
+static inline cml_vd vd_sub(cml_vd a, cml_vd b) { return a - b; }
+static inline cml_vd vd_mul(cml_vd a, cml_vd b) { return a * b; }
+static inline cml_vd vd_div(cml_vd a, cml_vd b) { return a / b; }
+static inline cml_vd vd_min(cml_vd a, cml_vd b) { return a < b ? a : b; }
+static inline cml_vd vd_max(cml_vd a, cml_vd b) { return a > b ? a : b; }
+static inline cml_vi vd_round(cml_vd a) { return (cml_vi)(cml_i32)lrint(a); }
+static inline cml_vd vi_to_vd(cml_vi a) { return (double)(cml_i32)a; }
+static inline cml_vd vf_lo(cml_vf a) { return a; }
+
+static inline cml_vf vf_reduce_pio4(cml_vf x, cml_vf y) {
+    return (float)(((double)x - (double)y * 7.85398163367062807083e-01) -
+                   (double)y * 3.03855025325309612466e-11);
+}
+
+#endif
+
+static inline cml_vf vf_abs(cml_vf a) {
+    return vi_bits(vi_and(vf_bits(a), vi_set(0x7fffffff)));
+}
+
+static inline cml_vi vf_isnan(cml_vf a) {
+    return vi_xor(vf_eq(a, a), vi_set(-1));
+}
+
+/*
+    Returns x * 2^n for n in [-150, 128]. The power is applied
+    in two halves that both have a normal exponent.
+*/
+static inline cml_vf vf_ldexp(cml_vf x, cml_vi n) {
+    cml_vi n1 = vf_trunc(vf_mul(vi_to_vf(n), vf_set(0.5f)));
+    cml_vi n2 = vi_sub(n, n1);
+
+    x = vf_mul(x, vi_bits(vi_shl(vi_add(n1, vi_set(127)), 23)));
+    return vf_mul(x, vi_bits(vi_shl(vi_add(n2, vi_set(127)), 23)));
+}
+
+/*
+    Cephes style sine and cosine. The argument is reduced to
+    [-pi/4, pi/4] in double precision with pi/4 split in two
+    parts, the first of which multiplies exactly for
+    |x| <= CML_VMATH_TRIG_MAX.
+*/
+static void cml_vmath_sincos_kernel(cml_vf x, cml_vf* s, cml_vf* c) {
+    cml_vi sign_sin = vi_and(vf_bits(x), vi_set((cml_i32)0x80000000u));
+    x = vf_abs(x);
+
+    // octant, rounded up to an even number
+    cml_vi j = vf_trunc(vf_mul(x, vf_set(1.27323954473516f)));
+    j = vi_and(vi_add(j, vi_set(1)), vi_set(~1));
+    cml_vf y = vi_to_vf(j);
+
+    cml_vi swap_sign_sin = vi_shl(vi_and(j, vi_set(4)), 29);
+    cml_vi sign_cos = vi_shl(vi_andnot(vi_sub(j, vi_set(2)), vi_set(4)), 29);
+    cml_vi poly_mask = vi_eq(vi_and(j, vi_set(2)), vi_set(0));
+    sign_sin = vi_xor(sign_sin, swap_sign_sin);
+
+    x = vf_reduce_pio4(x, y);
+
+    cml_vf z = vf_mul(x, x);
+
+    cml_vf poly_cos = vf_set(2.443315711809948e-5f);
+    poly_cos = vf_add(vf_mul(poly_cos, z), vf_set(-1.388731625493765e-3f));
+    poly_cos = vf_add(vf_mul(poly_cos, z), vf_set(4.166664568298827e-2f));
+    poly_cos = vf_mul(vf_mul(poly_cos, z), z);
+    poly_cos = vf_sub(poly_cos, vf_mul(z, vf_set(0.5f)));
+    poly_cos = vf_add(poly_cos, vf_set(1.0f));
+
+    cml_vf poly_sin = vf_set(-1.9515295891e-4f);
+    poly_sin = vf_add(vf_mul(poly_sin, z), vf_set(8.3321608736e-3f));
+    poly_sin = vf_add(vf_mul(poly_sin, z), vf_set(-1.6666654611e-1f));
+    poly_sin = vf_add(vf_mul(vf_mul(poly_sin, z), x), x);
+
+    *s = vi_bits(vi_xor(vf_bits(vf_select(poly_mask, poly_sin, poly_cos)),
+                        sign_sin));
+    *c = vi_bits(vi_xor(vf_bits(vf_select(poly_mask, poly_cos, poly_sin)),
+                        sign_cos));
+}
+
+/*
+    Cephes style exponential. x = n * ln(2) + r with |r| <= ln(2) / 2,
+    exp(r) is a degree 7 polynomial and 2^n is applied in two
+    steps so subnormal results do not flush to zero.
+*/
+static cml_vf cml_vmath_exp_kernel(cml_vf x) {
+    const float max_arg = 88.72283905206835f;
+    const float min_arg = -103.97208f;
+
+    cml_vf in = x;
+    x = vf_min(vf_max(x, vf_set(min_arg)), vf_set(max_arg));
+
+    cml_vi n = vf_round(vf_mul(x, vf_set(1.44269504088896341f)));
+    cml_vf fn = vi_to_vf(n);
+
+    x = vf_sub(x, vf_mul(fn, vf_set(0.693359375f)));
+    x = vf_sub(x, vf_mul(fn, vf_set(-2.12194440e-4f)));
+
+    cml_vf z = vf_mul(x, x);
+    cml_vf y = vf_set(1.9875691500e-4f);
+    y = vf_add(vf_mul(y, x), vf_set(1.3981999507e-3f));
+    y = vf_add(vf_mul(y, x), vf_set(8.3334519073e-3f));
+    y = vf_add(vf_mul(y, x), vf_set(4.1665795894e-2f));
+    y = vf_add(vf_mul(y, x), vf_set(1.6666665459e-1f));
+    y = vf_add(vf_mul(y, x), vf_set(5.0000001201e-1f));
+    y = vf_add(vf_add(vf_mul(y, z), x), vf_set(1.0f));
+
+    y = vf_ldexp(y, n);
+
+    y = vf_select(vf_lt(vf_set(max_arg), in), vf_set(INFINITY), y);
+    y = vf_select(vf_lt(in, vf_set(min_arg)), vf_set(0.0f), y);
+    return vf_select(vf_isnan(in), in, y);
+}
+
+/*
+    Splits a positive x into 2^e * (1 + f) with 1 + f in
+    [sqrt(1/2), sqrt(2)) and returns f. Both parts are exact.
+*/
+static cml_vf cml_vmath_log_reduce(cml_vf x, cml_vf* e) {
+    // scale subnormals into the normal range
+    cml_vi subnormal = vf_lt(x, vf_set(FLT_MIN));
+    x = vf_select(subnormal, vf_mul(x, vf_set(8388608.0f)), x);
+
+    cml_vi bits = vf_bits(x);
+    *e = vi_to_vf(vi_sub(vi_shr(bits, 23), vi_set(126)));
+    *e = vf_sub(*e, vf_select(subnormal, vf_set(23.0f), vf_set(0.0f)));
+
+    bits = vi_and(bits, vi_set(~0x7f800000));
+    x = vi_bits(vi_or(bits, vf_bits(vf_set(0.5f))));
+
+    cml_vi small = vf_lt(x, vf_set(0.707106781186547524f));
+    cml_vf tmp = vf_select(small, x, vf_set(0.0f));
+    x = vf_sub(x, vf_set(1.0f));
+    *e = vf_sub(*e, vf_select(small, vf_set(1.0f), vf_set(0.0f)));
+    return vf_add(x, tmp);
+}
+
+/*
+    Cephes style natural logarithm. x = 2^e * m with m in
+    [sqrt(1/2), sqrt(2)), log(m) is a degree 9 polynomial
+    in m - 1.
+*/
+static cml_vf cml_vmath_log_kernel(cml_vf x) {
+    cml_vf in = x;
+    cml_vf e;
+    x = cml_vmath_log_reduce(x, &e);
+
+    cml_vf z = vf_mul(x, x);
+    cml_vf y = vf_set(7.0376836292e-2f);
+    y = vf_add(vf_mul(y, x), vf_set(-1.1514610310e-1f));
+    y = vf_add(vf_mul(y, x), vf_set(1.1676998740e-1f));
+    y = vf_add(vf_mul(y, x), vf_set(-1.2420140846e-1f));
+    y = vf_add(vf_mul(y, x), vf_set(1.4249322787e-1f));
+    y = vf_add(vf_mul(y, x), vf_set(-1.6668057665e-1f));
+    y = vf_add(vf_mul(y, x), vf_set(2.0000714765e-1f));
+    y = vf_add(vf_mul(y, x), vf_set(-2.4999993993e-1f));
+    y = vf_add(vf_mul(y, x), vf_set(3.3333331174e-1f));
+    y = vf_mul(vf_mul(y, x), z);
+
+    y = vf_add(y, vf_mul(e, vf_set(-2.12194440e-4f)));
+    y = vf_sub(y, vf_mul(z, vf_set(0.5f)));
+    x = vf_add(x, y);
+    x = vf_add(x, vf_mul(e, vf_set(0.693359375f)));
+
+    x = vf_select(vf_eq(in, vf_set(INFINITY)), in, x);
+    x = vf_select(vf_lt(in, vf_set(0.0f)), vf_set(NAN), x);
+    x = vf_select(vf_eq(in, vf_set(0.0f)), vf_set(-INFINITY), x);
+    return vf_select(vf_isnan(in), in, x);
+}
+
+/*
+    Evaluates t = y * log(2^e * (1 + f)) in double precision,
+    with log(1 + f) = 2 * atanh(f / (2 + f)) truncated below
+    2^-36, and returns exp(t) = p * 2^n.
+*/
+static void cml_vmath_pow_exp_log(cml_vd f, cml_vd e, cml_vd y, cml_vd* p,
+                                  cml_vi* n) {
+    const double ln2 = 6.93147180559945286227e-01;
+
+    cml_vd s = vd_div(f, vd_add(vd_set(2.0), f));
+    cml_vd s2 = vd_mul(s, s);
+    cml_vd log = vd_set(1.0 / 13.0);
+    log = vd_add(vd_mul(log, s2), vd_set(1.0 / 11.0));
+    log = vd_add(vd_mul(log, s2), vd_set(1.0 / 9.0));
+    log = vd_add(vd_mul(log, s2), vd_set(1.0 / 7.0));
+    log = vd_add(vd_mul(log, s2), vd_set(1.0 / 5.0));
+    log = vd_add(vd_mul(log, s2), vd_set(1.0 / 3.0));
+    log = vd_add(vd_mul(log, s2), vd_set(1.0));
+    log = vd_add(vd_mul(e, vd_set(ln2)), vd_mul(vd_mul(s, vd_set(2.0)), log));
+
+    // outside of [-104, 89] the result is zero or infinite anyway
+    cml_vd t = vd_mul(y, log);
+    t = vd_min(vd_max(t, vd_set(-104.0)), vd_set(89.0));
+
+    *n = vd_round(vd_mul(t, vd_set(1.44269504088896338700e+00)));
+    cml_vd r = vd_sub(t, vd_mul(vi_to_vd(*n), vd_set(ln2)));
+
+    // |r| <= ln(2) / 2, the first omitted term is below 2^-37
+    cml_vd exp = vd_set(1.0 / 362880.0);
+    exp = vd_add(vd_mul(exp, r), vd_set(1.0 / 40320.0));
+    exp = vd_add(vd_mul(exp, r), vd_set(1.0 / 5040.0));
+    exp = vd_add(vd_mul(exp, r), vd_set(1.0 / 720.0));
+    exp = vd_add(vd_mul(exp, r), vd_set(1.0 / 120.0));
+    exp = vd_add(vd_mul(exp, r), vd_set(1.0 / 24.0));
+    exp = vd_add(vd_mul(exp, r), vd_set(1.0 / 6.0));
+    exp = vd_add(vd_mul(exp, r), vd_set(0.5));
+    exp = vd_add(vd_mul(exp, r), vd_set(1.0));
+    *p = vd_add(vd_mul(exp, r), vd_set(1.0));
+}
+
+static cml_vf cml_vmath_pow_kernel(cml_vf x, float y, BOOL integral,
+                                   BOOL odd) {
+    cml_vf ax = vf_abs(x);
+    cml_vf e;
+    cml_vf f = cml_vmath_log_reduce(ax, &e);
+
+    cml_vf p;
+    cml_vi n;
+#if CML_VMATH_WIDTH == 4
+    cml_vd p_lo, p_hi;
+    cml_vi n_lo, n_hi;
+    cml_vmath_pow_exp_log(vf_lo(f), vf_lo(e), vd_set(y), &p_lo, &n_lo);
+    cml_vmath_pow_exp_log(vf_hi(f), vf_hi(e), vd_set(y), &p_hi, &n_hi);
+    p = vd_join(p_lo, p_hi);
+    n = vi_join(n_lo, n_hi);
+#else
+    cml_vd p_d;
+    cml_vmath_pow_exp_log(vf_lo(f), vf_lo(e), vd_set(y), &p_d, &n);
+    p = (float)p_d;
+#endif
+    cml_vf ret = vf_ldexp(p, n);
+
+    cml_vf zero_result = vf_set(y > 0.0f ? 0.0f : INFINITY);
+    cml_vf inf_result = vf_set(y > 0.0f ? INFINITY : 0.0f);
+    ret = vf_select(vf_eq(ax, vf_set(0.0f)), zero_result, ret);
+    ret = vf_select(vf_eq(ax, vf_set(INFINITY)), inf_result, ret);
+
+    if (!integral) {
+        // negative finite x has no real power, -inf behaves like +inf
+        cml_vi negative = vf_lt(x, vf_set(0.0f));
+        negative = vi_andnot(vf_eq(ax, vf_set(INFINITY)), negative);
+        ret = vf_select(negative, vf_set(NAN), ret);
+    } else if (odd) {
+        cml_vi sign = vi_and(vf_bits(x), vi_set((cml_i32)0x80000000u));
+        ret = vi_bits(vi_or(vf_bits(ret), sign));
+    }
+    return vf_select(vf_isnan(x), x, ret);
+}
+
+static cml_vf cml_vmath_powi_kernel(cml_vf x, cml_i32 n) {
+    cml_u32 k = (cml_u32)(n < 0 ? -n : n);
+    cml_vf ret = vf_set(1.0f);
+
+    while (k) {
+        if (k & 1) {
+            ret = vf_mul(ret, x);
+        }
+        x = vf_mul(x, x);
+        k >>= 1;
+    }
+    return n < 0 ? vf_div(vf_set(1.0f), ret) : ret;
+}
+
+/*
+    x^(n + 1/2) = x^n * sqrt(x) for n >= 0, negative finite x
+    gives NaN. sqrt() alone would turn -inf into NaN and -0
+    into -0, where pow() returns +inf and +0.
+*/
+static cml_vf cml_vmath_pow_half_kernel(cml_vf x, cml_i32 n) {
+    cml_vf ret = vf_mul(cml_vmath_powi_kernel(x, n), vf_sqrt(x));
+
+    ret = vf_select(vf_eq(x, vf_set(-INFINITY)), vf_set(INFINITY), ret);
+    return vf_select(vf_eq(x, vf_set(0.0f)), vf_set(0.0f), ret);
+}
+
+typedef enum {
+    CML_VMATH_SIN,
+    CML_VMATH_COS,
+    CML_VMATH_SINCOS,
+    CML_VMATH_TAN,
+    CML_VMATH_EXP,
+    CML_VMATH_LOG,
+    CML_VMATH_POW_INT,
+    CML_VMATH_POW_HALF,
+    CML_VMATH_POW
+} cml_vmath_op;
+
+typedef struct {
+    float* dst;
+    float* dst2;
+    const float* src;
+    cml_vmath_op op;
+    float exponent;
+    cml_i32 int_exponent;
+    BOOL integral_exponent;
+    BOOL odd_exponent;
+} cml_vmath_job;
+
+static void cml_vmath_eval(cml_vmath_job* job, const float* in, float* out,
+                           float* out2) {
+    cml_vf x = vf_load(in);
+    cml_vf s, c;
+
+    switch (job->op) {
+        case CML_VMATH_SIN:
+            cml_vmath_sincos_kernel(x, &s, &c);
+            vf_store(out, s);
+            break;
+        case CML_VMATH_COS:
+            cml_vmath_sincos_kernel(x, &s, &c);
+            vf_store(out, c);
+            break;
+        case CML_VMATH_SINCOS:
+            cml_vmath_sincos_kernel(x, &s, &c);
+            vf_store(out, s);
+            vf_store(out2, c);
+            break;
+        case CML_VMATH_TAN:
+            cml_vmath_sincos_kernel(x, &s, &c);
+            vf_store(out, vf_div(s, c));
+            break;
+        case CML_VMATH_EXP:
+            vf_store(out, cml_vmath_exp_kernel(x));
+            break;
+        case CML_VMATH_LOG:
+            vf_store(out, cml_vmath_log_kernel(x));
+            break;
+        case CML_VMATH_POW_INT:
+            vf_store(out, cml_vmath_powi_kernel(x, job->int_exponent));
+            break;
+        case CML_VMATH_POW_HALF:
+            vf_store(out, cml_vmath_pow_half_kernel(x, job->int_exponent));
+            break;
+        case CML_VMATH_POW:
+            vf_store(out, cml_vmath_pow_kernel(x, job->exponent,
+                                               job->integral_exponent,
+                                               job->odd_exponent));
+            break;
+    }
+}
+
+static float cml_vmath_trig_slow(cml_vmath_op op, float x, float* out2) {
+    switch (op) {
+        case CML_VMATH_SIN:
+            return (float)sin(x);
+        case CML_VMATH_COS:
+            return (float)cos(x);
+        case CML_VMATH_SINCOS:
+            *out2 = (float)cos(x);
+            return (float)sin(x);
+        default:
+            return (float)tan(x);
+    }
+}
+
+static void cml_vmath_range(cml_u32 begin, cml_u32 end, void* arg) {
+    cml_vmath_job* job = arg;
+    BOOL trig = job->op <= CML_VMATH_TAN;
+
+    // out2 is only written by sincos, zeroing both keeps
+    // compilers from flagging the copies below
+    float in[CML_VMATH_WIDTH];
+    float out[CML_VMATH_WIDTH] = {0};
+    float out2[CML_VMATH_WIDTH] = {0};
+
+    for (cml_u32 i = begin; i < end; i += CML_VMATH_WIDTH) {
+        cml_u32 n = end - i < CML_VMATH_WIDTH ? end - i : CML_VMATH_WIDTH;
+
+        // the tail is padded with ones, a valid input for every op
+        for (cml_u32 l = 0; l < CML_VMATH_WIDTH; l++) {
+            in[l] = l < n ? job->src[i + l] : 1.0f;
+        }
+
+        cml_vmath_eval(job, in, out, out2);
+
+        if (trig) {
+            for (cml_u32 l = 0; l < n; l++) {
+                if (fabsf(in[l]) > CML_VMATH_TRIG_MAX) {
+                    out[l] = cml_vmath_trig_slow(job->op, in[l], &out2[l]);
+                }
+            }
+        }
+
+        memcpy(job->dst + i, out, n * sizeof(float));
+        if (job->dst2) {
+            memcpy(job->dst2 + i, out2, n * sizeof(float));
+        }
+    }
+}
+
+static void cml_vmath_run(cml_vmath_job* job, cml_u32 count) {
+    if (count < CML_PARALLEL_THRESHOLD) {
+        cml_vmath_range(0, count, job);
+        return;
+    }
+
+    // whole lane groups per chunk
+    cml_u32 grain = count / (cml_parallel_num_threads() * 8);
+    grain = (grain + CML_VMATH_WIDTH - 1) / CML_VMATH_WIDTH * CML_VMATH_WIDTH;
+    cml_parallel_for(0, count, grain, cml_vmath_range, job);
+}
+
+static void cml_vmath_apply(float* dst, const float* src, cml_u32 count,
+                            cml_vmath_op op) {
+    cml_vmath_job job;
+    memset(&job, 0, sizeof(job));
+
+    job.dst = dst;
+    job.src = src;
+    job.op = op;
+
+    cml_vmath_run(&job, count);
+}
+
+void cml_vmath_sin(float* dst, const float* src, cml_u32 count) {
+    cml_vmath_apply(dst, src, count, CML_VMATH_SIN);
+}
+
+void cml_vmath_cos(float* dst, const float* src, cml_u32 count) {
+    cml_vmath_apply(dst, src, count, CML_VMATH_COS);
+}
+
+void cml_vmath_sincos(float* dst_sin, float* dst_cos, const float* src,
+                      cml_u32 count) {
+    cml_vmath_job job;
+    memset(&job, 0, sizeof(job));
+
+    job.dst = dst_sin;
+    job.dst2 = dst_cos;
+    job.src = src;
+    job.op = CML_VMATH_SINCOS;
+
+    cml_vmath_run(&job, count);
+}
+
+void cml_vmath_tan(float* dst, const float* src, cml_u32 count) {
+    cml_vmath_apply(dst, src, count, CML_VMATH_TAN);
+}
+
+void cml_vmath_exp(float* dst, const float* src, cml_u32 count) {
+    cml_vmath_apply(dst, src, count, CML_VMATH_EXP);
+}
+
+void cml_vmath_log(float* dst, const float* src, cml_u32 count) {
+    cml_vmath_apply(dst, src, count, CML_VMATH_LOG);
+}
+
+void cml_vmath_pow(float* dst, const float* src, float exponent,
+                   cml_u32 count) {
+    cml_vmath_job job;
+    memset(&job, 0, sizeof(job));
+
+    job.dst = dst;
+    job.src = src;
+    job.exponent = exponent;
+
+    // infinite and NaN exponents are rare enough for libm
+    if (!isfinite(exponent)) {
+        for (cml_u32 i = 0; i < count; i++) {
+            dst[i] = powf(src[i], exponent);
+        }
+        return;
+    }
+
+    float twice = exponent * 2.0f;
+    BOOL integral = floorf(exponent) == exponent;
+
+    // larger negative powers would underflow in the intermediate x^n
+    if (integral && exponent >= -1.0f && exponent <= CML_VMATH_POW_INT_MAX) {
+        job.op = CML_VMATH_POW_INT;
+        job.int_exponent = (cml_i32)exponent;
+    } else if (!integral && floorf(twice) == twice && exponent > 0.0f &&
+               exponent <= CML_VMATH_POW_INT_MAX + 0.5f) {
+        job.op = CML_VMATH_POW_HALF;
+        job.int_exponent = (cml_i32)floorf(exponent);
+    } else {
+        job.op = CML_VMATH_POW;
+        job.integral_exponent = integral;
+        job.odd_exponent = integral && fmodf(exponent, 2.0f) != 0.0f;
+    }
+
+    cml_vmath_run(&job, count);
+}
+
+float cml_sin(float x) {
+    float ret;
+    cml_vmath_sin(&ret, &x, 1);
+    return ret;
+}
+
+float cml_cos(float x) {
+    float ret;
+    cml_vmath_cos(&ret, &x, 1);
+    return ret;
+}
+
+void cml_sincos(float x, float* s, float* c) { cml_vmath_sincos(s, c, &x, 1); }
+
+float cml_tan(float x) {
+    float ret;
+    cml_vmath_tan(&ret, &x, 1);
+    return ret;
+}
+
+float cml_exp(float x) {
+    float ret;
+    cml_vmath_exp(&ret, &x, 1);
+    return ret;
+}
+
+float cml_log(float x) {
+    float ret;
+    cml_vmath_log(&ret, &x, 1);
+    return ret;
+}
+
+float cml_pow(float x, float y) {
+    float ret;
+    cml_vmath_pow(&ret, &x, y, 1);
+    return ret;
+}
+
+vector cml_vector_sin(vector v) {
+    vector ret = cml_vector_allocate(v.dimension);
+    cml_vmath_sin(ret.values, v.values, v.dimension);
+
+    return ret;
+}
+
+vector cml_vector_cos(vector v) {
+    vector ret = cml_vector_allocate(v.dimension);
+    cml_vmath_cos(ret.values, v.values, v.dimension);
+
+    return ret;
+}
+
+vector cml_vector_tan(vector v) {
+    vector ret = cml_vector_allocate(v.dimension);
+    cml_vmath_tan(ret.values, v.values, v.dimension);
+
+    return ret;
+}
+
+vector cml_vector_exp(vector v) {
+    vector ret = cml_vector_allocate(v.dimension);
+    cml_vmath_exp(ret.values, v.values, v.dimension);
+
+    return ret;
+}
+
+vector cml_vector_log(vector v) {
+    vector ret = cml_vector_allocate(v.dimension);
+    cml_vmath_log(ret.values, v.values, v.dimension);
+
+    return ret;
+}
@@ -0,0 +1,110 @@
+#ifndef CML_VMATH_INCLUDED
+#define CML_VMATH_INCLUDED
+
+#include "internal/cml_core.h"
+#include "vector.h"
+
+/*
+    Vectorized single precision math functions.
+
+    The array functions process 4 values at a time with SSE2
+    (or one at a time with the scalar fallback, which uses the
+    same polynomials) and run on the thread pool from
+    CML_PARALLEL_THRESHOLD values on. "dst" may be equal to
+    "src".
+
+    Maximum errors measured against double precision libm over
+    the full float range (ULP = unit in the last place):
+
+    sin, cos, sincos    1.6 ULP  (|x| <= CML_VMATH_TRIG_MAX)
+    tan                 3.5 ULP  (|x| <= CML_VMATH_TRIG_MAX)
+    exp                 1 ULP
+    log                 1 ULP
+    pow                 integer exponents -1..4: 2 ULP
+                        half-integer exponents 0.5..4.5: 3.5 ULP
+                        otherwise: 1 ULP
+
+    Trig arguments beyond CML_VMATH_TRIG_MAX are passed to the
+    double precision libm functions, which keeps them correct
+    but slow. Results below FLT_MIN are subnormal but may lose
+    more precision than stated above.
+*/
+#define CML_VMATH_TRIG_MAX 8192.0f
+
+/*
+    Largest exponent for which pow() uses repeated
+    multiplication instead of exp(y * log(x)). The general
+    path evaluates y * log(x) and its exponential in double
+    precision.
+*/
+#define CML_VMATH_POW_INT_MAX 4
+
+float cml_sin(float x);
+
+float cml_cos(float x);
+
+/*
+    Computes the sine and cosine of the given value "x"
+    in one pass.
+*/
+void cml_sincos(float x, float* s, float* c);
+
+float cml_tan(float x);
+
+float cml_exp(float x);
+
+/*
+    Returns the natural logarithm of the given value "x".
+*/
+float cml_log(float x);
+
+/*
+    Returns the given value "x" raised by the power of
+    the given value "y".
+*/
+float cml_pow(float x, float y);
+
+/*
+    Writes the sine of the first "count" values of "src"
+    to "dst".
+*/
+void cml_vmath_sin(float* dst, const float* src, cml_u32 count);
+
+void cml_vmath_cos(float* dst, const float* src, cml_u32 count);
+
+/*
+    Writes the sine and the cosine of the first "count"
+    values of "src" to "dst_sin" and "dst_cos".
+*/
+void cml_vmath_sincos(float* dst_sin, float* dst_cos, const float* src,
+                      cml_u32 count);
+
+void cml_vmath_tan(float* dst, const float* src, cml_u32 count);
+
+void cml_vmath_exp(float* dst, const float* src, cml_u32 count);
+
+void cml_vmath_log(float* dst, const float* src, cml_u32 count);
+
+/*
+    Writes the first "count" values of "src" raised by the
+    power of the given exponent to "dst".
+*/
+void cml_vmath_pow(float* dst, const float* src, float exponent,
+                   cml_u32 count);
+
+/*
+    Returns a vector that contains the sine / cosine /
+    tangent / exponential / natural logarithm of every
+    value of the given vector "v".
+*/
+vector cml_vector_sin(vector v);
+
+vector cml_vector_cos(vector v);
+
+vector cml_vector_tan(vector v);
+
+vector cml_vector_exp(vector v);
+
+vector cml_vector_log(vector v);
+
+#endif  // CML_VMATH_INCLUDED
@@ -0,0 +1,175 @@
+#!/bin/sh
+#
+# Generates the single header build of cml: cml.h with every
+# header it includes, followed by all .c files behind
+# CML_IMPLEMENTATION. Local includes are expanded once in
+# place, so the headers keep their dependency order.
+#
+#   tools/amalgamate.sh [output]   writes output (default
+#                                  cml_single.h)
+#   tools/amalgamate.sh --check    generates the header into a
+#                                  temporary directory, builds a
+#                                  two file program with and
+#                                  without CML_NO_SIMD and runs it
+#
+# --check uses $CC (default cc) and appends $CFLAGS.
+
+set -eu
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+
+amalgamate() {
+    awk -v root="$root" -v sources="$(cd "$root" && ls cml/*.c)" '
+        function normalize(path) {
+            while (sub(/[^\/]+\/\.\.\//, "", path)) {
+            }
+            return path
+        }
+
+        function expand(path,    dir, line, name) {
+            path = normalize(path)
+            if (path in seen) {
+                return
+            }
+            seen[path] = 1
+
+            dir = path
+            sub(/[^\/]*$/, "", dir)
+
+            print ""
+            print "// " substr(path, length(root) + 2)
+            while ((getline line < path) > 0) {
+                if (line ~ /^[ \t]*#[ \t]*include[ \t]*"/) {
+                    name = line
+                    sub(/^[^"]*"/, "", name)
+                    sub(/".*$/, "", name)
+                    expand(dir name)
+                } else {
+                    print line
+                }
+            }
+            close(path)
+        }
+
+        BEGIN {
+            print "/*"
+            print "    cml single header build, generated by"
+            print "    tools/amalgamate.sh. Do not edit."
+            print ""
+            print "    Define CML_IMPLEMENTATION in exactly one C file"
+            print "    before including this header (and any other"
+            print "    header) to compile the library into that file."
+            print "    The CML_INLINE functions are static inline in"
+            print "    every file that includes it."
+            print "*/"
+            print "#ifndef CML_SINGLE_INCLUDED"
+            print "#define CML_SINGLE_INCLUDED"
+            print ""
+            print "#ifndef CML_STATIC_INLINE"
+            print "#define CML_STATIC_INLINE"
+            print "#endif"
+            print ""
+            print "#if defined(CML_IMPLEMENTATION) && !defined(_WIN32) && \\"
+            print "    !defined(_POSIX_C_SOURCE)"
+            print "#define _POSIX_C_SOURCE 200809L"
+            print "#endif"
+            expand(root "/cml/cml.h")
+            print ""
+            print "#endif  // CML_SINGLE_INCLUDED"
+            print ""
+            print "#if defined(CML_IMPLEMENTATION) && \\"
+            print "    !defined(CML_IMPLEMENTATION_INCLUDED)"
+            print "#define CML_IMPLEMENTATION_INCLUDED"
+
+            n = split(sources, files, "\n")
+            for (i = 1; i <= n; i++) {
+                expand(root "/" files[i])
+            }
+
+            print ""
+            print "#endif  // CML_IMPLEMENTATION_INCLUDED"
+        }'
+}
+
+check() {
+    tmp=$(mktemp -d)
+    trap 'rm -rf "$tmp"' EXIT
+
+    amalgamate >"$tmp/cml_single.h"
+
+    cat >"$tmp/implementation.c" <<'EOF'
+#define CML_IMPLEMENTATION
+#include "cml_single.h"
+
+float check_radians(float degrees) { return cml_radians(degrees); }
+EOF
+
+    cat >"$tmp/main.c" <<'EOF'
+#include <math.h>
+#include <stdio.h>
+
+#include "cml_single.h"
+
+float check_radians(float degrees);
+
+static int fails = 0;
+
+static void expect(int ok, const char* what) {
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        fails++;
+    }
+}
+
+int main(void) {
+    vector a = cml_vector_allocate(1000);
+    vector b = cml_vector_allocate(1000);
+    for (cml_u32 i = 0; i < a.dimension; i++) {
+        a.values[i] = (float)(i % 7) - 3.0f;
+        b.values[i] = (float)(i % 5) * 0.5f;
+    }
+
+    expect(cml_dot(a, b) == cml_reduce_dot(a.values, b.values, a.dimension,
+                                           CML_REDUCE_PAIRWISE),
+           "cml_dot");
+    expect(cml_radians(180.0f) == check_radians(180.0f), "cml_radians");
+    expect(fabsf(cml_radians(180.0f) - 3.14159265f) < 1e-6f, "cml_radians");
+    expect(cml_vector_get_value_at_index(a, 10) == 0.0f,
+           "cml_vector_get_value_at_index");
+
+    vector sum = cml_vec_vec_add(a, b);
+    cml_subst_vec_from_vec(&sum, b);
+    expect(cml_vector_distance(sum, a) == 0.0f, "cml_vec_vec_add");
+    expect(fabsf(cml_vector_magnitude(a) - sqrtf(cml_dot(a, a))) < 1e-3f,
+           "cml_vector_magnitude");
+
+    matrix m = cml_matrix_identity(4);
+    matrix p = cml_mat_mat_mult(m, m);
+    expect(p.values[2][2] == 1.0f && p.values[2][1] == 0.0f,
+           "cml_mat_mat_mult");
+
+    cml_vector_free_mem(&a);
+    cml_vector_free_mem(&b);
+    cml_vector_free_mem(&sum);
+    cml_matrix_free_mem(&m);
+    cml_matrix_free_mem(&p);
+
+    return fails != 0;
+}
+EOF
+
+    for flags in "" "-DCML_NO_SIMD"; do
+        echo "checking cml_single.h ${flags:-(SIMD)}"
+        # shellcheck disable=SC2086
+        ${CC:-cc} -std=c99 -O2 -Wall -Werror $flags ${CFLAGS:-} \
+            -I "$tmp" "$tmp/implementation.c" "$tmp/main.c" \
+            -o "$tmp/check" -lm -lpthread
+        "$tmp/check"
+    done
+}
+
+if [ "${1:-}" = "--check" ]; then
+    check
+else
+    amalgamate >"${1:-cml_single.h}"
+fi